@@ -22,8 +22,11 @@ LOCAL_SRC_FILES = \
 		  data-plane/ttable.c            \
 		  data-plane/encapsulations/vxlan-gpe.c              \
 		  data-plane/tun/tun.c           \
+		  data-plane/tun/tun_eid_index.c \
 		  data-plane/tun/tun_input.c     \
+		  data-plane/tun/tun_offload.c   \
 		  data-plane/tun/tun_output.c    \
+		  data-plane/tun/tun_worker.c    \
 		  elibs/mbedtls/md.c             \
 		  elibs/mbedtls/sha1.c           \
 		  elibs/mbedtls/sha256.c         \
@@ -61,12 +64,16 @@ LOCAL_SRC_FILES = \
           lib/packets.c                  \
           lib/pointers_table.c           \
 		  lib/prefixes.c                 \
+		  lib/rcu.c                      \
 		  lib/routing_tables_lib.c       \
 		  lib/sockets.c                  \
 		  lib/sockets-util.c             \
 		  lib/shash.c                    \
+		  lib/static_map_cache.c         \
 		  lib/timers.c                   \
           lib/timers_utils.c             \
+          lib/lpm.c                      \
+          lib/token_bucket.c             \
 		  lib/util.c                     \
 		  net_mgr/net_mgr.c              \
           net_mgr/net_mgr_proc_fc.c      \
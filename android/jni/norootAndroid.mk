@@ -61,12 +61,16 @@ LOCAL_SRC_FILES = \
           lib/packets.c                  \
           lib/pointers_table.c           \
 		  lib/prefixes.c                 \
+		  lib/rcu.c                      \
 		  lib/routing_tables_lib.c       \
 		  lib/sockets.c                  \
 		  lib/sockets-util.c             \
 		  lib/shash.c                    \
+		  lib/static_map_cache.c         \
 		  lib/timers.c                   \
           lib/timers_utils.c             \
+          lib/lpm.c                      \
+          lib/token_bucket.c             \
 		  lib/util.c                     \
 		  net_mgr/net_mgr.c              \
           net_mgr/net_mgr_proc_fc.c      \
@@ -678,6 +678,7 @@ oor_api_xtr_mapdb_create(oor_api_connection_t *conn, oor_api_msg_hdr_t *hdr,
     glist_t *lcl_map_e_list;
     glist_entry_t *conf_map_it;
     glist_entry_t *local_map_entry_it;
+    int_htable *old_iids = NULL;
     int result_msg_len;
     uint8_t *result_msg;
     int ipv4_mapings = 0;
@@ -761,6 +762,9 @@ oor_api_xtr_mapdb_create(oor_api_connection_t *conn, oor_api_msg_hdr_t *hdr,
     /*
      * Empty previous local database
      */
+    /* The map cache entries of the IIDs no longer used are removed once the
+     * new database is in place */
+    old_iids = tr_local_db_iids(xtr);
     /* Remove routing configuration for the eids */
     local_map_db_foreach_entry(xtr->local_mdb, it) {
         map_loc_e = (map_local_entry_t *)it;
@@ -796,6 +800,9 @@ oor_api_xtr_mapdb_create(oor_api_connection_t *conn, oor_api_msg_hdr_t *hdr,
     /* Update control with new added interfaces */
     ctrl_update_iface_info(ctrl_dev->ctrl);
 
+    tr_mcache_remove_unused_iids(xtr, old_iids);
+    int_htable_destroy(old_iids);
+
 
     OOR_LOG(LDBG_1, "OOR_API: New local data base created");
     OOR_LOG(LDBG_2, "************* %20s ***************", "Local EID Database");
@@ -827,6 +834,7 @@ oor_api_xtr_mapdb_create(oor_api_connection_t *conn, oor_api_msg_hdr_t *hdr,
     glist_destroy(smr_lcl_map_e_list);
     glist_destroy(lcl_map_e_list);
     shash_destroy(lcaf_ht);
+    int_htable_destroy(old_iids);
 
     if (doc != NULL){
         xmlFreeDoc(doc);
@@ -846,6 +854,7 @@ oor_api_xtr_mapdb_delete(oor_api_connection_t *conn, oor_api_msg_hdr_t *hdr,
 {
     lisp_xtr_t *xtr;
     map_local_entry_t *map_loc_e;
+    int_htable *old_iids;
     void *it;
     uint8_t *result_msg;
     int result_msg_len;
@@ -853,6 +862,7 @@ oor_api_xtr_mapdb_delete(oor_api_connection_t *conn, oor_api_msg_hdr_t *hdr,
     OOR_LOG(LDBG_2, "OOR_API: Deleting local Mapping Database list");
 
     xtr = CONTAINER_OF(ctrl_dev, lisp_xtr_t, super);
+    old_iids = tr_local_db_iids(xtr);
 
     /* Remove routing configuration for the eids */
     local_map_db_foreach_entry(xtr->local_mdb, it) {
@@ -864,6 +874,10 @@ oor_api_xtr_mapdb_delete(oor_api_connection_t *conn, oor_api_msg_hdr_t *hdr,
     local_map_db_del(xtr->local_mdb);
     xtr->local_mdb = local_map_db_new();
 
+    /* No IID is used anymore */
+    tr_mcache_remove_unused_iids(xtr, old_iids);
+    int_htable_destroy(old_iids);
+
     /* Send confirmation message to the API server */
     result_msg_len = oor_api_result_msg_new(&result_msg,hdr->device,hdr->target,hdr->operation,OOR_API_RES_OK);
     oor_api_send(conn,result_msg,result_msg_len,OOR_API_NOFLAGS);
@@ -406,8 +406,10 @@ int
 configure_tunnel_router(cfg_t *cfg, lisp_xtr_t *xtr, shash_t *lcaf_ht)
 {
     int i,n,ret;
+    int max_entries, max_memory;
     char *map_resolver;
     char *encap;
+    char *smc_file;
     mapping_t *mapping;
 
     /* FWD POLICY STRUCTURES */
@@ -432,6 +434,24 @@ configure_tunnel_router(cfg_t *cfg, lisp_xtr_t *xtr, shash_t *lcaf_ht)
     /* RETRIES */
     ret = cfg_getint(cfg, "map-request-retries");
     xtr->map_request_retries = (ret != 0) ? ret : DEFAULT_MAP_REQUEST_RETRIES;
+    xtr->map_request_batch_window = cfg_getint(cfg, "map-request-batch-window");
+    validate_map_request_batch_window(&xtr->map_request_batch_window);
+    max_entries = cfg_getint(cfg, "map-cache-max-entries");
+    max_memory = cfg_getint(cfg, "map-cache-max-memory");
+    validate_map_cache_limits(&max_entries, &max_memory);
+    mcache_set_limits(xtr->map_cache, max_entries, (size_t)max_memory * 1024);
+
+    /* MAP-REQUEST LIMITS CONFIG */
+    cfg_t *ml = cfg_getnsec(cfg, "map-request-limits", 0);
+    if (ml != NULL) {
+        xtr->mreq_limits.global_rate = cfg_getint(ml, "global-rate");
+        xtr->mreq_limits.global_burst = cfg_getint(ml, "global-burst");
+        xtr->mreq_limits.src_eid_rate = cfg_getint(ml, "source-eid-rate");
+        xtr->mreq_limits.src_eid_burst = cfg_getint(ml, "source-eid-burst");
+        xtr->mreq_limits.mr_rate = cfg_getint(ml, "map-resolver-rate");
+        xtr->mreq_limits.mr_burst = cfg_getint(ml, "map-resolver-burst");
+        validate_map_request_limits(&xtr->mreq_limits);
+    }
 
 
     /* RLOC PROBING CONFIG */
@@ -441,9 +461,11 @@ configure_tunnel_router(cfg_t *cfg, lisp_xtr_t *xtr, shash_t *lcaf_ht)
         xtr->probe_retries = cfg_getint(dm, "rloc-probe-retries");
         xtr->probe_retries_interval = cfg_getint(dm,
                 "rloc-probe-retries-interval");
+        xtr->probe_min_interval = cfg_getint(dm, "rloc-probe-min-interval");
 
         validate_rloc_probing_parameters(&xtr->probe_interval,
-                &xtr->probe_retries, &xtr->probe_retries_interval);
+                &xtr->probe_retries, &xtr->probe_retries_interval,
+                &xtr->probe_min_interval);
     } else {
         OOR_LOG(LDBG_1, "Configuration file: RLOC probing not defined. "
                 "Setting default values: RLOC Probing Interval: %d sec.",
@@ -451,7 +473,38 @@ configure_tunnel_router(cfg_t *cfg, lisp_xtr_t *xtr, shash_t *lcaf_ht)
         xtr->probe_interval = RLOC_PROBING_INTERVAL;
         xtr->probe_retries = DEFAULT_RLOC_PROBING_RETRIES;
         xtr->probe_retries_interval = DEFAULT_RLOC_PROBING_RETRIES_INTERVAL;
+        xtr->probe_min_interval = DEFAULT_RLOC_PROBING_MIN_INTERVAL;
+    }
 
+
+    /* DATA PLANE CONFIG */
+    cfg_t *dp = cfg_getnsec(cfg, "data-plane", 0);
+    if (dp != NULL) {
+        data_plane_conf.burst_size = cfg_getint(dp, "burst-size");
+        data_plane_conf.workers = cfg_getint(dp, "workers");
+        data_plane_conf.tun_queues = cfg_getint(dp, "tun-queues");
+        data_plane_conf.offload = cfg_getbool(dp, "offload") ? TRUE : FALSE;
+        data_plane_conf.flow_table_size = cfg_getint(dp, "flow-table-size");
+        data_plane_conf.flow_idle_timeout = cfg_getint(dp, "flow-idle-timeout");
+        data_plane_conf.udp_src_port_entropy = cfg_getbool(dp, "udp-src-port-entropy") ? TRUE : FALSE;
+        data_plane_conf.ipv4_udp_checksum = cfg_getbool(dp, "ipv4-udp-checksum") ? TRUE : FALSE;
+        validate_data_plane_parameters(&data_plane_conf);
+    } else {
+        OOR_LOG(LDBG_1, "Configuration file: Data plane parameters not defined. "
+                "Setting default values: Burst size: %d packets, No workers, "
+                "1 tun queue, No offload, Flow table size: %d flows, "
+                "Flow idle timeout: %d seconds, Fixed UDP source port, "
+                "IPv4 UDP checksum", DATA_PLANE_DEFAULT_BURST_SIZE,
+                DATA_PLANE_DEFAULT_FLOW_TABLE_SIZE,
+                DATA_PLANE_DEFAULT_FLOW_IDLE_TIMEOUT);
+        data_plane_conf.burst_size = DATA_PLANE_DEFAULT_BURST_SIZE;
+        data_plane_conf.workers = 0;
+        data_plane_conf.tun_queues = 1;
+        data_plane_conf.offload = FALSE;
+        data_plane_conf.flow_table_size = DATA_PLANE_DEFAULT_FLOW_TABLE_SIZE;
+        data_plane_conf.flow_idle_timeout = DATA_PLANE_DEFAULT_FLOW_IDLE_TIMEOUT;
+        data_plane_conf.udp_src_port_entropy = FALSE;
+        data_plane_conf.ipv4_udp_checksum = TRUE;
     }
 
 
@@ -495,6 +548,14 @@ configure_tunnel_router(cfg_t *cfg, lisp_xtr_t *xtr, shash_t *lcaf_ht)
         }
         continue;
     }
+
+    /* STATIC MAP-CACHE FILE CONFIG */
+    if ((smc_file = cfg_getstr(cfg, "static-map-cache-file")) != NULL){
+        if (static_mcache_load_file(xtr->static_mcache, smc_file,
+                default_rloc_afi) != GOOD){
+            return (BAD);
+        }
+    }
     return (GOOD);
 }
 
@@ -871,6 +932,29 @@ handle_config_file()
             CFG_INT("rloc-probe-interval",           0, CFGF_NONE),
             CFG_INT("rloc-probe-retries",            3, CFGF_NONE),
             CFG_INT("rloc-probe-retries-interval",   10, CFGF_NONE),
+            CFG_INT("rloc-probe-min-interval",       DEFAULT_RLOC_PROBING_MIN_INTERVAL, CFGF_NONE),
+            CFG_END()
+    };
+
+    static cfg_opt_t map_request_limits_opts[] = {
+            CFG_INT("global-rate",          DEFAULT_MAP_REQUEST_RATE,  CFGF_NONE),
+            CFG_INT("global-burst",         DEFAULT_MAP_REQUEST_BURST, CFGF_NONE),
+            CFG_INT("source-eid-rate",      DEFAULT_MAP_REQUEST_RATE,  CFGF_NONE),
+            CFG_INT("source-eid-burst",     DEFAULT_MAP_REQUEST_BURST, CFGF_NONE),
+            CFG_INT("map-resolver-rate",    DEFAULT_MAP_REQUEST_RATE,  CFGF_NONE),
+            CFG_INT("map-resolver-burst",   DEFAULT_MAP_REQUEST_BURST, CFGF_NONE),
+            CFG_END()
+    };
+
+    static cfg_opt_t data_plane_opts[] = {
+            CFG_INT("burst-size",   DATA_PLANE_DEFAULT_BURST_SIZE, CFGF_NONE),
+            CFG_INT("workers",      0, CFGF_NONE),
+            CFG_INT("tun-queues",   1, CFGF_NONE),
+            CFG_BOOL("offload",     cfg_false, CFGF_NONE),
+            CFG_INT("flow-table-size",   DATA_PLANE_DEFAULT_FLOW_TABLE_SIZE, CFGF_NONE),
+            CFG_INT("flow-idle-timeout", DATA_PLANE_DEFAULT_FLOW_IDLE_TIMEOUT, CFGF_NONE),
+            CFG_BOOL("udp-src-port-entropy", cfg_false, CFGF_NONE),
+            CFG_BOOL("ipv4-udp-checksum",    cfg_true, CFGF_NONE),
             CFG_END()
     };
 
@@ -927,13 +1011,19 @@ handle_config_file()
             CFG_SEC("ms-static-registered-site", db_mapping_opts, CFGF_MULTI),
             CFG_SEC("rtr-database-mapping", db_mapping_opts,    CFGF_MULTI),
             CFG_SEC("static-map-cache",     map_cache_mapping_opts, CFGF_MULTI),
+            CFG_STR("static-map-cache-file", 0, CFGF_NONE),
             CFG_SEC("map-server",           map_server_opts,        CFGF_MULTI),
             CFG_SEC("rtr-ifaces",           rtr_ifaces_opts,        CFGF_MULTI),
             CFG_SEC("proxy-etr-ipv4",       petr_mapping_opts,      CFGF_MULTI),
             CFG_SEC("proxy-etr-ipv6",       petr_mapping_opts,      CFGF_MULTI),
             CFG_STR("encapsulation",        "LISP",                 CFGF_NONE),
             CFG_SEC("rloc-probing",         rloc_probing_opts,      CFGF_MULTI),
+            CFG_SEC("data-plane",           data_plane_opts,        CFGF_MULTI),
             CFG_INT("map-request-retries",  0, CFGF_NONE),
+            CFG_INT("map-request-batch-window", DEFAULT_MAP_REQUEST_BATCH_WINDOW, CFGF_NONE),
+            CFG_SEC("map-request-limits",   map_request_limits_opts, CFGF_MULTI),
+            CFG_INT("map-cache-max-entries", DEFAULT_MAP_CACHE_MAX_ENTRIES, CFGF_NONE),
+            CFG_INT("map-cache-max-memory", DEFAULT_MAP_CACHE_MAX_MEMORY, CFGF_NONE),
             CFG_INT("control-port",         0, CFGF_NONE),
             CFG_INT("debug",                0, CFGF_NONE),
             CFG_STR("log-file",             0, CFGF_NONE),
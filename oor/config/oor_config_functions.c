@@ -189,7 +189,8 @@ get_no_addr_loct_from_list(glist_t *list, locator_t *locator)
     return (NULL);
 }
 void
-validate_rloc_probing_parameters(int *interval,int *retries,int *retries_int)
+validate_rloc_probing_parameters(int *interval,int *retries,int *retries_int,
+        int *min_interval)
 {
     if (*interval < 0) {
         *interval = 0;
@@ -227,7 +228,144 @@ validate_rloc_probing_parameters(int *interval,int *retries,int *retries_int)
                          OOR_MIN_RETRANSMIT_INTERVAL, *interval);
             }
         }
+
+        if (*min_interval < 0) {
+            *min_interval = 0;
+        } else if (*min_interval > *interval * 1000) {
+            *min_interval = *interval * 1000;
+            OOR_LOG(LWRN, "RLOC Probing minimum interval should be between "
+                    "0 and RLOC Probing interval. Using %d ms", *min_interval);
+        }
+        if (*min_interval > 0) {
+            OOR_LOG(LDBG_1, "RLOC Probing minimum interval: %d ms", *min_interval);
+        }
+    }
+}
+
+void
+validate_map_request_batch_window(int *window)
+{
+    if (*window < 0) {
+        *window = 0;
+    } else if (*window > MAP_REQUEST_BATCH_MAX_WINDOW) {
+        *window = MAP_REQUEST_BATCH_MAX_WINDOW;
+        OOR_LOG(LWRN, "Map-Request batch window should be between 0 and %d. "
+                "Using %d ms", MAP_REQUEST_BATCH_MAX_WINDOW,
+                MAP_REQUEST_BATCH_MAX_WINDOW);
+    }
+    if (*window > 0) {
+        OOR_LOG(LDBG_1, "Map-Request batch window: %d ms", *window);
+    }
+}
+
+static void
+validate_map_request_limit(char *level, int *rate, int *burst)
+{
+    if (*rate < 0) {
+        *rate = 0;
+    }
+    if (*rate == 0) {
+        return;
+    }
+    if (*burst < 1) {
+        *burst = 1;
+        OOR_LOG(LWRN, "Map-Request %s burst should be at least 1. "
+                "Using 1 Map-Request", level);
     }
+    OOR_LOG(LDBG_1, "Map-Request %s limit: %d per second, burst of %d",
+            level, *rate, *burst);
+}
+
+void
+validate_map_request_limits(mreq_limits_t *limits)
+{
+    validate_map_request_limit("global", &limits->global_rate,
+            &limits->global_burst);
+    validate_map_request_limit("source EID", &limits->src_eid_rate,
+            &limits->src_eid_burst);
+    validate_map_request_limit("Map Resolver", &limits->mr_rate,
+            &limits->mr_burst);
+}
+
+void
+validate_map_cache_limits(int *max_entries, int *max_memory)
+{
+    if (*max_entries < 0) {
+        *max_entries = 0;
+    }
+    if (*max_memory < 0) {
+        *max_memory = 0;
+    }
+    if (*max_entries > 0) {
+        OOR_LOG(LDBG_1, "Map cache maximum number of entries: %d", *max_entries);
+    }
+    if (*max_memory > 0) {
+        OOR_LOG(LDBG_1, "Map cache maximum memory: %d KB", *max_memory);
+    }
+}
+
+void
+validate_data_plane_parameters(data_plane_conf_t *conf)
+{
+    if (conf->burst_size < 1) {
+        conf->burst_size = 1;
+        OOR_LOG(LWRN, "Data plane burst size should be between 1 and %d. "
+                "Using 1 packet", DATA_PLANE_MAX_BURST_SIZE);
+    } else if (conf->burst_size > DATA_PLANE_MAX_BURST_SIZE) {
+        conf->burst_size = DATA_PLANE_MAX_BURST_SIZE;
+        OOR_LOG(LWRN, "Data plane burst size should be between 1 and %d. "
+                "Using %d packets", DATA_PLANE_MAX_BURST_SIZE,
+                DATA_PLANE_MAX_BURST_SIZE);
+    }
+    OOR_LOG(LDBG_1, "Data plane burst size: %d", conf->burst_size);
+
+    if (conf->workers < 0) {
+        conf->workers = 0;
+        OOR_LOG(LWRN, "Data plane workers should be between 0 and %d. "
+                "Using 0 workers", DATA_PLANE_MAX_WORKERS);
+    } else if (conf->workers > DATA_PLANE_MAX_WORKERS) {
+        conf->workers = DATA_PLANE_MAX_WORKERS;
+        OOR_LOG(LWRN, "Data plane workers should be between 0 and %d. "
+                "Using %d workers", DATA_PLANE_MAX_WORKERS,
+                DATA_PLANE_MAX_WORKERS);
+    }
+    OOR_LOG(LDBG_1, "Data plane workers: %d", conf->workers);
+
+    if (conf->tun_queues < 1) {
+        conf->tun_queues = 1;
+        OOR_LOG(LWRN, "Data plane tun queues should be between 1 and %d. "
+                "Using 1 queue", DATA_PLANE_MAX_WORKERS);
+    } else if (conf->tun_queues > DATA_PLANE_MAX_WORKERS) {
+        conf->tun_queues = DATA_PLANE_MAX_WORKERS;
+        OOR_LOG(LWRN, "Data plane tun queues should be between 1 and %d. "
+                "Using %d queues", DATA_PLANE_MAX_WORKERS,
+                DATA_PLANE_MAX_WORKERS);
+    }
+    OOR_LOG(LDBG_1, "Data plane tun queues: %d", conf->tun_queues);
+
+    if (conf->offload && conf->burst_size == 1) {
+        OOR_LOG(LWRN, "Data plane offload: With a burst size of 1 packet, "
+                "encapsulated packets are not sent with UDP segmentation offload");
+    }
+    OOR_LOG(LDBG_1, "Data plane offload: %s", conf->offload ? "on" : "off");
+
+    if (conf->flow_table_size < 1) {
+        conf->flow_table_size = DATA_PLANE_DEFAULT_FLOW_TABLE_SIZE;
+        OOR_LOG(LWRN, "Data plane flow table size should be at least 1. "
+                "Using %d flows", DATA_PLANE_DEFAULT_FLOW_TABLE_SIZE);
+    }
+    OOR_LOG(LDBG_1, "Data plane flow table size: %d", conf->flow_table_size);
+
+    if (conf->flow_idle_timeout < 0) {
+        conf->flow_idle_timeout = 0;
+        OOR_LOG(LWRN, "Data plane flow idle timeout should be positive. "
+                "Flows are not removed when idle");
+    }
+    OOR_LOG(LDBG_1, "Data plane flow idle timeout: %d", conf->flow_idle_timeout);
+    OOR_LOG(LDBG_1, "Data plane UDP source port: %s", conf->udp_src_port_entropy ?
+            "derived from the inner flow" : "port of the encapsulation");
+    OOR_LOG(LDBG_1, "Data plane IPv4 UDP checksum: %s", conf->ipv4_udp_checksum ?
+            "on" : "off");
 }
 
 int
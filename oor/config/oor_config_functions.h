@@ -22,6 +22,7 @@
 
 #include "../control/lisp_ms.h"
 #include "../control/lisp_xtr.h"
+#include "../data-plane/data-plane.h"
 #include "../lib/iface_locators.h"
 #include "../lib/lisp_site.h"
 #include "../lib/map_local_entry.h"
@@ -108,7 +109,20 @@ no_addr_loct *
 get_no_addr_loct_from_list(glist_t *list, locator_t *locator);
 
 void
-validate_rloc_probing_parameters(int *interval,int *retries,int *retries_int);
+validate_rloc_probing_parameters(int *interval,int *retries,int *retries_int,
+        int *min_interval);
+
+void
+validate_map_request_batch_window(int *window);
+
+void
+validate_map_request_limits(mreq_limits_t *limits);
+
+void
+validate_map_cache_limits(int *max_entries, int *max_memory);
+
+void
+validate_data_plane_parameters(data_plane_conf_t *conf);
 
 int
 validate_priority_weight(int p, int w);
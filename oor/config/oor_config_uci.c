@@ -87,6 +87,30 @@ parse_elp_node(
         struct uci_section      *section,
         shash_t                *ht);
 
+static void
+parse_map_request_limits(
+        struct uci_context      *ctx,
+        struct uci_section      *sect,
+        mreq_limits_t           *limits);
+
+static void
+parse_map_cache_limits(
+        struct uci_context      *ctx,
+        struct uci_section      *sect,
+        map_cache_db_t          *mc);
+
+static int
+parse_static_map_cache_file(
+        struct uci_context      *ctx,
+        struct uci_section      *sect,
+        lisp_xtr_t              *xtr);
+
+static void
+parse_data_plane_conf(
+        struct uci_context      *ctx,
+        struct uci_section      *sect,
+        data_plane_conf_t       *conf);
+
 /********************************** FUNCTIONS ********************************/
 
 int
@@ -264,6 +288,25 @@ configure_xtr(struct uci_context *ctx, struct uci_package *pck)
             sect = uci_to_section(element);
             if (strcmp(sect->type, "daemon") == 0){
 
+                /* MAP-REQUEST BATCHING */
+
+                if (uci_lookup_option_string(ctx, sect, "map_request_batch_window") != NULL){
+
+                    xtr->map_request_batch_window = strtol(uci_lookup_option_string(ctx, sect, "map_request_batch_window"),NULL,10);
+
+                }else{
+
+                    xtr->map_request_batch_window = DEFAULT_MAP_REQUEST_BATCH_WINDOW;
+
+                }
+
+                validate_map_request_batch_window(&xtr->map_request_batch_window);
+                parse_map_cache_limits(ctx, sect, xtr->map_cache);
+                if (parse_static_map_cache_file(ctx, sect, xtr) != GOOD){
+                    return (BAD);
+                }
+
+
                 /* RETRIES */
                 if (uci_lookup_option_string(ctx, sect, "map_request_retries") != NULL){
                     uci_retries = strtol(uci_lookup_option_string(ctx, sect, "map_request_retries"),NULL,10);
@@ -282,6 +325,18 @@ configure_xtr(struct uci_context *ctx, struct uci_package *pck)
                 }
             }
 
+            /* MAP-REQUEST LIMITS CONFIG */
+            if (strcmp(sect->type, "map-request-limits") == 0){
+                parse_map_request_limits(ctx, sect, &xtr->mreq_limits);
+                continue;
+            }
+
+            /* DATA PLANE CONFIG */
+            if (strcmp(sect->type, "data-plane") == 0){
+                parse_data_plane_conf(ctx, sect, &data_plane_conf);
+                continue;
+            }
+
             /* RLOC PROBING CONFIG */
 
             if (strcmp(sect->type, "rloc-probing") == 0){
@@ -308,8 +363,20 @@ configure_xtr(struct uci_context *ctx, struct uci_package *pck)
                     xtr->probe_retries_interval = DEFAULT_RLOC_PROBING_RETRIES_INTERVAL;
                 }
 
+                if (uci_lookup_option_string(ctx, sect, "rloc_probe_min_interval") != NULL){
+
+                    xtr->probe_min_interval = strtol(uci_lookup_option_string(ctx, sect, "rloc_probe_min_interval"),NULL,10);
+
+                }else{
+
+                    xtr->probe_min_interval = DEFAULT_RLOC_PROBING_MIN_INTERVAL;
+
+                }
+
+
                 validate_rloc_probing_parameters(&xtr->probe_interval,
-                        &xtr->probe_retries, &xtr->probe_retries_interval);
+                        &xtr->probe_retries, &xtr->probe_retries_interval,
+                        &xtr->probe_min_interval);
                 continue;
             }
 
@@ -591,6 +658,25 @@ configure_mn(struct uci_context *ctx, struct uci_package *pck)
         sect = uci_to_section(element);
         if (strcmp(sect->type, "daemon") == 0){
 
+            /* MAP-REQUEST BATCHING */
+
+            if (uci_lookup_option_string(ctx, sect, "map_request_batch_window") != NULL){
+
+                xtr->map_request_batch_window = strtol(uci_lookup_option_string(ctx, sect, "map_request_batch_window"),NULL,10);
+
+            }else{
+
+                xtr->map_request_batch_window = DEFAULT_MAP_REQUEST_BATCH_WINDOW;
+
+            }
+
+            validate_map_request_batch_window(&xtr->map_request_batch_window);
+            parse_map_cache_limits(ctx, sect, xtr->map_cache);
+            if (parse_static_map_cache_file(ctx, sect, xtr) != GOOD){
+                return (BAD);
+            }
+
+
             /* RETRIES */
             if (uci_lookup_option_string(ctx, sect, "map_request_retries") != NULL){
                 uci_retries = strtol(uci_lookup_option_string(ctx, sect, "map_request_retries"),NULL,10);
@@ -609,6 +695,18 @@ configure_mn(struct uci_context *ctx, struct uci_package *pck)
             }
         }
 
+        /* MAP-REQUEST LIMITS CONFIG */
+        if (strcmp(sect->type, "map-request-limits") == 0){
+            parse_map_request_limits(ctx, sect, &xtr->mreq_limits);
+            continue;
+        }
+
+        /* DATA PLANE CONFIG */
+        if (strcmp(sect->type, "data-plane") == 0){
+            parse_data_plane_conf(ctx, sect, &data_plane_conf);
+            continue;
+        }
+
         /* RLOC PROBING CONFIG */
 
         if (strcmp(sect->type, "rloc-probing") == 0){
@@ -635,8 +733,20 @@ configure_mn(struct uci_context *ctx, struct uci_package *pck)
                 xtr->probe_retries_interval = DEFAULT_RLOC_PROBING_RETRIES_INTERVAL;
             }
 
+            if (uci_lookup_option_string(ctx, sect, "rloc_probe_min_interval") != NULL){
+
+                xtr->probe_min_interval = strtol(uci_lookup_option_string(ctx, sect, "rloc_probe_min_interval"),NULL,10);
+
+            }else{
+
+                xtr->probe_min_interval = DEFAULT_RLOC_PROBING_MIN_INTERVAL;
+
+            }
+
+
             validate_rloc_probing_parameters(&xtr->probe_interval,
-                    &xtr->probe_retries, &xtr->probe_retries_interval);
+                    &xtr->probe_retries, &xtr->probe_retries_interval,
+                    &xtr->probe_min_interval);
             continue;
         }
 
@@ -895,6 +1005,25 @@ configure_rtr(struct uci_context *ctx, struct uci_package *pck)
         sect = uci_to_section(element);
         if (strcmp(sect->type, "daemon") == 0){
 
+            /* MAP-REQUEST BATCHING */
+
+            if (uci_lookup_option_string(ctx, sect, "map_request_batch_window") != NULL){
+
+                xtr->map_request_batch_window = strtol(uci_lookup_option_string(ctx, sect, "map_request_batch_window"),NULL,10);
+
+            }else{
+
+                xtr->map_request_batch_window = DEFAULT_MAP_REQUEST_BATCH_WINDOW;
+
+            }
+
+            validate_map_request_batch_window(&xtr->map_request_batch_window);
+            parse_map_cache_limits(ctx, sect, xtr->map_cache);
+            if (parse_static_map_cache_file(ctx, sect, xtr) != GOOD){
+                return (BAD);
+            }
+
+
             /* RETRIES */
             if (uci_lookup_option_string(ctx, sect, "map_request_retries") != NULL){
                 uci_retries = strtol(uci_lookup_option_string(ctx, sect, "map_request_retries"),NULL,10);
@@ -913,6 +1042,18 @@ configure_rtr(struct uci_context *ctx, struct uci_package *pck)
             }
         }
 
+        /* MAP-REQUEST LIMITS CONFIG */
+        if (strcmp(sect->type, "map-request-limits") == 0){
+            parse_map_request_limits(ctx, sect, &xtr->mreq_limits);
+            continue;
+        }
+
+        /* DATA PLANE CONFIG */
+        if (strcmp(sect->type, "data-plane") == 0){
+            parse_data_plane_conf(ctx, sect, &data_plane_conf);
+            continue;
+        }
+
         /* RLOC PROBING CONFIG */
 
         if (strcmp(sect->type, "rloc-probing") == 0){
@@ -939,8 +1080,20 @@ configure_rtr(struct uci_context *ctx, struct uci_package *pck)
                 xtr->probe_retries_interval = DEFAULT_RLOC_PROBING_RETRIES_INTERVAL;
             }
 
+            if (uci_lookup_option_string(ctx, sect, "rloc_probe_min_interval") != NULL){
+
+                xtr->probe_min_interval = strtol(uci_lookup_option_string(ctx, sect, "rloc_probe_min_interval"),NULL,10);
+
+            }else{
+
+                xtr->probe_min_interval = DEFAULT_RLOC_PROBING_MIN_INTERVAL;
+
+            }
+
+
             validate_rloc_probing_parameters(&xtr->probe_interval,
-                    &xtr->probe_retries, &xtr->probe_retries_interval);
+                    &xtr->probe_retries, &xtr->probe_retries_interval,
+                    &xtr->probe_min_interval);
             continue;
         }
 
@@ -1660,3 +1813,81 @@ parse_elp_node(struct uci_context *ctx, struct uci_section *section, shash_t *ht
     return (GOOD);
 }
 
+
+static void
+parse_map_request_limits(struct uci_context *ctx, struct uci_section *sect,
+        mreq_limits_t *limits)
+{
+    const char *val;
+
+    val = uci_lookup_option_string(ctx, sect, "global_rate");
+    limits->global_rate = val ? strtol(val,NULL,10) : DEFAULT_MAP_REQUEST_RATE;
+    val = uci_lookup_option_string(ctx, sect, "global_burst");
+    limits->global_burst = val ? strtol(val,NULL,10) : DEFAULT_MAP_REQUEST_BURST;
+    val = uci_lookup_option_string(ctx, sect, "source_eid_rate");
+    limits->src_eid_rate = val ? strtol(val,NULL,10) : DEFAULT_MAP_REQUEST_RATE;
+    val = uci_lookup_option_string(ctx, sect, "source_eid_burst");
+    limits->src_eid_burst = val ? strtol(val,NULL,10) : DEFAULT_MAP_REQUEST_BURST;
+    val = uci_lookup_option_string(ctx, sect, "map_resolver_rate");
+    limits->mr_rate = val ? strtol(val,NULL,10) : DEFAULT_MAP_REQUEST_RATE;
+    val = uci_lookup_option_string(ctx, sect, "map_resolver_burst");
+    limits->mr_burst = val ? strtol(val,NULL,10) : DEFAULT_MAP_REQUEST_BURST;
+
+    validate_map_request_limits(limits);
+}
+
+static void
+parse_map_cache_limits(struct uci_context *ctx, struct uci_section *sect,
+        map_cache_db_t *mc)
+{
+    const char *val;
+    int max_entries, max_memory;
+
+    val = uci_lookup_option_string(ctx, sect, "map_cache_max_entries");
+    max_entries = val ? strtol(val,NULL,10) : DEFAULT_MAP_CACHE_MAX_ENTRIES;
+    val = uci_lookup_option_string(ctx, sect, "map_cache_max_memory");
+    max_memory = val ? strtol(val,NULL,10) : DEFAULT_MAP_CACHE_MAX_MEMORY;
+
+    validate_map_cache_limits(&max_entries, &max_memory);
+    mcache_set_limits(mc, max_entries, (size_t)max_memory * 1024);
+}
+
+static void
+parse_data_plane_conf(struct uci_context *ctx, struct uci_section *sect,
+        data_plane_conf_t *conf)
+{
+    const char *val;
+
+    val = uci_lookup_option_string(ctx, sect, "burst_size");
+    conf->burst_size = val ? strtol(val,NULL,10) : DATA_PLANE_DEFAULT_BURST_SIZE;
+    val = uci_lookup_option_string(ctx, sect, "workers");
+    conf->workers = val ? strtol(val,NULL,10) : 0;
+    val = uci_lookup_option_string(ctx, sect, "tun_queues");
+    conf->tun_queues = val ? strtol(val,NULL,10) : 1;
+    val = uci_lookup_option_string(ctx, sect, "offload");
+    conf->offload = (val && strcmp(val, "on") == 0) ? TRUE : FALSE;
+    val = uci_lookup_option_string(ctx, sect, "flow_table_size");
+    conf->flow_table_size = val ? strtol(val,NULL,10) : DATA_PLANE_DEFAULT_FLOW_TABLE_SIZE;
+    val = uci_lookup_option_string(ctx, sect, "flow_idle_timeout");
+    conf->flow_idle_timeout = val ? strtol(val,NULL,10) : DATA_PLANE_DEFAULT_FLOW_IDLE_TIMEOUT;
+    val = uci_lookup_option_string(ctx, sect, "udp_src_port_entropy");
+    conf->udp_src_port_entropy = (val && strcmp(val, "on") == 0) ? TRUE : FALSE;
+    val = uci_lookup_option_string(ctx, sect, "ipv4_udp_checksum");
+    conf->ipv4_udp_checksum = (val && strcmp(val, "off") == 0) ? FALSE : TRUE;
+
+    validate_data_plane_parameters(conf);
+}
+
+static int
+parse_static_map_cache_file(struct uci_context *ctx, struct uci_section *sect,
+        lisp_xtr_t *xtr)
+{
+    const char *file;
+
+    file = uci_lookup_option_string(ctx, sect, "static_map_cache_file");
+    if (!file){
+        return (GOOD);
+    }
+    return (static_mcache_load_file(xtr->static_mcache, (char *)file,
+            default_rloc_afi));
+}
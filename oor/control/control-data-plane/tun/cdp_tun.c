@@ -83,12 +83,14 @@ tun_control_dp_init(oor_ctrl_t *ctrl, ...)
     /* Generate receive sockets for control port (4342)*/
     if (default_rloc_afi != AF_INET6) {
         socket = open_control_input_socket(AF_INET);
-        sockmstr_register_read_listener(smaster, tun_control_dp_recv_msg, ctrl,socket);
+        sockmstr_register_read_listener_prio(smaster, tun_control_dp_recv_msg, ctrl,socket,
+                SOCK_PRIO_HIGH);
     }
 
     if (default_rloc_afi != AF_INET) {
         socket = open_control_input_socket(AF_INET6);
-        sockmstr_register_read_listener(smaster, tun_control_dp_recv_msg, ctrl,socket);
+        sockmstr_register_read_listener_prio(smaster, tun_control_dp_recv_msg, ctrl,socket,
+                SOCK_PRIO_HIGH);
     }
 
     data = (tun_ctr_dplane_data_t *)xmalloc(sizeof(tun_ctr_dplane_data_t));
@@ -84,7 +84,8 @@ vpnapi_control_dp_init(oor_ctrl_t *ctrl, ...)
     /* Generate receive sockets for control port (4342)*/
     if (default_rloc_afi != AF_INET6) {
         data->ipv4_ctrl_socket = open_control_input_socket(AF_INET);
-        sockmstr_register_read_listener(smaster, vpnapi_control_dp_recv_msg, ctrl,data->ipv4_ctrl_socket);
+        sockmstr_register_read_listener_prio(smaster, vpnapi_control_dp_recv_msg, ctrl,
+                data->ipv4_ctrl_socket, SOCK_PRIO_HIGH);
         oor_jni_protect_socket(data->ipv4_ctrl_socket);
         sock =  sockmstr_register_get_by_bind_port (smaster, AF_INET, LISP_DATA_PORT);
         if (sock != NULL){
@@ -96,7 +97,8 @@ vpnapi_control_dp_init(oor_ctrl_t *ctrl, ...)
 
     if (default_rloc_afi != AF_INET) {
         data->ipv6_ctrl_socket = open_control_input_socket(AF_INET6);
-        sockmstr_register_read_listener(smaster, vpnapi_control_dp_recv_msg, ctrl,data->ipv6_ctrl_socket);
+        sockmstr_register_read_listener_prio(smaster, vpnapi_control_dp_recv_msg, ctrl,
+                data->ipv6_ctrl_socket, SOCK_PRIO_HIGH);
         oor_jni_protect_socket(data->ipv6_ctrl_socket);
     }else {
         data->ipv6_ctrl_socket = ERR_SOCKET;
@@ -377,7 +379,8 @@ vpnapi_control_dp_reset_socket(vpnapi_ctr_dplane_data_t * data, int fd, int afi)
         return (BAD);
     }
 
-    sockmstr_register_read_listener(smaster,old_sock->recv_cb,old_sock->arg,new_fd);
+    sockmstr_register_read_listener_prio(smaster,old_sock->recv_cb,old_sock->arg,new_fd,
+            old_sock->prio);
     sockmstr_unregister_read_listenedr(smaster,old_sock);
     /* Protect the socket from loops in the system*/
     oor_jni_protect_socket(new_fd);
@@ -103,7 +103,8 @@ vpp_control_dp_init(oor_ctrl_t *ctrl,...)
     OOR_LOG(LDBG_1,"VPP: Enabled OOR Ctrl plugin");
 
     /* Register socket */
-    sockmstr_register_read_listener(smaster, vpp_control_dp_recv_msg, ctrl,tap_fd);
+    sockmstr_register_read_listener_prio(smaster, vpp_control_dp_recv_msg, ctrl,tap_fd,
+            SOCK_PRIO_HIGH);
 
     data = (vpp_ctr_dplane_data_t *)xmalloc(sizeof(vpp_ctr_dplane_data_t));
     if (!data){
@@ -198,6 +198,7 @@ ms_recv_map_request(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
     lisp_addr_t *   deid        = NULL;
     mapping_t *     map         = NULL;
     glist_t *       itr_rlocs   = NULL;
+    glist_t *       fwd_maps    = NULL;
     void *          mreq_hdr    = NULL;
     void *          mrep_hdr    = NULL;
     mapping_record_hdr_t *  rec            = NULL;
@@ -234,6 +235,7 @@ ms_recv_map_request(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
     /* PROCESS ITR RLOCs */
     itr_rlocs = laddr_list_new();
     lisp_msg_parse_itr_rlocs(&b, itr_rlocs);
+    fwd_maps = glist_new();
 
     for (i = 0; i < MREQ_REC_COUNT(mreq_hdr); i++) {
         deid = lisp_addr_new();
@@ -263,6 +265,7 @@ ms_recv_map_request(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
                     lisp_addr_to_char(deid));
             send_msg(&ms->super, mrep, uc);
             lisp_msg_destroy(mrep);
+            mrep = NULL;
             lisp_addr_del(deid);
 
             continue;
@@ -279,6 +282,7 @@ ms_recv_map_request(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
                     lisp_addr_to_char(deid));
             send_msg(&ms->super, mrep, uc);
             lisp_msg_destroy(mrep);
+            mrep = NULL;
             lisp_addr_del(deid);
             continue;
         }
@@ -288,9 +292,15 @@ ms_recv_map_request(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
 
         /* IF *NOT* PROXY REPLY: forward the message to an xTR */
         if (site != NULL && site->proxy_reply == FALSE) {
+            /* The ETR replies to all the records of its site, and skips the
+             * ones of other sites, so the message is forwarded once */
+            if (glist_contain(map, fwd_maps)){
+                lisp_addr_del(deid);
+                continue;
+            }
+            glist_add(map, fwd_maps);
             /* FIXME: once locs become one object, send that instead of mapping */
             forward_mreq(ms, buf, map);
-            lisp_msg_destroy(mrep);
             lisp_addr_del(deid);
             continue;
         }
@@ -314,15 +324,18 @@ ms_recv_map_request(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
             OOR_LOG(LDBG_1, "Couldn't send Map-Reply!");
         }
         lisp_msg_destroy(mrep);
+        mrep = NULL;
         lisp_addr_del(deid);
     }
 
     glist_destroy(itr_rlocs);
+    glist_destroy(fwd_maps);
     lisp_addr_del(seid);
 
     return(GOOD);
 err:
     glist_destroy(itr_rlocs);
+    glist_destroy(fwd_maps);
     lisp_msg_destroy(mrep);
     lisp_addr_del(deid);
     lisp_addr_del(seid);
@@ -650,6 +663,9 @@ ms_ctrl_construct(oor_ctrl_dev_t *dev)
     if (!ms->reg_sites_db || !ms->lisp_sites_db) {
         return(BAD);
     }
+    /* Both databases are looked up for each Map-Request */
+    mdb_enable_lpm(ms->reg_sites_db);
+    mdb_enable_lpm(ms->lisp_sites_db);
 
     OOR_LOG(LDBG_1, "Finished Constructing Map-Server");
 
@@ -17,20 +17,28 @@
  *
  */
 
+#include <time.h>
 #include <unistd.h>
 
 #include "../lib/iface_locators.h"
 #include "../lib/sockets.h"
 #include "../lib/mem_util.h"
 #include "../lib/oor_log.h"
+#include "../lib/prefixes.h"
 #include "../lib/timers_utils.h"
 #include "../lib/util.h"
 #include "lisp_xtr.h"
 
 static int mc_entry_expiration_timer_cb(oor_timer_t *t);
+static int mc_entry_refresh_timer_cb(oor_timer_t *t);
+static int mc_entry_refresh_map_request_cb(oor_timer_t *t);
+static int tr_mcache_make_room(lisp_xtr_t *xtr, size_t size);
+static int tr_mcache_load_static_entry(lisp_xtr_t *xtr, uint32_t iid,
+        lisp_addr_t *eid, mcache_entry_t *mce);
 static void mc_entry_start_expiration_timer(lisp_xtr_t *, mcache_entry_t *);
 static void mc_entry_start_expiration_timer2(lisp_xtr_t *xtr, mcache_entry_t *mce, int time);
-static int handle_locator_probe_reply(lisp_xtr_t *, mcache_entry_t *, lisp_addr_t *);
+static int handle_locator_probe_reply(lisp_xtr_t *, rloc_probe_t *,
+        nonces_list_t *);
 static int update_mcache_entry(lisp_xtr_t *, mapping_t *);
 static int tr_recv_map_reply(lisp_xtr_t *, lbuf_t *, uconn_t *);
 static int tr_reply_to_smr(lisp_xtr_t *xtr, lisp_addr_t *src_eid, lisp_addr_t *req_eid);
@@ -55,15 +63,27 @@ static int send_smr_invoked_map_request(lisp_xtr_t *xtr, lisp_addr_t *src_eid,
 static int program_smr(lisp_xtr_t *, int time);
 static int send_map_request_retry_cb(oor_timer_t *timer);
 static int build_and_send_encap_map_request(lisp_xtr_t *xtr, lisp_addr_t *src_eid,
-        mcache_entry_t *mce, uint64_t nonce);
+        glist_t *deids, uint64_t nonce);
+static int mreq_batch_add(lisp_xtr_t *xtr, lisp_addr_t *src_eid, uint64_t nonce);
+static int mreq_batch_send(lisp_xtr_t *xtr, mreq_batch_t *batch);
+static int mreq_batch_cb(oor_timer_t *timer);
+static int mreq_batch_recv_map_reply(lisp_xtr_t *xtr, lbuf_t *b, int records,
+        oor_timer_t *timer);
 static int build_and_send_map_reg(lisp_xtr_t *, mapping_t *, map_server_elt *,
         uint64_t);
 int program_map_register_for_mapping(lisp_xtr_t *xtr, map_local_entry_t *mle);
 static int encap_map_register_cb(oor_timer_t *timer);
 int program_encap_map_reg_of_loct_for_map(lisp_xtr_t *xtr, map_local_entry_t *mle,
         locator_t *src_loct);
-static int rloc_probing(lisp_xtr_t *, mapping_t *, locator_t *loc, uint64_t nonce);
-static void program_rloc_probing(lisp_xtr_t *, mcache_entry_t *, locator_t *, int);
+static int rloc_probing(lisp_xtr_t *, lisp_addr_t *deid, lisp_addr_t *drloc,
+        uint64_t nonce);
+static void program_rloc_probing(lisp_xtr_t *, mcache_entry_t *, locator_t *);
+static int rloc_probing_retries_interval(lisp_xtr_t *, locator_probe_inf_t *);
+static int rloc_probing_update_inf(lisp_xtr_t *, locator_probe_inf_t *, int, int, int);
+static void rloc_probing_update_rtt(locator_probe_inf_t *, uint64_t);
+static locator_t *rloc_probe_mce_locator(lisp_xtr_t *, rloc_probe_t *,
+        mcache_entry_t *, lisp_addr_t *);
+static int rloc_probe_update_mces(lisp_xtr_t *, rloc_probe_t *);
 static void program_mce_rloc_probing(lisp_xtr_t *, mcache_entry_t *);
 static inline lisp_xtr_t *lisp_xtr_cast(oor_ctrl_dev_t *);
 int map_reply_fill_uconn(lisp_xtr_t *xtr, glist_t *itr_rlocs, uconn_t *uc);
@@ -81,9 +101,9 @@ static lisp_addr_t * get_map_resolver(lisp_xtr_t *xtr);
 mcache_entry_t *get_proxy_etrs_for_afi(lisp_xtr_t *xtr, int afi);
 
 static int mapping_has_elp_with_l_bit(mapping_t *map);
-/* Funtions related to timer_rloc_probe_argument */
-timer_rloc_probe_argument *timer_rloc_probe_argument_new_init(mcache_entry_t *mce,
-        locator_t *locator);
+/* Funtions related to rloc_probe_t */
+rloc_probe_t *rloc_probe_new_init(lisp_addr_t *addr, pkt_eid_key_t *key,
+        uint8_t state);
 int xtr_if_link_update(oor_ctrl_dev_t *dev, char *iface_name, uint8_t status);
 int xtr_if_addr_update(oor_ctrl_dev_t *dev, char *iface_name,
         lisp_addr_t *old_addr, lisp_addr_t *new_addr, uint8_t status);
@@ -91,7 +111,12 @@ int xtr_route_update(oor_ctrl_dev_t *dev, int command, char *iface_name ,
         lisp_addr_t *src_pref, lisp_addr_t *dst_pref, lisp_addr_t *gateway);
 int xtr_iface_event_signaling(lisp_xtr_t * xtr, iface_locators * if_loct);
 
-void timer_rloc_probe_argument_free(timer_rloc_probe_argument *timer_arg);
+void rloc_probe_del(rloc_probe_t *rp);
+static void rloc_probe_remove(lisp_xtr_t *xtr, rloc_probe_t *rp);
+static void rloc_probing_forget_mce(lisp_xtr_t *xtr, mcache_entry_t *mce);
+/* Funtions related to mreq_batch_t */
+mreq_batch_t *mreq_batch_new_init(lisp_addr_t *map_resolver, lisp_addr_t *src_eid);
+void mreq_batch_del(mreq_batch_t *batch);
 /* Funtions related to timer_map_req_argument */
 timer_map_req_argument *timer_map_req_arg_new_init(mcache_entry_t *mce,
         lisp_addr_t *src_eid);
@@ -129,6 +154,97 @@ mc_entry_expiration_timer_cb(oor_timer_t *timer)
     return(GOOD);
 }
 
+/* Called some time before the expiration of an entry. The entries used during
+ * their TTL are refreshed with a Map-Request. The Map-Reply replaces the
+ * mapping of the entry without removing it from the cache */
+static int
+mc_entry_refresh_timer_cb(oor_timer_t *timer)
+{
+    mcache_entry_t *mce = oor_timer_cb_argument(timer);
+    lisp_xtr_t *xtr = oor_timer_owner(timer);
+    lisp_addr_t *eid = mapping_eid(mcache_entry_mapping(mce));
+    lisp_addr_t *src_eid;
+    timer_map_req_argument *timer_arg;
+    oor_timer_t *mreq_timer;
+    time_t last_used;
+    int period;
+
+    stop_timer_from_obj(mce, timer, ptrs_to_timers_ht, nonces_ht);
+
+    /* New flows using the entry are notified by tr_get_fwd_entry. The
+     * existing ones are obtained from the data plane */
+    period = mapping_ttl(mcache_entry_mapping(mce))*60*MAP_CACHE_REFRESH_PERCENT/100;
+    last_used = datap_fwd_entry_last_used(&xtr->super, eid);
+    if (last_used != 0 && last_used >= time(NULL) - period){
+        mce->active_witin_period = TRUE;
+    }
+    if (!mce->active_witin_period){
+        OOR_LOG(LDBG_2, "The map cache entry of EID %s has not been used. "
+                "It will not be refreshed", lisp_addr_to_char(eid));
+        return (GOOD);
+    }
+
+    /* Same source EID than the SMR invoked Map-Requests */
+    src_eid = local_map_db_get_main_eid(xtr->local_mdb, lisp_addr_ip_afi(eid));
+    if (src_eid == NULL){
+        src_eid = ctrl_default_rloc(ctrl_dev_get_ctrl_t(&(xtr->super)),
+                lisp_addr_ip_afi(eid));
+        if (src_eid == NULL){
+            OOR_LOG(LDBG_1, "Couldn't refresh the map cache entry of EID %s. "
+                    "No source address available", lisp_addr_to_char(eid));
+            return (BAD);
+        }
+    }
+
+    OOR_LOG(LDBG_1, "Refreshing the map cache entry of EID %s",
+            lisp_addr_to_char(eid));
+    timer_arg = timer_map_req_arg_new_init(mce, src_eid);
+    mreq_timer = oor_timer_with_nonce_new(MAP_REQUEST_RETRY_TIMER, xtr,
+            mc_entry_refresh_map_request_cb, timer_arg,
+            (oor_timer_del_cb_arg_fn)timer_map_req_arg_free);
+    htable_ptrs_timers_add(ptrs_to_timers_ht, mce, mreq_timer);
+
+    return (mc_entry_refresh_map_request_cb(mreq_timer));
+}
+
+/* Send the Map-Requests refreshing an active entry. Without reply, the entry
+ * is kept until it expires */
+static int
+mc_entry_refresh_map_request_cb(oor_timer_t *timer)
+{
+    timer_map_req_argument *timer_arg = (timer_map_req_argument *)oor_timer_cb_argument(timer);
+    nonces_list_t *nonces_list = oor_timer_nonces(timer);
+    lisp_xtr_t *xtr = oor_timer_owner(timer);
+    mcache_entry_t *mce = timer_arg->mce;
+    lisp_addr_t *deid = mapping_eid(mcache_entry_mapping(mce));
+    int retries = nonces_list_size(nonces_list);
+    glist_t *deids;
+    uint64_t nonce;
+    int ret;
+
+    if (retries - 1 >= xtr->map_request_retries) {
+        OOR_LOG(LDBG_1, "No Map-Reply refreshing EID %s after %d retries. "
+                "Keeping the current mapping", lisp_addr_to_char(deid),
+                retries - 1);
+        stop_timer_from_obj(mce, timer, ptrs_to_timers_ht, nonces_ht);
+        return (ERR_NO_REPLY);
+    }
+
+    nonce = nonce_new();
+    deids = glist_new();
+    glist_add(deid, deids);
+    ret = build_and_send_encap_map_request(xtr, timer_arg->src_eid, deids, nonce);
+    glist_destroy(deids);
+    if (ret != GOOD){
+        stop_timer_from_obj(mce, timer, ptrs_to_timers_ht, nonces_ht);
+        return (BAD);
+    }
+    htable_nonces_insert(nonces_ht, nonce, nonces_list);
+    oor_timer_start(timer, OOR_INITIAL_MRQ_TIMEOUT);
+
+    return (GOOD);
+}
+
 static void
 mc_entry_start_expiration_timer(lisp_xtr_t *xtr, mcache_entry_t *mce)
 {
@@ -141,6 +257,14 @@ mc_entry_start_expiration_timer2(lisp_xtr_t *xtr, mcache_entry_t *mce, int time)
 {
     /* Expiration cache timer */
     oor_timer_t *timer;
+    int refresh;
+
+    /* Timers of the previous mapping of the entry */
+    stop_timers_of_type_from_obj(mce, EXPIRE_MAP_CACHE_TIMER, ptrs_to_timers_ht,
+            nonces_ht);
+    stop_timers_of_type_from_obj(mce, REFRESH_MAP_CACHE_TIMER, ptrs_to_timers_ht,
+            nonces_ht);
+    mce->active_witin_period = FALSE;
 
     timer = oor_timer_create(EXPIRE_MAP_CACHE_TIMER);
     oor_timer_init(timer,xtr,mc_entry_expiration_timer_cb,mce,NULL,NULL);
@@ -155,46 +279,55 @@ mc_entry_start_expiration_timer2(lisp_xtr_t *xtr, mcache_entry_t *mce, int time)
         OOR_LOG(LDBG_1,"The map cache entry of EID %s will expire in %d seconds.",
                 lisp_addr_to_char(mapping_eid(mcache_entry_mapping(mce))),time);
     }
+
+    /* Entries used during their TTL are refreshed before they expire */
+    refresh = time * MAP_CACHE_REFRESH_PERCENT / 100;
+    if (mcache_entry_active(mce) == ACTIVE && mce->how_learned == MCE_DYNAMIC
+            && refresh > 0){
+        timer = oor_timer_create(REFRESH_MAP_CACHE_TIMER);
+        oor_timer_init(timer,xtr,mc_entry_refresh_timer_cb,mce,NULL,NULL);
+        htable_ptrs_timers_add(ptrs_to_timers_ht, mce, timer);
+        oor_timer_start(timer, refresh);
+    }
 }
 
-/* Process a record from map-reply probe message */
+/* Process the reply to a probe of a RLOC. The state and the metrics of the
+ * RLOC are updated in all the map cache entries using it */
 static int
-handle_locator_probe_reply(lisp_xtr_t *xtr, mcache_entry_t *mce,
-        lisp_addr_t *probed_addr)
+handle_locator_probe_reply(lisp_xtr_t *xtr, rloc_probe_t *rp,
+        nonces_list_t *nonces_lst)
 {
-    locator_t * loct = NULL;
-    mapping_t * map = NULL;
-
-    map = mcache_entry_mapping(mce);
-    loct = mapping_get_loct_with_addr(map, probed_addr);
-
+    int probes, interval, changed = FALSE;
 
-    if (!loct){
-        OOR_LOG(LDBG_2,"Probed locator %s not part of the the mapping %s",
-                lisp_addr_to_char(probed_addr),
-                lisp_addr_to_char(mapping_eid(map)));
-        return (ERR_NO_EXIST);
+    /* The RTT is only measured when the reply can only be for the last probe */
+    probes = nonces_list_size(nonces_lst);
+    if (probes == 1) {
+        rloc_probing_update_rtt(&rp->inf, oor_timer_clock_us());
     }
 
+    OOR_LOG(LDBG_1," Successfully probed RLOC %s (RTT: %u us)",
+            lisp_addr_to_char(rp->addr), rp->inf.srtt);
 
-    OOR_LOG(LDBG_1," Successfully probed RLOC %s of cache entry with EID %s",
-                lisp_addr_to_char(locator_addr(loct)),
-                lisp_addr_to_char(mapping_eid(map)));
-
-
-    if (loct->state == DOWN) {
-        loct->state = UP;
+    if (rp->state == DOWN) {
+        rp->state = UP;
+        changed = TRUE;
 
         OOR_LOG(LDBG_1," Locator %s state changed to UP",
-                lisp_addr_to_char(locator_addr(loct)));
+                lisp_addr_to_char(rp->addr));
+    }
+    interval = rloc_probing_update_inf(xtr, &rp->inf, probes - 1, 1, changed);
 
-        /* [re]Calculate forwarding info if status changed*/
-        xtr->fwd_policy->updated_map_cache_inf(xtr->fwd_policy_dev_parm,mce);
-        notify_datap_rm_fwd_from_entry(&(xtr->super),mapping_eid(map),FALSE);
+    /* [re]Calculate forwarding info of the entries if status changed */
+    if (rloc_probe_update_mces(xtr, rp) == 0) {
+        OOR_LOG(LDBG_2,"RLOC %s not used anymore. Stop probing it",
+                lisp_addr_to_char(rp->addr));
+        rloc_probe_remove(xtr, rp);
+        return (GOOD);
     }
 
-    /* Reprogramming timers of rloc probing */
-    program_rloc_probing(xtr, mce, loct, xtr->probe_interval);
+    /* Reprogramming timer of rloc probing */
+    htable_nonces_reset_nonces_lst(nonces_ht, nonces_lst);
+    oor_timer_start_ms(rp->timer, interval);
 
     return (GOOD);
 
@@ -224,6 +357,7 @@ update_mcache_entry(lisp_xtr_t *xtr, mapping_t *recv_map)
 
     /* DISCARD all locator state */
     mapping_update_locators(map, mapping_locators_lists(recv_map));
+    mcache_update_entry_size(xtr->map_cache, mce);
 
     /* Update forwarding info */
     xtr->fwd_policy->updated_map_cache_inf(xtr->fwd_policy_dev_parm,mce);
@@ -243,8 +377,7 @@ tr_recv_map_reply(lisp_xtr_t *xtr, lbuf_t *buf, uconn_t *udp_con)
 {
     void *mrep_hdr;
     locator_t *probed;
-    lisp_addr_t *probed_addr;
-    mapping_t *m, *aux_m;
+    mapping_t *m;
     lbuf_t b;
     mcache_entry_t *mce;
     nonces_list_t *nonces_lst;
@@ -267,6 +400,10 @@ tr_recv_map_reply(lisp_xtr_t *xtr, lbuf_t *buf, uconn_t *udp_con)
     timer = nonces_list_timer(nonces_lst);
     /* If it is not a Map Reply Probe */
     if (!MREP_RLOC_PROBE(mrep_hdr)){
+        if (oor_timer_type(timer) == MAP_REQUEST_BATCH_TIMER){
+            return (mreq_batch_recv_map_reply(xtr, &b, MREP_REC_COUNT(mrep_hdr),
+                    timer));
+        }
         t_mr_arg = (timer_map_req_argument *)oor_timer_cb_argument(timer);
         /* We only accept one record except when the nonce is generated by a not active entry */
         mce = t_mr_arg->mce;
@@ -325,29 +462,16 @@ tr_recv_map_reply(lisp_xtr_t *xtr, lbuf_t *buf, uconn_t *udp_con)
                 goto err;
             }
 
-            if (probed != NULL){
-                probed_addr = locator_addr(probed);
-            }else{
-                probed_addr = &(udp_con->ra);
-            }
-
-            mce = mcache_lookup_exact(xtr->map_cache, mapping_eid(m));
-            if (!mce){
-                /* Check if the map reply probe is from a proxy */
-                mce = get_proxy_etrs_for_afi(xtr, lisp_addr_ip_afi(mapping_eid(m)));
-                if (mce) {
-                    aux_m = mcache_entry_mapping(mce);
-                    if (lisp_addr_cmp(mapping_eid(m),mapping_eid(aux_m)) != 0){
-                        OOR_LOG(LDBG_2,"Received a non requested Map Reply probe");
-                        return (BAD);
-                    }
-                }else{
-                    OOR_LOG(LDBG_2,"Received a non requested Map Reply probe");
-                    return (BAD);
-                }
+            /* The probed RLOC is identified by the nonce */
+            if (oor_timer_type(timer) != RLOC_PROBING_TIMER){
+                OOR_LOG(LDBG_2,"Received a non requested Map Reply probe");
+                mapping_del(m);
+                return (BAD);
             }
-
-            handle_locator_probe_reply(xtr, mce, probed_addr);
+            handle_locator_probe_reply(xtr, oor_timer_cb_argument(timer),
+                    nonces_lst);
+            /* The timer is reused to program the next probe */
+            timer = NULL;
 
             /* No need to free 'probed' since it's a pointer to a locator in
              * of m's */
@@ -401,6 +525,7 @@ tr_recv_map_request(lisp_xtr_t *xtr, lbuf_t *buf, uconn_t *uc)
     map_local_entry_t *map_loc_e = NULL;
     mapping_t *map = NULL;
     glist_t *itr_rlocs = NULL;
+    glist_t *put_maps = NULL;
     void *mreq_hdr = NULL;
     void *mrep_hdr = NULL;
     int i = 0;
@@ -412,6 +537,7 @@ tr_recv_map_request(lisp_xtr_t *xtr, lbuf_t *buf, uconn_t *uc)
 
     seid = lisp_addr_new();
     deid = lisp_addr_new();
+    put_maps = glist_new();
 
     mreq_hdr = lisp_msg_pull_hdr(&b);
 
@@ -446,14 +572,21 @@ tr_recv_map_request(lisp_xtr_t *xtr, lbuf_t *buf, uconn_t *uc)
 
 
         if (xtr->super.mode == xTR_MODE || xtr->super.mode == MN_MODE) {
-            /* Check the existence of the requested EID */
+            /* Check the existence of the requested EID. A Map-Request with
+             * several records could include EIDs of other sites, forwarded by
+             * the Map-Server to each of them */
             map_loc_e = local_map_db_lookup_eid(xtr->local_mdb, deid, TRUE);
             if (!map_loc_e) {
                 OOR_LOG(LDBG_1,"EID %s not locally configured!",
                         lisp_addr_to_char(deid));
-                goto err;
+                continue;
             }
             map = map_local_entry_mapping(map_loc_e);
+            /* Several requested EIDs could belong to the same prefix */
+            if (glist_contain(map, put_maps)){
+                continue;
+            }
+            glist_add(map, put_maps);
             lisp_msg_put_mapping(mrep, map, MREQ_RLOC_PROBE(mreq_hdr)
                     ? &uc->la: NULL);
         }else if (xtr->super.mode == RTR_MODE &&
@@ -472,6 +605,11 @@ tr_recv_map_request(lisp_xtr_t *xtr, lbuf_t *buf, uconn_t *uc)
         }
     }
     mrep_hdr = lisp_msg_hdr(mrep);
+    if (MREP_REC_COUNT(mrep_hdr) == 0){
+        OOR_LOG(LDBG_1, "None of the requested EIDs is locally configured. "
+                "Discarding Map-Request");
+        goto err;
+    }
     MREP_RLOC_PROBE(mrep_hdr) = MREQ_RLOC_PROBE(mreq_hdr);
     MREP_NONCE(mrep_hdr) = MREQ_NONCE(mreq_hdr);
 
@@ -485,12 +623,14 @@ tr_recv_map_request(lisp_xtr_t *xtr, lbuf_t *buf, uconn_t *uc)
 
 done:
     glist_destroy(itr_rlocs);
+    glist_destroy(put_maps);
     lisp_msg_destroy(mrep);
     lisp_addr_del(seid);
     lisp_addr_del(deid);
     return(GOOD);
 err:
     glist_destroy(itr_rlocs);
+    glist_destroy(put_maps);
     lisp_msg_destroy(mrep);
     lisp_addr_del(seid);
     lisp_addr_del(deid);
@@ -834,6 +974,129 @@ tr_recv_map_notify(lisp_xtr_t *xtr, lbuf_t *buf)
 }
 
 
+static void
+mreq_limits_table_init(mreq_limits_table_t *table)
+{
+    table->htable = kh_init(mreq_buckets);
+    list_init(&table->lru);
+}
+
+static void
+mreq_limits_table_uninit(mreq_limits_table_t *table)
+{
+    mreq_limits_bucket_t *bucket, *next;
+
+    LIST_FOR_EACH_SAFE (bucket, next, lru_node, &table->lru) {
+        free(bucket);
+    }
+    kh_destroy(mreq_buckets, table->htable);
+}
+
+/* Return the bucket of 'addr' in 'table', creating it if it doesn't exist.
+ * Returns NULL if the address is not IP, so it is not limited */
+static token_bucket_t *
+mreq_limits_get_bucket(mreq_limits_table_t *table, lisp_addr_t *addr,
+        int rate, int burst, uint64_t now)
+{
+    mreq_limits_bucket_t *bucket;
+    pkt_eid_key_t key;
+    khiter_t k;
+    int ret;
+
+    if (!addr || pkt_eid_key_init(&key, addr) != GOOD){
+        return (NULL);
+    }
+    k = kh_get(mreq_buckets, table->htable, key);
+    if (k != kh_end(table->htable)){
+        bucket = kh_value(table->htable, k);
+        list_remove(&bucket->lru_node);
+        list_push_back(&table->lru, &bucket->lru_node);
+        return (&bucket->tb);
+    }
+
+    if (kh_size(table->htable) >= MAP_REQUEST_LIMITS_MAX_BUCKETS){
+        bucket = CONTAINER_OF(list_pop_front(&table->lru), mreq_limits_bucket_t,
+                lru_node);
+        kh_del(mreq_buckets, table->htable,
+                kh_get(mreq_buckets, table->htable, bucket->key));
+    }else{
+        bucket = xmalloc(sizeof(mreq_limits_bucket_t));
+    }
+    k = kh_put(mreq_buckets, table->htable, key, &ret);
+    if (ret == -1){
+        free(bucket);
+        return (NULL);
+    }
+    bucket->key = key;
+    token_bucket_init(&bucket->tb, rate, burst, now);
+    kh_value(table->htable, k) = bucket;
+    list_push_back(&table->lru, &bucket->lru_node);
+
+    return (&bucket->tb);
+}
+
+/* Check if the miss of 'src_eid' can be requested to the Map Resolver 'mr'.
+ * A token of each level is only consumed when all of them have one */
+static int
+mreq_limits_check(lisp_xtr_t *xtr, lisp_addr_t *src_eid, lisp_addr_t *mr)
+{
+    mreq_limits_t *limits = &xtr->mreq_limits;
+    token_bucket_t *src_tb = NULL, *mr_tb = NULL;
+    uint64_t now;
+
+    if (limits->global_rate == 0 && limits->src_eid_rate == 0
+            && limits->mr_rate == 0){
+        return (GOOD);
+    }
+    now = oor_timer_clock_us();
+
+    if (limits->global.burst == 0){
+        token_bucket_init(&limits->global, limits->global_rate,
+                limits->global_burst, now);
+    }
+    if (!token_bucket_has_token(&limits->global, now)){
+        limits->suppressed_global++;
+        OOR_LOG(LDBG_2, "Map-Request for miss of %s suppressed by the global "
+                "limit (%"PRIu64" suppressed)", lisp_addr_to_char(src_eid),
+                limits->suppressed_global);
+        return (BAD);
+    }
+
+    if (limits->src_eid_rate > 0){
+        src_tb = mreq_limits_get_bucket(&limits->src_eids, src_eid,
+                limits->src_eid_rate, limits->src_eid_burst, now);
+        if (src_tb && !token_bucket_has_token(src_tb, now)){
+            limits->suppressed_src_eid++;
+            OOR_LOG(LDBG_2, "Map-Request for miss of %s suppressed by the "
+                    "source EID limit (%"PRIu64" suppressed)",
+                    lisp_addr_to_char(src_eid), limits->suppressed_src_eid);
+            return (BAD);
+        }
+    }
+
+    if (limits->mr_rate > 0 && mr){
+        mr_tb = mreq_limits_get_bucket(&limits->map_resolvers, mr,
+                limits->mr_rate, limits->mr_burst, now);
+        if (mr_tb && !token_bucket_has_token(mr_tb, now)){
+            limits->suppressed_mr++;
+            OOR_LOG(LDBG_2, "Map-Request for miss of %s suppressed by the "
+                    "limit of Map Resolver %s (%"PRIu64" suppressed)",
+                    lisp_addr_to_char(src_eid), lisp_addr_to_char(mr),
+                    limits->suppressed_mr);
+            return (BAD);
+        }
+    }
+
+    token_bucket_consume(&limits->global);
+    if (src_tb){
+        token_bucket_consume(src_tb);
+    }
+    if (mr_tb){
+        token_bucket_consume(mr_tb);
+    }
+    return (GOOD);
+}
+
 int
 handle_map_cache_miss(lisp_xtr_t *xtr, lisp_addr_t *requested_eid,
         lisp_addr_t *src_eid)
@@ -842,7 +1105,7 @@ handle_map_cache_miss(lisp_xtr_t *xtr, lisp_addr_t *requested_eid,
     mapping_t *m = NULL;
     oor_timer_t *timer;
     timer_map_req_argument *timer_arg;
-    int ret;
+    int suppressed, ret;
 
     /* Install temporary, NOT active, mapping in map_cache */
     m = mapping_new_init(requested_eid);
@@ -856,12 +1119,31 @@ handle_map_cache_miss(lisp_xtr_t *xtr, lisp_addr_t *requested_eid,
         return(BAD);
     }
 
+    /* The entry of a suppressed miss is kept in the cache for a while. In the
+     * meantime, the misses of the EID are not processed again. It is only
+     * installed if it fits, it never evicts other entries */
+    suppressed = mreq_limits_check(xtr, src_eid, get_map_resolver(xtr)) != GOOD;
+    if (suppressed){
+        ret = mcache_is_full(xtr->map_cache, mcache_entry_mem_size(mce)) ? BAD : GOOD;
+    }else{
+        ret = tr_mcache_make_room(xtr, mcache_entry_mem_size(mce));
+    }
+    if (ret != GOOD){
+        OOR_LOG(LDBG_1, "Map cache full. Couldn't install temporary map cache "
+                "entry for %s", lisp_addr_to_char(requested_eid));
+        mcache_entry_del(mce);
+        return(BAD);
+    }
     if (mcache_add_entry(xtr->map_cache, requested_eid, mce) != GOOD) {
         OOR_LOG(LWRN, "Couln't install temporary map cache entry for %s!",
                 lisp_addr_to_char(requested_eid));
         mcache_entry_del(mce);
         return(BAD);
     }
+    if (suppressed){
+        mc_entry_start_expiration_timer2(xtr, mce, MAP_REQUEST_SUPPRESSED_TIMEOUT);
+        return(BAD);
+    }
     timer_arg = timer_map_req_arg_new_init(mce,src_eid);
     timer = oor_timer_with_nonce_new(MAP_REQUEST_RETRY_TIMER,xtr,send_map_request_retry_cb,
             timer_arg,(oor_timer_del_cb_arg_fn)timer_map_req_arg_free);
@@ -1155,7 +1437,9 @@ send_map_request_retry_cb(oor_timer_t *timer)
     lisp_xtr_t *xtr = oor_timer_owner(timer);
     uint64_t nonce;
     lisp_addr_t *deid;
+    glist_t *deids;
     int retries = nonces_list_size(nonces_list);
+    int ret;
 
     deid = mapping_eid (mcache_entry_mapping(timer_arg->mce));
     if (retries - 1 < xtr->map_request_retries) {
@@ -1165,7 +1449,17 @@ send_map_request_retry_cb(oor_timer_t *timer)
                     lisp_addr_to_char(deid), retries);
         }
         nonce = nonce_new();
-        if (build_and_send_encap_map_request(xtr, timer_arg->src_eid, timer_arg->mce, nonce) != GOOD){
+        if (xtr->map_request_batch_window > 0){
+            /* The nonce identifies the entry in the batch */
+            ret = mreq_batch_add(xtr, timer_arg->src_eid, nonce);
+        }else{
+            deids = glist_new();
+            glist_add(deid, deids);
+            ret = build_and_send_encap_map_request(xtr, timer_arg->src_eid,
+                    deids, nonce);
+            glist_destroy(deids);
+        }
+        if (ret != GOOD){
             return (BAD);
         }
         htable_nonces_insert(nonces_ht, nonce, nonces_list);
@@ -1182,13 +1476,13 @@ send_map_request_retry_cb(oor_timer_t *timer)
 }
 
 
-/* Sends Encap Map-Request for EID in 'mce' and sets-up a retry timer */
+/* Sends Encap Map-Request with a record for each EID in 'deids' */
 static int
 build_and_send_encap_map_request(lisp_xtr_t *xtr, lisp_addr_t *seid,
-        mcache_entry_t *mce, uint64_t nonce)
+        glist_t *deids, uint64_t nonce)
 {
     uconn_t uc;
-    mapping_t *m = NULL;
+    glist_entry_t *it;
     lisp_addr_t *deid = NULL;
     lisp_addr_t *drloc, *srloc;
     glist_t *rlocs = NULL;
@@ -1200,8 +1494,7 @@ build_and_send_encap_map_request(lisp_xtr_t *xtr, lisp_addr_t *seid,
         return (BAD);
     }
 
-    m = mcache_entry_mapping(mce);
-    deid = mapping_eid(m);
+    deid = (lisp_addr_t *)glist_first_data(deids);
 
     /* BUILD Map-Request */
 
@@ -1214,12 +1507,17 @@ build_and_send_encap_map_request(lisp_xtr_t *xtr, lisp_addr_t *seid,
         glist_destroy(rlocs);
         return(BAD);
     }
+    it = glist_first(deids);
+    while ((it = glist_next(it)) != glist_head(deids)){
+        lisp_msg_put_eid_rec(b, (lisp_addr_t *)glist_entry_data(it));
+    }
 
     mr_hdr = lisp_msg_hdr(b);
     MREQ_NONCE(mr_hdr) = nonce;
-    OOR_LOG(LDBG_1, "%s, itr-rlocs:%s, src-eid: %s, req-eid: %s",
+    OOR_LOG(LDBG_1, "%s, itr-rlocs:%s, src-eid: %s, req-eid: %s (%d records)",
             lisp_msg_hdr_to_char(b), laddr_list_to_char(rlocs),
-            lisp_addr_to_char(seid), lisp_addr_to_char(deid));
+            lisp_addr_to_char(seid), lisp_addr_to_char(deid),
+            glist_size(deids));
     glist_destroy(rlocs);
 
 
@@ -1242,6 +1540,220 @@ build_and_send_encap_map_request(lisp_xtr_t *xtr, lisp_addr_t *seid,
     return(GOOD);
 }
 
+/* Add the Map-Request of the entry with the retry nonce 'nonce' to the batch
+ * of the map resolver. The batch is sent when the batch window expires or
+ * when it is full */
+static int
+mreq_batch_add(lisp_xtr_t *xtr, lisp_addr_t *seid, uint64_t nonce)
+{
+    glist_entry_t *it;
+    mreq_batch_t *batch = NULL;
+    lisp_addr_t *mr;
+
+    mr = get_map_resolver(xtr);
+    if (!mr){
+        return (BAD);
+    }
+
+    glist_for_each_entry(it, xtr->mreq_batches){
+        batch = (mreq_batch_t *)glist_entry_data(it);
+        if (lisp_addr_cmp(batch->map_resolver, mr) == 0
+                && lisp_addr_cmp(batch->src_eid, seid) == 0){
+            break;
+        }
+        batch = NULL;
+    }
+    if (!batch){
+        batch = mreq_batch_new_init(mr, seid);
+        batch->timer = oor_timer_with_nonce_new(MAP_REQUEST_BATCH_TIMER, xtr,
+                mreq_batch_cb, batch, (oor_timer_del_cb_arg_fn)mreq_batch_del);
+        htable_ptrs_timers_add(ptrs_to_timers_ht, batch, batch->timer);
+        glist_add(batch, xtr->mreq_batches);
+        oor_timer_start_ms(batch->timer, xtr->map_request_batch_window);
+    }
+
+    batch->nonces[batch->count++] = nonce;
+    if (batch->count == MAP_REQUEST_BATCH_MAX_RECORDS){
+        /* Sent in the next tick, once the nonce is associated to the entry.
+         * New misses go to a new batch */
+        glist_remove_obj(batch, xtr->mreq_batches);
+        oor_timer_start_ms(batch->timer, 0);
+    }
+
+    return (GOOD);
+}
+
+/* Send a Map-Request with a record for each entry of the batch still waiting
+ * for a Map-Reply. The retries of each entry are done by its own timer */
+static int
+mreq_batch_send(lisp_xtr_t *xtr, mreq_batch_t *batch)
+{
+    nonces_list_t *nonces_lst;
+    oor_timer_t *timer;
+    timer_map_req_argument *t_mr_arg;
+    glist_t *deids;
+    uint64_t nonce;
+    int i, ret;
+
+    glist_remove_obj(batch, xtr->mreq_batches);
+    batch->sent = TRUE;
+
+    deids = glist_new();
+    for (i = 0; i < batch->count; i++){
+        nonces_lst = htable_nonces_lookup(nonces_ht, batch->nonces[i]);
+        if (!nonces_lst){
+            /* The entry has been removed */
+            continue;
+        }
+        timer = nonces_list_timer(nonces_lst);
+        if (oor_timer_type(timer) != MAP_REQUEST_RETRY_TIMER){
+            continue;
+        }
+        t_mr_arg = (timer_map_req_argument *)oor_timer_cb_argument(timer);
+        glist_add(mcache_entry_eid(t_mr_arg->mce), deids);
+    }
+    if (glist_size(deids) == 0){
+        glist_destroy(deids);
+        stop_timer_from_obj(batch, batch->timer, ptrs_to_timers_ht, nonces_ht);
+        return (GOOD);
+    }
+
+    nonce = nonce_new();
+    ret = build_and_send_encap_map_request(xtr, batch->src_eid, deids, nonce);
+    glist_destroy(deids);
+    if (ret != GOOD){
+        stop_timer_from_obj(batch, batch->timer, ptrs_to_timers_ht, nonces_ht);
+        return (BAD);
+    }
+    htable_nonces_insert(nonces_ht, nonce, oor_timer_nonces(batch->timer));
+    /* The batch is kept to process the Map-Reply */
+    oor_timer_start(batch->timer, OOR_INITIAL_MRQ_TIMEOUT);
+
+    return (GOOD);
+}
+
+static int
+mreq_batch_cb(oor_timer_t *timer)
+{
+    mreq_batch_t *batch = (mreq_batch_t *)oor_timer_cb_argument(timer);
+    lisp_xtr_t *xtr = oor_timer_owner(timer);
+
+    if (!batch->sent){
+        return (mreq_batch_send(xtr, batch));
+    }
+
+    /* No Map-Reply. The entries of the batch are requested again by their
+     * retry timers */
+    stop_timer_from_obj(batch, timer, ptrs_to_timers_ht, nonces_ht);
+    return (GOOD);
+}
+
+/* Check if the requested EID prefix is covered by the EID prefix of a record */
+static int
+mreq_batch_eid_in_prefix(lisp_addr_t *eid, lisp_addr_t *pref)
+{
+    lisp_addr_t *ip, *ip_pref;
+    uint32_t iid = 0, pref_iid = 0;
+
+    if (lisp_addr_is_lcaf(eid)){
+        if (!lcaf_addr_is_iid(lisp_addr_get_lcaf(eid))){
+            return (FALSE);
+        }
+        iid = lcaf_iid_get_iid(lisp_addr_get_lcaf(eid));
+    }
+    if (lisp_addr_is_lcaf(pref)){
+        if (!lcaf_addr_is_iid(lisp_addr_get_lcaf(pref))){
+            return (FALSE);
+        }
+        pref_iid = lcaf_iid_get_iid(lisp_addr_get_lcaf(pref));
+    }
+    if (iid != pref_iid){
+        return (FALSE);
+    }
+
+    /* The EIDs of the map cache entries are prefixes */
+    ip = lisp_addr_get_ip_pref_addr(eid);
+    ip_pref = lisp_addr_get_ip_pref_addr(pref);
+    if (!ip || !ip_pref){
+        return (FALSE);
+    }
+
+    return (pref_is_prefix_b_part_of_a(ip_pref, ip));
+}
+
+/* Process a Map-Reply of a batch. Each record replaces the temporary map
+ * cache entries of the requested EIDs it covers */
+static int
+mreq_batch_recv_map_reply(lisp_xtr_t *xtr, lbuf_t *b, int records,
+        oor_timer_t *timer)
+{
+    mreq_batch_t *batch = (mreq_batch_t *)oor_timer_cb_argument(timer);
+    nonces_list_t *nonces_lst;
+    timer_map_req_argument *t_mr_arg;
+    mcache_entry_t *pending[MAP_REQUEST_BATCH_MAX_RECORDS];
+    locator_t *probed;
+    mapping_t *m;
+    int npending = 0, covered, i, j;
+
+    for (i = 0; i < batch->count; i++){
+        nonces_lst = htable_nonces_lookup(nonces_ht, batch->nonces[i]);
+        if (!nonces_lst
+                || oor_timer_type(nonces_list_timer(nonces_lst)) != MAP_REQUEST_RETRY_TIMER){
+            continue;
+        }
+        t_mr_arg = (timer_map_req_argument *)oor_timer_cb_argument(
+                nonces_list_timer(nonces_lst));
+        pending[npending++] = t_mr_arg->mce;
+    }
+
+    for (i = 0; i < records; i++) {
+        m = mapping_new();
+        if (lisp_msg_parse_mapping_record(b, m, &probed) != GOOD) {
+            mapping_del(m);
+            break;
+        }
+        if (mapping_has_elp_with_l_bit(m)){
+            OOR_LOG(LDBG_1,"Received a Map Reply with an ELP with the L bit set. "
+                    "Not supported -> Discrding record");
+            mapping_del(m);
+            continue;
+        }
+
+        covered = FALSE;
+        for (j = 0; j < npending; j++){
+            if (!pending[j] || !mreq_batch_eid_in_prefix(
+                    mcache_entry_eid(pending[j]), mapping_eid(m))){
+                continue;
+            }
+            /* delete placeholder/dummy mapping inorder to install the new one */
+            tr_mcache_remove_entry(xtr, pending[j]);
+            pending[j] = NULL;
+            covered = TRUE;
+        }
+        if (!covered){
+            OOR_LOG(LDBG_2,"Received a non requested record %s in a Map Reply",
+                    lisp_addr_to_char(mapping_eid(m)));
+            mapping_del(m);
+            continue;
+        }
+        tr_mcache_add_mapping(xtr, m);
+    }
+    mcache_dump_db(xtr->map_cache, LDBG_3);
+
+    /* A Map Server answers with a Map-Reply per record, all with the nonce of
+     * the batch. The batch is kept until all its entries have been resolved
+     * or until it expires. Entries not resolved by then are requested again
+     * by their retry timers */
+    for (j = 0; j < npending; j++){
+        if (pending[j]){
+            return (GOOD);
+        }
+    }
+    stop_timer_from_obj(batch, timer, ptrs_to_timers_ht, nonces_ht);
+
+    return (GOOD);
+}
+
 /* build and send generic map-register with one record
  * for each map server */
 static int
@@ -1668,91 +2180,100 @@ program_initial_info_request_process(lisp_xtr_t *xtr)
 static int
 rloc_probing_cb(oor_timer_t *timer)
 {
-    timer_rloc_probe_argument *rparg = oor_timer_cb_argument(timer);
+    rloc_probe_t *rp = oor_timer_cb_argument(timer);
     nonces_list_t *nonces_lst = oor_timer_nonces(timer);
     lisp_xtr_t *xtr = oor_timer_owner(timer);
-    mapping_t *map = mcache_entry_mapping(rparg->mce);
-    locator_t *loct = rparg->locator;
-    lisp_addr_t * drloc;
+    khash_t(ptrs) *mces = rp->mces->ht;
+    mcache_entry_t *mce = NULL;
+    lisp_addr_t *drloc;
     uint64_t nonce;
-    mcache_entry_t * mce;
+    khiter_t k;
+    int interval, changed = FALSE;
 
     // XXX alopez -> What we have to do with ELP and probe bit
-    drloc = xtr->fwd_policy->get_fwd_ip_addr(locator_addr(loct), ctrl_rlocs(xtr->super.ctrl));
+    drloc = xtr->fwd_policy->get_fwd_ip_addr(rp->addr, ctrl_rlocs(xtr->super.ctrl));
 
     if ((nonces_list_size(nonces_lst) -1) < xtr->probe_retries){
+        /* The probe is sent for the EID of any of the entries using the RLOC.
+         * Entries not using anymore the RLOC are forgotten */
+        for (k = kh_begin(mces); k != kh_end(mces); ++k){
+            if (!kh_exist(mces, k)){
+                continue;
+            }
+            mce = kh_key(mces, k);
+            if (rloc_probe_mce_locator(xtr, rp, mce, kh_value(mces, k)) != NULL){
+                break;
+            }
+            lisp_addr_del(kh_value(mces, k));
+            kh_del(ptrs, mces, k);
+            mce = NULL;
+        }
+        if (mce == NULL){
+            OOR_LOG(LDBG_2,"RLOC %s not used anymore. Stop probing it",
+                    lisp_addr_to_char(rp->addr));
+            rloc_probe_remove(xtr, rp);
+            return (GOOD);
+        }
+
         nonce = nonce_new();
-        if (rloc_probing(xtr, map,loct,nonce) != GOOD){
+        if (rloc_probing(xtr, mcache_entry_eid(mce), drloc, nonce) != GOOD){
                    return (BAD);
         }
         if (nonces_list_size(nonces_lst) > 0) {
-            OOR_LOG(LDBG_1,"Retry Map-Request Probe for locator %s and "
-                    "EID: %s (%d retries)", lisp_addr_to_char(drloc),
-                    lisp_addr_to_char(mapping_eid(map)), nonces_list_size(nonces_lst));
+            OOR_LOG(LDBG_1,"Retry Map-Request Probe for locator %s (%d map cache "
+                    "entries, %d retries)", lisp_addr_to_char(drloc),
+                    kh_size(mces), nonces_list_size(nonces_lst));
         } else {
-            OOR_LOG(LDBG_1,"Map-Request Probe for locator %s and "
-                    "EID: %s", lisp_addr_to_char(drloc),
-                    lisp_addr_to_char(mapping_eid(map)));
+            OOR_LOG(LDBG_1,"Map-Request Probe for locator %s (%d map cache "
+                    "entries)", lisp_addr_to_char(drloc), kh_size(mces));
         }
         htable_nonces_insert(nonces_ht, nonce,nonces_lst);
-        oor_timer_start(timer, xtr->probe_retries_interval);
+        rp->inf.last_probe = oor_timer_clock_us();
+        oor_timer_start_ms(timer, rloc_probing_retries_interval(xtr, &rp->inf));
         return (GOOD);
     }else{
         /* If we have reached maximum number of retransmissions, change remote
          *  locator status */
-        if (locator_state(loct) == UP) {
-            locator_set_state(loct, DOWN);
+        if (rp->state == UP) {
+            rp->state = DOWN;
+            changed = TRUE;
             OOR_LOG(LDBG_1,"rloc_probing: No Map-Reply Probe received for locator"
-                    " %s and EID: %s -> Locator state changes to DOWN",
-                    lisp_addr_to_char(drloc), lisp_addr_to_char(mapping_eid(map)));
-
-            /* [re]Calculate forwarding info  if it has been a change
-             * of status*/
-            mce = mcache_lookup_exact(xtr->map_cache,mapping_eid(map));
-            if (mce == NULL){
-                /* It is a PeTR RLOC */
-                mce = get_proxy_etrs_for_afi(xtr,lisp_addr_ip_afi(mapping_eid(map)));
-                if ( rparg->mce != mce ){
-                    OOR_LOG(LERR,"rloc_probing: No map cache entry for EID %s. It should never happened",
-                            lisp_addr_to_char(mapping_eid(map)));
-                    return (BAD);
-                }
-            }
+                    " %s -> Locator state changes to DOWN", lisp_addr_to_char(drloc));
+        }
+        interval = rloc_probing_update_inf(xtr, &rp->inf,
+                nonces_list_size(nonces_lst), 0, changed);
+        htable_nonces_reset_nonces_lst(nonces_ht,nonces_lst);
 
-            xtr->fwd_policy->updated_map_cache_inf(xtr->fwd_policy_dev_parm,mce);
-            notify_datap_rm_fwd_from_entry(&(xtr->super),mcache_entry_eid(mce),FALSE);
+        /* [re]Calculate forwarding info of the entries if it has been a
+         * change of status */
+        if (rloc_probe_update_mces(xtr, rp) == 0){
+            OOR_LOG(LDBG_2,"RLOC %s not used anymore. Stop probing it",
+                    lisp_addr_to_char(rp->addr));
+            rloc_probe_remove(xtr, rp);
+            return (BAD);
         }
 
         /* Reprogram time for next probe interval */
-        htable_nonces_reset_nonces_lst(nonces_ht,nonces_lst);
-        oor_timer_start(timer, xtr->probe_interval);
-        OOR_LOG(LDBG_2,"Reprogramed RLOC probing of the locator %s of the EID %s "
-                "in %d seconds", lisp_addr_to_char(drloc),
-                lisp_addr_to_char(mapping_eid(map)), xtr->probe_interval);
+        oor_timer_start_ms(timer, interval);
+        OOR_LOG(LDBG_2,"Reprogramed RLOC probing of the locator %s in %d ms",
+                lisp_addr_to_char(drloc), interval);
 
         return (BAD);
     }
 }
 
-/* Send a Map-Request probe to check status of 'loc'. If the number of
- * retries without answer is higher than rloc_probe_retries. Change the status
- * of the 'loc' to down */
+/* Send a Map-Request probe for 'deid' to check the status of 'drloc' */
 static int
-rloc_probing(lisp_xtr_t *xtr, mapping_t *map, locator_t *loc, uint64_t nonce)
+rloc_probing(lisp_xtr_t *xtr, lisp_addr_t *deid, lisp_addr_t *drloc,
+        uint64_t nonce)
 {
     uconn_t uc;
-    lisp_addr_t * deid = NULL;
-    lisp_addr_t * drloc = NULL;
     lisp_addr_t empty;
     lbuf_t * b = NULL;
     glist_t * rlocs = NULL;
     void * hdr = NULL;
     int ret;
 
-    deid = mapping_eid(map);
-
-    // XXX alopez -> What we have to do with ELP and probe bit
-    drloc = xtr->fwd_policy->get_fwd_ip_addr(locator_addr(loc), ctrl_rlocs(xtr->super.ctrl));
     lisp_addr_set_lafi(&empty, LM_AFI_NO_ADDR);
 
     rlocs = ctrl_default_rlocs(xtr->super.ctrl);
@@ -1773,23 +2294,172 @@ rloc_probing(lisp_xtr_t *xtr, mapping_t *map, locator_t *loc, uint64_t nonce)
     return (ret);
 }
 
+/* Interval (ms) between the retries of a probe. When the interval between
+ * probes is adaptive, it is estimated from the RTT of the locator */
+static int
+rloc_probing_retries_interval(lisp_xtr_t *xtr, locator_probe_inf_t *pinf)
+{
+    int max = xtr->probe_retries_interval * 1000;
+    int rto;
+
+    if (xtr->probe_min_interval == 0 || pinf->srtt == 0) {
+        return (max);
+    }
+    rto = (pinf->srtt + 4 * pinf->rttvar) / 1000;
+    if (rto < RLOC_PROBING_MIN_RETRIES_INTERVAL) {
+        rto = RLOC_PROBING_MIN_RETRIES_INTERVAL;
+    } else if (rto > max) {
+        rto = max;
+    }
+
+    return (rto);
+}
+
+/* Update the loss of the RLOC with the result of a round of probes and
+ * obtain the interval (ms) until the next round. The interval is doubled
+ * while the locator replies to the first probe, and it returns to the
+ * minimum when probes are lost or the locator changes its state */
+static int
+rloc_probing_update_inf(lisp_xtr_t *xtr, locator_probe_inf_t *pinf, int lost,
+        int replied, int changed)
+{
+    uint32_t max = xtr->probe_interval * 1000;
+    uint32_t min = xtr->probe_min_interval > 0 ? xtr->probe_min_interval : max;
+    int i;
+
+    for (i = 0; i < lost + replied; i++) {
+        pinf->loss -= pinf->loss / 8;
+        if (i < lost) {
+            pinf->loss += 10000 / 8;
+        }
+    }
+
+    if (lost > 0 || changed || pinf->interval == 0) {
+        pinf->interval = min;
+    } else if (pinf->interval < max / 2) {
+        pinf->interval *= 2;
+    } else {
+        pinf->interval = max;
+    }
+
+    return (pinf->interval);
+}
+
+/* Update the smoothed RTT of the RLOC as TCP does (RFC 6298) */
 static void
-program_rloc_probing(lisp_xtr_t *xtr, mcache_entry_t *mce, locator_t *loc, int time)
+rloc_probing_update_rtt(locator_probe_inf_t *pinf, uint64_t now)
 {
-    oor_timer_t *timer;
-    timer_rloc_probe_argument *arg;
+    uint32_t rtt, delta;
 
+    rtt = now > pinf->last_probe ? now - pinf->last_probe : 1;
+    if (pinf->srtt == 0) {
+        pinf->srtt = rtt;
+        pinf->rttvar = rtt / 2;
+        return;
+    }
+    delta = rtt > pinf->srtt ? rtt - pinf->srtt : pinf->srtt - rtt;
+    pinf->rttvar = pinf->rttvar - pinf->rttvar / 4 + delta / 4;
+    pinf->srtt = pinf->srtt - pinf->srtt / 8 + rtt / 8;
+    if (pinf->srtt == 0) {
+        pinf->srtt = 1;
+    }
+}
 
-    arg = timer_rloc_probe_argument_new_init(mce,loc);
-    timer = oor_timer_with_nonce_new(RLOC_PROBING_TIMER,xtr,rloc_probing_cb,
-            arg,(oor_timer_del_cb_arg_fn)timer_rloc_probe_argument_free);
-    htable_ptrs_timers_add(ptrs_to_timers_ht, mce, timer);
+/* Locator of the map cache entry probed with the RLOC. NULL if the entry has
+ * been removed or it doesn't use anymore the RLOC */
+static locator_t *
+rloc_probe_mce_locator(lisp_xtr_t *xtr, rloc_probe_t *rp, mcache_entry_t *mce,
+        lisp_addr_t *eid)
+{
+    if (mce != xtr->petrs_ipv4 && mce != xtr->petrs_ipv6
+            && mcache_lookup_exact(xtr->map_cache, eid) != mce){
+        return (NULL);
+    }
+    return (mapping_get_loct_with_addr(mcache_entry_mapping(mce), rp->addr));
+}
 
-    oor_timer_start(timer, time);
-    OOR_LOG(LDBG_2,"Programming probing of EID's %s locator %s (%d seconds)",
-            lisp_addr_to_char(mapping_eid(mcache_entry_mapping(mce))),
-            lisp_addr_to_char(locator_addr(loc)), time);
+/* Apply the state and the metrics of the RLOC to the locators of all the map
+ * cache entries using it, recalculating the forwarding information of the
+ * entries whose locator changes its state. Entries not using anymore the RLOC
+ * are forgotten. Returns the number of entries using the RLOC */
+static int
+rloc_probe_update_mces(lisp_xtr_t *xtr, rloc_probe_t *rp)
+{
+    khash_t(ptrs) *mces = rp->mces->ht;
+    mcache_entry_t *mce;
+    locator_t *loct;
+    uint8_t lossy;
+    khiter_t k;
 
+    for (k = kh_begin(mces); k != kh_end(mces); ++k){
+        if (!kh_exist(mces, k)){
+            continue;
+        }
+        mce = kh_key(mces, k);
+        loct = rloc_probe_mce_locator(xtr, rp, mce, kh_value(mces, k));
+        if (!loct){
+            lisp_addr_del(kh_value(mces, k));
+            kh_del(ptrs, mces, k);
+            continue;
+        }
+        lossy = locator_is_lossy(loct);
+        *locator_probe_inf(loct) = rp->inf;
+        /* The forwarding policy avoids the locators losing probes */
+        if (locator_state(loct) != rp->state || locator_is_lossy(loct) != lossy){
+            locator_set_state(loct, rp->state);
+            xtr->fwd_policy->updated_map_cache_inf(xtr->fwd_policy_dev_parm,mce);
+            notify_datap_rm_fwd_from_entry(&(xtr->super),mcache_entry_eid(mce),FALSE);
+        }
+    }
+
+    return (kh_size(mces));
+}
+
+/* Add the map cache entry to the probing of the RLOC of the locator. The
+ * probing of the RLOC starts with the first entry using it */
+static void
+program_rloc_probing(lisp_xtr_t *xtr, mcache_entry_t *mce, locator_t *loc)
+{
+    rloc_probe_t *rp;
+    lisp_addr_t *eid;
+    pkt_eid_key_t key;
+    khiter_t k;
+    int interval, ret;
+
+    if (pkt_eid_key_init(&key, locator_addr(loc)) != GOOD){
+        OOR_LOG(LDBG_2,"program_rloc_probing: Probing of locator %s not supported",
+                lisp_addr_to_char(locator_addr(loc)));
+        return;
+    }
+    k = kh_get(rloc_probes, xtr->rloc_probes, key);
+    if (k != kh_end(xtr->rloc_probes)){
+        rp = kh_value(xtr->rloc_probes, k);
+    }else{
+        k = kh_put(rloc_probes, xtr->rloc_probes, key, &ret);
+        if (ret < 0){
+            return;
+        }
+        rp = rloc_probe_new_init(locator_addr(loc), &key, locator_state(loc));
+        kh_value(xtr->rloc_probes, k) = rp;
+        rp->timer = oor_timer_with_nonce_new(RLOC_PROBING_TIMER, xtr,
+                rloc_probing_cb, rp, NULL);
+        htable_ptrs_timers_add(ptrs_to_timers_ht, rp, rp->timer);
+
+        interval = rloc_probing_update_inf(xtr, &rp->inf, 0, 0, FALSE);
+        oor_timer_start_ms(rp->timer, interval);
+        OOR_LOG(LDBG_2,"Programming probing of locator %s (%d ms)",
+                lisp_addr_to_char(rp->addr), interval);
+    }
+
+    *locator_probe_inf(loc) = rp->inf;
+    eid = htable_ptrs_lookup(rp->mces, mce);
+    if (eid){
+        if (lisp_addr_cmp(eid, mcache_entry_eid(mce)) == 0){
+            return;
+        }
+        lisp_addr_del(eid);
+    }
+    htable_ptrs_insert(rp->mces, mce, lisp_addr_clone(mcache_entry_eid(mce)));
 }
 
 /* Program RLOC probing for each locator of the mapping */
@@ -1802,14 +2472,12 @@ program_mce_rloc_probing(lisp_xtr_t *xtr, mcache_entry_t *mce)
     if (xtr->probe_interval == 0) {
         return;
     }
-    /* Cancel previous RLOCs Probing associated to this mce */
-    stop_timers_of_type_from_obj(mce,RLOC_PROBING_TIMER,ptrs_to_timers_ht, nonces_ht);
 
     map = mcache_entry_mapping(mce);
     /* Start rloc probing for each locator of the mapping */
     mapping_foreach_active_locator(map,locator){
     		// XXX alopez: Check if RLOB probing available for all LCAF. ELP RLOC Probing bit
-    		program_rloc_probing(xtr, mce, locator, xtr->probe_interval);
+    		program_rloc_probing(xtr, mce, locator);
     }mapping_foreach_active_locator_end;
 }
 
@@ -1834,6 +2502,9 @@ tr_mcache_add_mapping(lisp_xtr_t *xtr, mapping_t *m)
         return(BAD);
     }
 
+    /* The entry is added even if there is no room. Only the entries with
+     * pending Map-Requests remain in the cache, and they are short lived */
+    tr_mcache_make_room(xtr, mcache_entry_mem_size(mce));
     if (mcache_add_entry(xtr->map_cache, mapping_eid(m), mce) != GOOD) {
         OOR_LOG(LDBG_1, "tr_mcache_add_mapping: Couldn't add map cache entry %s to data base!. Discarding it.",
                 lisp_addr_to_char(mapping_eid(m)));
@@ -1882,6 +2553,106 @@ tr_mcache_add_static_mapping(lisp_xtr_t *xtr, mapping_t *m)
     return(GOOD);
 }
 
+/* Add to the map cache the prefix of the static map cache file matching the
+ * EID when it is more specific than the map cache entry mce found for it.
+ * The entry is evictable like the dynamic ones, and it is loaded again from
+ * the file table the next time it is needed. Returns GOOD if the entry has
+ * been added */
+static int
+tr_mcache_load_static_entry(lisp_xtr_t *xtr, uint32_t iid, lisp_addr_t *eid,
+        mcache_entry_t *mce)
+{
+    static_mcache_entry_t *entry;
+    mapping_t *mapping;
+    ip_addr_t *ip;
+
+    if (static_mcache_nentries(xtr->static_mcache) == 0){
+        return (BAD);
+    }
+    ip = lisp_addr_ip(eid);
+    entry = static_mcache_lookup(xtr->static_mcache, iid, ip);
+    if (!entry || (mce && lisp_addr_get_plen(mcache_entry_eid(mce)) >= entry->plen)){
+        return (BAD);
+    }
+
+    mapping = static_mcache_entry_mapping(xtr->static_mcache, entry, ip_addr_afi(ip));
+    if (!mapping){
+        return (BAD);
+    }
+    OOR_LOG(LDBG_1, "Adding map cache entry of the static map cache file for "
+            "EID prefix %s", lisp_addr_to_char(mapping_eid(mapping)));
+
+    mce = mcache_entry_new();
+    if (mce == NULL){
+        mapping_del(mapping);
+        return (BAD);
+    }
+    mcache_entry_init_static_file(mce, mapping);
+
+    /* Precalculate routing information */
+    if (xtr->fwd_policy->init_map_cache_policy_inf(xtr->fwd_policy_dev_parm,mce) != GOOD){
+        OOR_LOG(LWRN, "tr_mcache_load_static_entry: Couldn't initiate routing info for map cache entry %s!. Discarding it.",
+                lisp_addr_to_char(mapping_eid(mapping)));
+        mcache_entry_del(mce);
+        return (BAD);
+    }
+
+    if (tr_mcache_make_room(xtr, mcache_entry_mem_size(mce)) != GOOD){
+        OOR_LOG(LDBG_1, "Map cache full. Couldn't add map cache entry of the "
+                "static map cache file for %s",
+                lisp_addr_to_char(mapping_eid(mapping)));
+        mcache_entry_del(mce);
+        return (BAD);
+    }
+    if (mcache_add_entry(xtr->map_cache, mapping_eid(mapping), mce) != GOOD) {
+        OOR_LOG(LDBG_1, "tr_mcache_load_static_entry: Couldn't add map cache entry %s to data base!. Discarding it.",
+                lisp_addr_to_char(mapping_eid(mapping)));
+        mcache_entry_del(mce);
+        return (BAD);
+    }
+
+    program_mce_rloc_probing(xtr, mce);
+
+    return (GOOD);
+}
+
+/* Evict the least recently used active entries until an entry of 'size'
+ * bytes fits in the limits of the map cache. The entries with traffic in the
+ * data plane since they were used by the control plane get a second chance.
+ * The temporary entries of pending Map-Requests are never evicted */
+static int
+tr_mcache_make_room(lisp_xtr_t *xtr, size_t size)
+{
+    map_cache_db_t *mc = xtr->map_cache;
+    mcache_entry_t *mce, *next;
+    time_t last_used;
+    int scanned = 0;
+
+    LIST_FOR_EACH_SAFE (mce, next, lru_node, &mc->lru) {
+        if (!mcache_is_full(mc, size)){
+            break;
+        }
+        if (mcache_entry_active(mce) == NOT_ACTIVE){
+            continue;
+        }
+        if (scanned < MCACHE_MAX_EVICTION_SCAN){
+            scanned++;
+            last_used = datap_fwd_entry_last_used(&xtr->super,
+                    mcache_entry_eid(mce));
+            if (last_used > mce->last_used){
+                mcache_touch_entry(mc, mce, last_used);
+                continue;
+            }
+        }
+        OOR_LOG(LDBG_1, "Map cache full. Evicting the entry of EID %s",
+                lisp_addr_to_char(mcache_entry_eid(mce)));
+        mc->evictions++;
+        tr_mcache_remove_entry(xtr, mce);
+    }
+
+    return (mcache_is_full(mc, size) ? BAD : GOOD);
+}
+
 int
 tr_mcache_remove_entry(lisp_xtr_t *xtr, mcache_entry_t *mce)
 {
@@ -1891,12 +2662,76 @@ tr_mcache_remove_entry(lisp_xtr_t *xtr, mcache_entry_t *mce)
     notify_datap_rm_fwd_from_entry(&(xtr->super),eid,FALSE);
 
     data = mcache_remove_entry(xtr->map_cache, eid);
+    rloc_probing_forget_mce(xtr, data);
     mcache_entry_del(data);
     mcache_dump_db(xtr->map_cache, LDBG_3);
 
     return (GOOD);
 }
 
+/* Called with each entry removed from the map cache with its instance ID */
+static void
+tr_mcache_iid_entry_removed(void *entry, void *arg)
+{
+    lisp_xtr_t *xtr = arg;
+    mcache_entry_t *mce = entry;
+
+    notify_datap_rm_fwd_from_entry(&(xtr->super),mcache_entry_eid(mce),FALSE);
+    rloc_probing_forget_mce(xtr, mce);
+    mcache_entry_del(mce);
+}
+
+/* Remove all the entries of the map cache of the instance ID. Their timers
+ * are stopped, their RLOCs are not probed for them anymore and their flows are
+ * removed from the data plane. Return the number of entries removed */
+int
+tr_mcache_remove_iid(lisp_xtr_t *xtr, uint32_t iid)
+{
+    int removed;
+
+    removed = mcache_remove_iid(xtr->map_cache, iid, tr_mcache_iid_entry_removed, xtr);
+    OOR_LOG(LDBG_1, "Removed %d map cache entries of IID %u", removed, iid);
+    mcache_dump_db(xtr->map_cache, LDBG_3);
+
+    return (removed);
+}
+
+/* Instance IDs of the EIDs of the local database. EIDs without IID are not
+ * included */
+int_htable *
+tr_local_db_iids(lisp_xtr_t *xtr)
+{
+    int_htable *iids = int_htable_new();
+    lisp_addr_t *eid;
+    void *it;
+
+    local_map_db_foreach_entry(xtr->local_mdb, it) {
+        eid = map_local_entry_eid((map_local_entry_t *)it);
+        if (lisp_addr_is_iid(eid)){
+            int_htable_insert(iids, lcaf_iid_get_iid(lisp_addr_get_lcaf(eid)), xtr);
+        }
+    } local_map_db_foreach_end;
+
+    return (iids);
+}
+
+/* Remove the map cache entries of the instance IDs in old_iids not used by
+ * the local database anymore. Only the EIDs of the IIDs of the local EIDs
+ * are looked up in the map cache */
+void
+tr_mcache_remove_unused_iids(lisp_xtr_t *xtr, int_htable *old_iids)
+{
+    int_htable *iids = tr_local_db_iids(xtr);
+    int iid;
+
+    int_htable_foreach_key(old_iids, iid){
+        if (!int_htable_lookup(iids, iid)){
+            tr_mcache_remove_iid(xtr, iid);
+        }
+    } int_htable_foreach_key_end;
+    int_htable_destroy(iids);
+}
+
 
 mapping_t *
 tr_mcache_lookup_mapping(lisp_xtr_t *xtr, lisp_addr_t *laddr)
@@ -2251,6 +3086,7 @@ xtr_ctrl_construct(oor_ctrl_dev_t *dev)
     /* set up databases */
     xtr->local_mdb = local_map_db_new();
     xtr->map_cache = mcache_new();
+    xtr->static_mcache = static_mcache_new();
     xtr->map_servers = glist_new_managed((glist_del_fct)map_server_elt_del);
     xtr->map_resolvers = glist_new_managed((glist_del_fct)lisp_addr_del);
     xtr->pitrs = glist_new_managed((glist_del_fct)lisp_addr_del);
@@ -2258,10 +3094,16 @@ xtr_ctrl_construct(oor_ctrl_dev_t *dev)
     xtr->petrs_ipv6 = mcache_entry_new();
     xtr->rtrs = mcache_entry_new();
     xtr->iface_locators_table = shash_new_managed((free_value_fn_t)iface_locators_del);
-
-    if (!xtr->local_mdb || !xtr->map_cache || !xtr->map_servers ||
-            !xtr->map_resolvers || !xtr->pitrs || !xtr->petrs_ipv4 ||
-            !xtr->petrs_ipv6 || !xtr->rtrs || !xtr->iface_locators_table) {
+    xtr->rloc_probes = kh_init(rloc_probes);
+    xtr->mreq_batches = glist_new();
+    mreq_limits_table_init(&xtr->mreq_limits.src_eids);
+    mreq_limits_table_init(&xtr->mreq_limits.map_resolvers);
+
+    if (!xtr->local_mdb || !xtr->map_cache || !xtr->static_mcache ||
+            !xtr->map_servers || !xtr->map_resolvers || !xtr->pitrs ||
+            !xtr->petrs_ipv4 || !xtr->petrs_ipv6 || !xtr->rtrs ||
+            !xtr->iface_locators_table || !xtr->rloc_probes || !xtr->mreq_batches ||
+            !xtr->mreq_limits.src_eids.htable || !xtr->mreq_limits.map_resolvers.htable) {
         return(BAD);
     }
 
@@ -2289,6 +3131,7 @@ xtr_ctrl_destruct(oor_ctrl_dev_t *dev)
     map_local_entry_t * map_loc_e = NULL;
     void *it = NULL;
     lisp_xtr_t *xtr = lisp_xtr_cast(dev);
+    khiter_t k;
 
     local_map_db_foreach_entry(xtr->local_mdb, it) {
         map_loc_e = (map_local_entry_t *)it;
@@ -2300,7 +3143,18 @@ xtr_ctrl_destruct(oor_ctrl_dev_t *dev)
     }
 
     shash_destroy(xtr->iface_locators_table);
+    for (k = kh_begin(xtr->rloc_probes); k != kh_end(xtr->rloc_probes); ++k){
+        if (kh_exist(xtr->rloc_probes, k)){
+            rloc_probe_del(kh_value(xtr->rloc_probes, k));
+        }
+    }
+    kh_destroy(rloc_probes, xtr->rloc_probes);
+    /* The batches are released with their timers */
+    glist_destroy(xtr->mreq_batches);
+    mreq_limits_table_uninit(&xtr->mreq_limits.src_eids);
+    mreq_limits_table_uninit(&xtr->mreq_limits.map_resolvers);
     mcache_del(xtr->map_cache);
+    static_mcache_del(xtr->static_mcache);
     mcache_entry_del(xtr->petrs_ipv4);
     mcache_entry_del(xtr->petrs_ipv6);
     mcache_entry_del(xtr->rtrs);
@@ -2641,6 +3495,7 @@ tr_get_fwd_entry(lisp_xtr_t *xtr, packet_tuple_t *tuple)
         }else{
             eid = map_local_entry_eid(map_loc_e);
             simple_eid = lisp_addr_get_ip_pref_addr(eid);
+            fwd_info->associated_local_entry = lisp_addr_clone(eid);
             if (lisp_addr_is_iid(eid)){
                 tuple->iid = lcaf_iid_get_iid(lisp_addr_get_lcaf(eid));
             }else{
@@ -2665,6 +3520,9 @@ tr_get_fwd_entry(lisp_xtr_t *xtr, packet_tuple_t *tuple)
         mce = xtr->rtrs;
     }else{
         mce = mcache_lookup(xtr->map_cache, dst_eid);
+        if (tr_mcache_load_static_entry(xtr, tuple->iid, &tuple->dst_addr, mce) == GOOD){
+            mce = mcache_lookup(xtr->map_cache, dst_eid);
+        }
     }
     if (!mce) {
         /* No map cache entry, initiate map cache miss process */
@@ -2673,12 +3531,22 @@ tr_get_fwd_entry(lisp_xtr_t *xtr, packet_tuple_t *tuple)
         handle_map_cache_miss(xtr, dst_eid, src_eid);
         /* Get the temporal mce created */
         mce = mcache_lookup(xtr->map_cache, dst_eid);
+        if (!mce){
+            lisp_addr_del(src_eid);
+            lisp_addr_del(dst_eid);
+            fwd_info_del(fwd_info);
+            return (NULL);
+        }
         fwd_info->associated_entry = lisp_addr_clone(mcache_entry_eid(mce));
     } else{
         fwd_info->associated_entry = lisp_addr_clone(mcache_entry_eid(mce));
         if (mcache_entry_active(mce) == NOT_ACTIVE) {
             OOR_LOG(LDBG_2, "Already sent Map-Request for %s. Waiting for reply!",
                     lisp_addr_to_char(dst_eid));
+        }else{
+            /* The entry is refreshed before it expires */
+            mce->active_witin_period = TRUE;
+            mcache_touch_entry(xtr->map_cache, mce, time(NULL));
         }
     }
 
@@ -2896,18 +3764,88 @@ mapping_has_elp_with_l_bit(mapping_t *map)
     return (FALSE);
 }
 
-timer_rloc_probe_argument *
-timer_rloc_probe_argument_new_init(mcache_entry_t *mce,locator_t *locator)
+rloc_probe_t *
+rloc_probe_new_init(lisp_addr_t *addr, pkt_eid_key_t *key, uint8_t state)
 {
-    timer_rloc_probe_argument *timer_arg = xmalloc(sizeof(timer_rloc_probe_argument));
-    timer_arg->mce = mce;
-    timer_arg->locator = locator;
-    return (timer_arg);
+    rloc_probe_t *rp = xzalloc(sizeof(rloc_probe_t));
+    rp->addr = lisp_addr_clone(addr);
+    rp->key = *key;
+    rp->state = state;
+    rp->mces = htable_ptrs_new();
+    return (rp);
 }
 
 void
-timer_rloc_probe_argument_free(timer_rloc_probe_argument *timer_arg){
-    free (timer_arg);
+rloc_probe_del(rloc_probe_t *rp)
+{
+    khiter_t k;
+
+    stop_timers_from_obj(rp, ptrs_to_timers_ht, nonces_ht);
+    for (k = kh_begin(rp->mces->ht); k != kh_end(rp->mces->ht); ++k){
+        if (kh_exist(rp->mces->ht, k)){
+            lisp_addr_del(kh_value(rp->mces->ht, k));
+        }
+    }
+    htable_ptrs_destroy(rp->mces);
+    lisp_addr_del(rp->addr);
+    free(rp);
+}
+
+/* Remove the map cache entry from the entries using the RLOCs of its locators.
+ * The probing of a RLOC without entries stops with its next probe */
+static void
+rloc_probing_forget_mce(lisp_xtr_t *xtr, mcache_entry_t *mce)
+{
+    rloc_probe_t *rp;
+    locator_t *loct;
+    lisp_addr_t *eid;
+    pkt_eid_key_t key;
+    khiter_t k;
+
+    mapping_foreach_locator(mcache_entry_mapping(mce),loct){
+        if (pkt_eid_key_init(&key, locator_addr(loct)) != GOOD){
+            continue;
+        }
+        k = kh_get(rloc_probes, xtr->rloc_probes, key);
+        if (k == kh_end(xtr->rloc_probes)){
+            continue;
+        }
+        rp = kh_value(xtr->rloc_probes, k);
+        eid = htable_ptrs_remove(rp->mces, mce);
+        if (eid){
+            lisp_addr_del(eid);
+        }
+    }mapping_foreach_locator_end;
+}
+
+/* Stop the probing of the RLOC and remove it from the table of probed RLOCs */
+static void
+rloc_probe_remove(lisp_xtr_t *xtr, rloc_probe_t *rp)
+{
+    khiter_t k;
+
+    k = kh_get(rloc_probes, xtr->rloc_probes, rp->key);
+    if (k != kh_end(xtr->rloc_probes)){
+        kh_del(rloc_probes, xtr->rloc_probes, k);
+    }
+    rloc_probe_del(rp);
+}
+
+mreq_batch_t *
+mreq_batch_new_init(lisp_addr_t *map_resolver, lisp_addr_t *src_eid)
+{
+    mreq_batch_t *batch = xzalloc(sizeof(mreq_batch_t));
+    batch->map_resolver = lisp_addr_clone(map_resolver);
+    batch->src_eid = lisp_addr_clone(src_eid);
+    return (batch);
+}
+
+void
+mreq_batch_del(mreq_batch_t *batch)
+{
+    lisp_addr_del(batch->map_resolver);
+    lisp_addr_del(batch->src_eid);
+    free(batch);
 }
 
 timer_map_req_argument *
@@ -23,8 +23,15 @@
 
 #include "oor_ctrl_device.h"
 #include "../defs.h"
+#include "../elibs/khash/khash.h"
+#include "../elibs/ovs/list.h"
 #include "../fwd_policies/fwd_policy.h"
+#include "../lib/int_table.h"
+#include "../lib/packets.h"
+#include "../lib/pointers_table.h"
 #include "../lib/shash.h"
+#include "../lib/static_map_cache.h"
+#include "../lib/token_bucket.h"
 
 
 typedef enum tr_type {
@@ -39,6 +46,58 @@ typedef enum {
     AFTER_DRAFT_VER_4
 }nat_version;
 
+/* RLOC probing of a remote RLOC. The probes and their state are shared by all
+ * the map cache entries with a locator with this address */
+typedef struct rloc_probe_ {
+    lisp_addr_t *addr;
+    /* Binary address of the RLOC. Key of the table of probed RLOCs */
+    pkt_eid_key_t key;
+    uint8_t state;
+    locator_probe_inf_t inf;
+    /* Map cache entries using the RLOC <mcache_entry_t *, lisp_addr_t *eid> */
+    htable_ptrs_t *mces;
+    oor_timer_t *timer;
+} rloc_probe_t;
+
+KHASH_INIT(rloc_probes, pkt_eid_key_t, rloc_probe_t *, 1, pkt_eid_key_hash_val, pkt_eid_key_equal)
+
+/* Token bucket of a source EID or of a Map Resolver */
+typedef struct mreq_limits_bucket_ {
+    pkt_eid_key_t key;
+    token_bucket_t tb;
+    struct ovs_list lru_node;
+} mreq_limits_bucket_t;
+
+KHASH_INIT(mreq_buckets, pkt_eid_key_t, mreq_limits_bucket_t *, 1, pkt_eid_key_hash_val, pkt_eid_key_equal)
+
+/* Buckets indexed by the binary address. When the table has
+ * MAP_REQUEST_LIMITS_MAX_BUCKETS buckets, the least recently used one is
+ * reused for the new address */
+typedef struct mreq_limits_table_ {
+    khash_t(mreq_buckets) *htable;
+    struct ovs_list lru; /* <mreq_limits_bucket_t> Least recently used first */
+} mreq_limits_table_t;
+
+/* Hierarchical limits of the Map-Requests generated by the map cache misses.
+ * A miss is only requested when the global, the source EID and the Map
+ * Resolver buckets have a token */
+typedef struct mreq_limits_ {
+    /* Map-Requests per second and burst of each level. Rate 0: No limit */
+    int global_rate;
+    int global_burst;
+    int src_eid_rate;
+    int src_eid_burst;
+    int mr_rate;
+    int mr_burst;
+    token_bucket_t global;
+    mreq_limits_table_t src_eids;
+    mreq_limits_table_t map_resolvers;
+    /* Number of misses not requested because of each level */
+    uint64_t suppressed_global;
+    uint64_t suppressed_src_eid;
+    uint64_t suppressed_mr;
+} mreq_limits_t;
+
 typedef struct lisp_xtr {
     oor_ctrl_dev_t super; /* base "class" */
 
@@ -51,9 +110,17 @@ typedef struct lisp_xtr {
     int (*add_mapping_to_local_map_db)(mapping_t *mapping);
 
     int map_request_retries;
+    /* Time (ms) the Map-Requests of cache misses wait to be sent together.
+     * 0: Map-Requests are not batched */
+    int map_request_batch_window;
+    glist_t *mreq_batches; /* <mreq_batch_t *> Batches not sent yet */
+    mreq_limits_t mreq_limits;
     int probe_interval;
     int probe_retries;
     int probe_retries_interval;
+    /* Minimum interval between probes (ms). 0: Probes are sent every
+     * probe_interval seconds */
+    int probe_min_interval;
 
     mcache_entry_t *petrs_ipv4; // PeTR used for IPv4 EIDs
     mcache_entry_t *petrs_ipv6; // PeTR used for IPv6 EIDs
@@ -61,6 +128,9 @@ typedef struct lisp_xtr {
 
     /* DATABASES */
     map_cache_db_t *map_cache;
+    /* Prefixes of the static map cache file. Their map cache entries are
+     * created when they are used */
+    static_mcache_t *static_mcache;
     local_map_db_t *local_mdb;
 
     /* FWD POLICY */
@@ -85,6 +155,7 @@ typedef struct lisp_xtr {
 
     /* MAPPING IFACE TO LOCATORS */
     shash_t *iface_locators_table; /* Key: Iface name, Value: iface_locators */
+    khash_t(rloc_probes) *rloc_probes; /* Key: RLOC address, Value: rloc_probe_t */
 
     /* LOCAL IFACE MAPPING */
     /* in case of RTR can be used for outgoing load balancing */
@@ -100,10 +171,16 @@ typedef struct map_server_elt_t {
     uint8_t         proxy_reply;
 } map_server_elt;
 
-typedef struct _timer_rloc_prob_argument {
-    mcache_entry_t *mce;
-    locator_t      *locator;
-} timer_rloc_probe_argument;
+/* Map-Requests of cache misses sent together in a multi-record Map-Request.
+ * The requested entries are identified by the nonces of their retry timers */
+typedef struct mreq_batch_ {
+    lisp_addr_t *map_resolver;
+    lisp_addr_t *src_eid;
+    uint64_t nonces[MAP_REQUEST_BATCH_MAX_RECORDS];
+    int count;
+    uint8_t sent;
+    oor_timer_t *timer;
+} mreq_batch_t;
 
 typedef struct _timer_map_req_argument {
     mcache_entry_t  *mce;
@@ -140,6 +217,9 @@ void send_smr_and_mreg_for_locl_mapping(lisp_xtr_t *xtr, map_local_entry_t *map_
 int tr_mcache_add_mapping(lisp_xtr_t *, mapping_t *);
 int tr_mcache_add_static_mapping(lisp_xtr_t *, mapping_t *);
 int tr_mcache_remove_entry(lisp_xtr_t *xtr, mcache_entry_t *mce);
+int tr_mcache_remove_iid(lisp_xtr_t *xtr, uint32_t iid);
+int_htable *tr_local_db_iids(lisp_xtr_t *xtr);
+void tr_mcache_remove_unused_iids(lisp_xtr_t *xtr, int_htable *old_iids);
 mapping_t *tr_mcache_lookup_mapping(lisp_xtr_t *, lisp_addr_t *);
 mapping_t *tr_mcache_lookup_mapping_exact(lisp_xtr_t *, lisp_addr_t *);
 
@@ -307,6 +307,15 @@ ctrl_datap_reset_all_fwd()
     return (data_plane->datap_reset_all_fwd());
 }
 
+time_t
+ctrl_datap_fwd_entry_last_used(lisp_addr_t *eid_prefix)
+{
+    if (!data_plane->datap_fwd_entry_last_used){
+        return (0);
+    }
+    return (data_plane->datap_fwd_entry_last_used(eid_prefix));
+}
+
 /*
  * Multicast Interface to end-hosts
  */
@@ -74,6 +74,7 @@ int ctrl_notify_mapping_change_to_dp(lisp_addr_t *eid_prefix, uint8_t is_local);
 
 int ctrl_datap_rm_fwd_from_entry(lisp_addr_t *eid_prefix, uint8_t is_local);
 int ctrl_datap_reset_all_fwd();
+time_t ctrl_datap_fwd_entry_last_used(lisp_addr_t *eid_prefix);
 
 
 void multicast_join_channel(lisp_addr_t *src, lisp_addr_t *grp);
@@ -106,6 +106,12 @@ notify_datap_reset_all_fwd(oor_ctrl_dev_t *dev)
     return(ctrl_datap_reset_all_fwd());
 }
 
+time_t
+datap_fwd_entry_last_used(oor_ctrl_dev_t *dev, lisp_addr_t *eid_prefix)
+{
+    return(ctrl_datap_fwd_entry_last_used(eid_prefix));
+}
+
 int
 ctrl_dev_if_link_update(oor_ctrl_dev_t *dev, char *iface_name, uint8_t status)
 {
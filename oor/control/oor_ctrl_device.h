@@ -73,6 +73,7 @@ fwd_info_t *ctrl_dev_get_fwd_entry(oor_ctrl_dev_t *, packet_tuple_t *);
 
 int notify_datap_rm_fwd_from_entry(oor_ctrl_dev_t *dev, lisp_addr_t *eid_prefix, uint8_t is_local);
 int notify_datap_reset_all_fwd(oor_ctrl_dev_t *dev);
+time_t datap_fwd_entry_last_used(oor_ctrl_dev_t *dev, lisp_addr_t *eid_prefix);
 /* PRIVATE functions, used by xtr and ms */
 int send_msg(oor_ctrl_dev_t *, lbuf_t *, uconn_t *);
 
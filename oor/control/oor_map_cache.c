@@ -20,6 +20,8 @@
 #include "oor_map_cache.h"
 #include "../lib/oor_log.h"
 #include <math.h>
+#include <string.h>
+#include <time.h>
 
 
 map_cache_db_t*
@@ -36,6 +38,9 @@ mcache_new()
         OOR_LOG(LCRIT, "Could create map cache db ");
         return(NULL);
     }
+    /* The map cache is looked up for each new flow */
+    mdb_enable_lpm(mcdb->db);
+    list_init(&mcdb->lru);
 
     return(mcdb);
 }
@@ -51,13 +56,148 @@ mcache_del(map_cache_db_t *mcdb)
 int
 mcache_add_entry(map_cache_db_t *mcdb, lisp_addr_t *key, mcache_entry_t *mce)
 {
-    return(mdb_add_entry(mcdb->db, key, mce));
+    if (mdb_add_entry(mcdb->db, key, mce) != GOOD){
+        return (BAD);
+    }
+    if (mcache_entry_evictable(mce)){
+        mce->last_used = time(NULL);
+        mce->mem_size = mcache_entry_mem_size(mce);
+        list_push_back(&mcdb->lru, &mce->lru_node);
+        mcdb->nentries++;
+        mcdb->bytes += mce->mem_size;
+    }
+    return (GOOD);
 }
 
 void *
 mcache_remove_entry(map_cache_db_t *mcdb, lisp_addr_t *key)
 {
-    return(mdb_remove_entry(mcdb->db, key));
+    mcache_entry_t *mce;
+
+    mce = mdb_remove_entry(mcdb->db, key);
+    if (mce && mcache_entry_evictable(mce)){
+        list_remove(&mce->lru_node);
+        mcdb->nentries--;
+        mcdb->bytes -= mce->mem_size;
+    }
+    return (mce);
+}
+
+typedef struct mcache_rm_iid_arg_ {
+    map_cache_db_t *mcdb;
+    void (*callback)(void *, void *);
+    void *cb_data;
+} mcache_rm_iid_arg_t;
+
+static void
+mcache_iid_entry_removed(void *entry, void *arg)
+{
+    mcache_rm_iid_arg_t *rm_arg = arg;
+    mcache_entry_t *mce = entry;
+
+    if (mcache_entry_evictable(mce)){
+        list_remove(&mce->lru_node);
+        rm_arg->mcdb->nentries--;
+        rm_arg->mcdb->bytes -= mce->mem_size;
+    }
+    if (rm_arg->callback){
+        rm_arg->callback(mce, rm_arg->cb_data);
+    }
+}
+
+/* Remove all the entries of an instance ID. The callback takes the ownership
+ * of each entry removed. Return the number of entries removed */
+int
+mcache_remove_iid(map_cache_db_t *mcdb, uint32_t iid,
+        void (*callback)(void *, void *), void *cb_data)
+{
+    mcache_rm_iid_arg_t rm_arg;
+
+    rm_arg.mcdb = mcdb;
+    rm_arg.callback = callback;
+    rm_arg.cb_data = cb_data;
+    return (mdb_remove_iid(mcdb->db, iid, mcache_iid_entry_removed, &rm_arg));
+}
+
+void
+mcache_set_limits(map_cache_db_t *mcdb, uint32_t max_entries, size_t max_bytes)
+{
+    mcdb->max_entries = max_entries;
+    mcdb->max_bytes = max_bytes;
+}
+
+/* Check if a new evictable entry of 'size' bytes exceeds the limits */
+int
+mcache_is_full(map_cache_db_t *mcdb, size_t size)
+{
+    if (mcdb->max_entries != 0 && mcdb->nentries >= mcdb->max_entries){
+        return (TRUE);
+    }
+    if (mcdb->max_bytes != 0 && mcdb->bytes + size > mcdb->max_bytes){
+        return (TRUE);
+    }
+    return (FALSE);
+}
+
+/* Least recently used evictable entry. NULL if there are no such entries */
+mcache_entry_t *
+mcache_lru_entry(map_cache_db_t *mcdb)
+{
+    if (list_is_empty(&mcdb->lru)){
+        return (NULL);
+    }
+    return (CONTAINER_OF(list_front(&mcdb->lru), mcache_entry_t, lru_node));
+}
+
+/* Mark the entry as used at time 'now' */
+void
+mcache_touch_entry(map_cache_db_t *mcdb, mcache_entry_t *mce, time_t now)
+{
+    if (!mcache_entry_evictable(mce)){
+        return;
+    }
+    mce->last_used = now;
+    list_remove(&mce->lru_node);
+    list_push_back(&mcdb->lru, &mce->lru_node);
+}
+
+/* Called when the locators of an entry change */
+void
+mcache_update_entry_size(map_cache_db_t *mcdb, mcache_entry_t *mce)
+{
+    if (!mcache_entry_evictable(mce)){
+        return;
+    }
+    mcdb->bytes -= mce->mem_size;
+    mce->mem_size = mcache_entry_mem_size(mce);
+    mcdb->bytes += mce->mem_size;
+}
+
+/* Memory accounting of the map cache. The bytes include the static entries
+ * and the timers of the entries */
+void
+mcache_get_stats(map_cache_db_t *mcdb, mcache_stats_t *stats)
+{
+    mcache_entry_t *mce;
+    void *it;
+    int timers;
+
+    memset(stats, 0, sizeof(mcache_stats_t));
+    mdb_foreach_entry(mcdb->db, it) {
+        mce = (mcache_entry_t *)it;
+        stats->entries++;
+        if (mce->active){
+            stats->active_entries++;
+        }
+        if (mce->how_learned == MCE_STATIC){
+            stats->static_entries++;
+        }
+        stats->locators += mapping_locator_count(mcache_entry_mapping(mce));
+        timers = mcache_entry_timers_count(mce);
+        stats->timers += timers;
+        stats->bytes += mcache_entry_mem_size(mce) + timers * sizeof(oor_timer_t);
+    } mdb_foreach_entry_end;
+    stats->evictions = mcdb->evictions;
 }
 
 
@@ -88,9 +228,15 @@ void mcache_dump_db(map_cache_db_t *mcdb, int log_level)
     }
 
     mcache_entry_t *mce;
+    mcache_stats_t stats;
     void *it;
 
     OOR_LOG(log_level,"**************** LISP Mapping Cache ******************\n");
+    mcache_get_stats(mcdb, &stats);
+    OOR_LOG(log_level,"Entries: %u (%u active, %u static), Locators: %u, "
+            "Timers: %u, Memory: %zu bytes, Evictions: %"PRIu64"\n",
+            stats.entries, stats.active_entries, stats.static_entries,
+            stats.locators, stats.timers, stats.bytes, stats.evictions);
     mdb_foreach_entry(mcdb->db, it) {
         mce = (mcache_entry_t *)it;
         map_cache_entry_dump(mce, log_level);
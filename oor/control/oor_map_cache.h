@@ -25,22 +25,55 @@
 #include "../lib/mapping_db.h"
 #include "../liblisp/liblisp.h"
 
+/* Maximum number of entries with traffic in the data plane moved to the back
+ * of the LRU list before evicting the least recently used one */
+#define MCACHE_MAX_EVICTION_SCAN    64
+
 typedef struct map_cache_db {
     mdb_t *db;
+    /* Dynamic entries and entries of the static map cache file from the least
+     * to the most recently used. Configured static entries are never evicted
+     * and are not accounted in the limits */
+    struct ovs_list lru;
+    uint32_t nentries;
+    size_t bytes;
+    /* Limits of the evictable entries. 0: No limit */
+    uint32_t max_entries;
+    size_t max_bytes;
+    uint64_t evictions;
 } map_cache_db_t;
 
+typedef struct mcache_stats_ {
+    uint32_t entries;
+    uint32_t active_entries;
+    uint32_t static_entries;
+    uint32_t locators;
+    uint32_t timers;
+    size_t bytes;
+    uint64_t evictions;
+} mcache_stats_t;
+
 map_cache_db_t *mcache_new();
 void mcache_del(map_cache_db_t *mcdb);
 
 
 int mcache_add_entry(map_cache_db_t *, lisp_addr_t *key, mcache_entry_t *entry);
 void *mcache_remove_entry(map_cache_db_t *, lisp_addr_t *key);
+int mcache_remove_iid(map_cache_db_t *, uint32_t iid,
+        void (*callback)(void *, void *), void *cb_data);
 void map_cache_del_entry(map_cache_db_t *, lisp_addr_t *laddr);
 mcache_entry_t *mcache_lookup_exact(map_cache_db_t *, lisp_addr_t *addr);
 mcache_entry_t *mcache_lookup(map_cache_db_t *, lisp_addr_t *addr);
 
 void mcache_dump_db(map_cache_db_t *, int log_level);
 
+void mcache_set_limits(map_cache_db_t *, uint32_t max_entries, size_t max_bytes);
+int mcache_is_full(map_cache_db_t *, size_t size);
+mcache_entry_t *mcache_lru_entry(map_cache_db_t *);
+void mcache_touch_entry(map_cache_db_t *, mcache_entry_t *, time_t now);
+void mcache_update_entry_size(map_cache_db_t *, mcache_entry_t *);
+void mcache_get_stats(map_cache_db_t *, mcache_stats_t *);
+
 #define mcache_foreach_entry(MC, EIT)               \
     mdb_foreach_entry((MC)->db, (EIT)) {
 
@@ -22,6 +22,17 @@
 
 data_plane_struct_t *data_plane = NULL;
 
+data_plane_conf_t data_plane_conf = {
+        .burst_size = DATA_PLANE_DEFAULT_BURST_SIZE,
+        .workers = 0,
+        .tun_queues = 1,
+        .offload = FALSE,
+        .flow_table_size = DATA_PLANE_DEFAULT_FLOW_TABLE_SIZE,
+        .flow_idle_timeout = DATA_PLANE_DEFAULT_FLOW_IDLE_TIMEOUT,
+        .udp_src_port_entropy = FALSE,
+        .ipv4_udp_checksum = TRUE
+};
+
 void data_plane_select()
 {
 #ifdef VPNAPI
@@ -24,6 +24,47 @@
 typedef struct iface iface_t;
 typedef struct sock sock_t;
 
+/* Maximum number of packets read or sent per socket event */
+#define DATA_PLANE_MAX_BURST_SIZE       64
+#define DATA_PLANE_DEFAULT_BURST_SIZE   32
+/* Maximum number of threads processing data packets */
+#define DATA_PLANE_MAX_WORKERS          64
+/* Flows with forwarding information cached by the data plane */
+#define DATA_PLANE_DEFAULT_FLOW_TABLE_SIZE      10000
+/* Seconds without traffic before removing the cached information of a flow */
+#define DATA_PLANE_DEFAULT_FLOW_IDLE_TIMEOUT    300
+/* Range of the outer UDP source ports derived from the hash of the inner
+ * flow (dynamic ports range of RFC 6335) */
+#define DATA_PLANE_UDP_SRC_PORT_MIN     49152
+#define DATA_PLANE_UDP_SRC_PORT_RANGE   16384
+
+/* Tunable parameters of the data plane. Filled during the parse of the
+ * configuration file. Each data plane uses the ones it supports */
+typedef struct data_plane_conf_ {
+    /* Packets processed per socket event. 1 disables batched I/O */
+    int burst_size;
+    /* Threads dedicated to process data packets. 0 processes them in the
+     * main thread */
+    int workers;
+    /* Queues of the tun interface. With more than one queue, each one is
+     * read by its own worker */
+    int tun_queues;
+    /* Exchange with the tun TCP packets of up to 64KB and use UDP
+     * segmentation / receive offload in the data sockets */
+    int offload;
+    /* Maximum number of flows of the flow table. When full, the least
+     * recently used flows are evicted */
+    int flow_table_size;
+    /* Seconds without traffic before a flow is removed. 0 disables it */
+    int flow_idle_timeout;
+    /* Outer UDP source port derived from the hash of the inner flow instead
+     * of the port of the encapsulation */
+    int udp_src_port_entropy;
+    /* Calculate the outer UDP checksum of IPv4 encapsulated packets. When
+     * disabled it is sent as zero. It is always calculated with IPv6 */
+    int ipv4_udp_checksum;
+} data_plane_conf_t;
+
 /* functions to manipulate routing */
 typedef struct data_plane_struct {
     int (*datap_init)(oor_dev_type_e dev_type, oor_encap_t encap_type,  ...);
@@ -41,12 +82,17 @@ typedef struct data_plane_struct {
     int (*datap_update_link)(iface_t *iface, int old_iface_index, int new_iface_index, int status);
     int (*datap_rm_fwd_from_entry)(lisp_addr_t *eid_prefix, uint8_t is_local);
     int (*datap_reset_all_fwd)();
+    /* Last time the data plane forwarded traffic using the entry. 0 if it is
+     * not used or the data plane doesn't track it. Optional */
+    time_t (*datap_fwd_entry_last_used)(lisp_addr_t *eid_prefix);
 
     void *datap_data;
 } data_plane_struct_t;
 
 void data_plane_select();
 
+extern data_plane_conf_t data_plane_conf;
+
 extern data_plane_struct_t dplane_tun;
 extern data_plane_struct_t dplane_vpnapi;
 extern data_plane_struct_t dplane_vpp;
@@ -84,6 +84,31 @@ vxlan_gpe_data_encap(lbuf_t *b, int lp, int rp, lisp_addr_t *la, lisp_addr_t *ra
     return(lbuf_data(b));
 }
 
+/* Prebuild the outer headers used by vxlan_gpe_data_encap */
+int
+vxlan_gpe_data_encap_tmpl_init(pkt_encap_tmpl_t *tmpl, int lp, int rp,
+        lisp_addr_t *la, lisp_addr_t *ra, uint32_t vni)
+{
+    vxlan_gpe_hdr_t vhdr;
+    vxlan_gpe_nprot_t next_prot;
+
+    switch (lisp_addr_ip_afi(la)){
+    case AF_INET:
+        next_prot = NP_IPv4;
+        break;
+    case AF_INET6:
+        next_prot = NP_IPv6;
+        break;
+    default:
+        OOR_LOG(LDBG_1, "vxlan_gpe_data_encap_tmpl_init: Next protocol not supported");
+        return (BAD);
+    }
+
+    vxlan_gpe_data_hdr_init(&vhdr, vni, next_prot);
+    return (pkt_encap_tmpl_init(tmpl, &vhdr, sizeof(vxlan_gpe_hdr_t), lp, rp,
+            lisp_addr_ip(la), lisp_addr_ip(ra)));
+}
+
 void *
 vxlan_gpe_data_pull_hdr(lbuf_t *b)
 {
@@ -17,42 +17,108 @@
  *
  */
 
+#include <string.h>
+
 #include "ttable.h"
 #include "../lib/mem_util.h"
 #include "../lib/packets.h"
 #include "../lib/oor_log.h"
+#include "../lib/rcu.h"
 #include "../lib/sockets.h"
 #include "../fwd_policies/fwd_policy.h"
 #include "../liblisp/liblisp.h"
 
 
-/* Maximum size of the tuple table */
-#define MAX_SIZE 10000
+/* The entries of all the tables are allocated from the same pool. The tables
+ * are only modified by the main thread */
+static mem_pool_t ttable_entry_pool = MEM_POOL_INITIALIZER("ttable_entry",
+        sizeof(ttable_entry_t));
 
-void ttable_remove_with_khiter(ttable_t *tt, khiter_t k);
+static void ttable_alloc_buckets(ttable_t *tt, uint32_t max_size);
+static ttable_entry_t *ttable_find(ttable_t *tt, pkt_flow_key_t *key,
+        uint32_t hash);
+static void ttable_entry_free(void *arg);
+static void ttable_remove_entry(ttable_t *tt, ttable_entry_t *entry);
+static void ttable_drop_entry(ttable_t *tt, ttable_entry_t *entry);
+static int ttable_evict(ttable_t *tt);
 
 
 void
 ttable_init(ttable_t *tt)
 {
-    tt->htable =  kh_init(ttable);
+    tt->buckets = NULL;
+    tt->size = 0;
+    ttable_alloc_buckets(tt, TTABLE_DEFAULT_MAX_SIZE);
     list_init(&tt->head_list);
+    tt->max_size = TTABLE_DEFAULT_MAX_SIZE;
+    tt->idle_timeout = 0;
+    tt->now = time(NULL);
+    tt->rm_fn = NULL;
+    memset(&tt->stats, 0, sizeof(ttable_stats_t));
+}
+
+/* One bucket per flow the table can hold. The buckets are only replaced
+ * while the table is empty and not shared */
+static void
+ttable_alloc_buckets(ttable_t *tt, uint32_t max_size)
+{
+    uint32_t nbuckets = 1;
+
+    while (nbuckets < max_size && nbuckets < (1U << 31)){
+        nbuckets <<= 1;
+    }
+    if (tt->buckets && tt->mask + 1 == nbuckets){
+        return;
+    }
+    free(tt->buckets);
+    tt->buckets = xzalloc(nbuckets * sizeof(ttable_entry_t *));
+    tt->mask = nbuckets - 1;
 }
 
+/* Set the capacity and the idle timeout of the table. Entries are only
+ * evicted or expired when a removal function is provided, as the owner of the
+ * table may keep references to the tuples */
+void
+ttable_conf(ttable_t *tt, uint32_t max_size, uint32_t idle_timeout,
+        ttable_rm_fn rm_fn)
+{
+    tt->max_size = max_size;
+    tt->idle_timeout = idle_timeout;
+    tt->rm_fn = rm_fn;
+    if (tt->size == 0){
+        ttable_alloc_buckets(tt, max_size);
+    }
+}
+
+/* The table should no longer be shared with other threads */
 void
 ttable_uninit(ttable_t *tt)
 {
-    khiter_t k;
-    fwd_info_t *fi;
+    ttable_entry_t *entry, *next;
 
-    for (k = kh_begin(tt->htable); k != kh_end(tt->htable); ++k){
-        if (kh_exist(tt->htable, k)){
-            // The key is remove when removing value
-            fi = kh_value(tt->htable,k);
-            fwd_info_del(fi);
-        }
+    LIST_FOR_EACH_SAFE(entry, next, list, &tt->head_list){
+        // The tuple is removed when removing value
+        ttable_entry_free(entry);
+    }
+    free(tt->buckets);
+    tt->buckets = NULL;
+}
+
+/* Release all the entries of the table keeping its configuration */
+void
+ttable_flush(ttable_t *tt)
+{
+    ttable_entry_t *entry, *next;
+    uint32_t i;
+
+    for (i = 0; i <= tt->mask; i++){
+        __atomic_store_n(&tt->buckets[i], NULL, __ATOMIC_RELEASE);
+    }
+    LIST_FOR_EACH_SAFE(entry, next, list, &tt->head_list){
+        rcu_defer(ttable_entry_free, entry);
     }
-    kh_destroy(ttable, tt->htable);
+    list_init(&tt->head_list);
+    tt->size = 0;
 }
 
 ttable_t *
@@ -70,21 +136,67 @@ ttable_destroy(ttable_t *tt)
     free(tt);
 }
 
+static ttable_entry_t *
+ttable_find(ttable_t *tt, pkt_flow_key_t *key, uint32_t hash)
+{
+    ttable_entry_t *entry;
+
+    entry = __atomic_load_n(&tt->buckets[hash & tt->mask], __ATOMIC_ACQUIRE);
+    while (entry){
+        if (entry->hash == hash && pkt_flow_key_equal(entry->key, *key)){
+            return (entry);
+        }
+        entry = __atomic_load_n(&entry->next, __ATOMIC_ACQUIRE);
+    }
+    return (NULL);
+}
 
 int
 ttable_insert(ttable_t *tt, packet_tuple_t *tpl, fwd_info_t *fi)
 {
-    khiter_t k;
-    int ret;
+    pkt_flow_key_t key;
+
+    pkt_flow_key_init(&key, tpl);
+    return (ttable_insert_key(tt, &key, pkt_flow_key_hash(&key), tpl, fi));
+}
 
-    /* If table is full remove old entries */
-    if (kh_size(tt->htable) >= MAX_SIZE) {
+/* Insert the flow with the key and hash of the tupla already calculated by
+ * the caller */
+int
+ttable_insert_key(ttable_t *tt, pkt_flow_key_t *key, uint32_t hash,
+        packet_tuple_t *tpl, fwd_info_t *fi)
+{
+    ttable_entry_t *entry, **bucket;
+
+    if (ttable_find(tt, key, hash)){
+        /* The flow is already in the table */
+        return (BAD);
+    }
+
+    /* If table is full remove the least recently used entries */
+    if (tt->size >= tt->max_size && ttable_evict(tt) != GOOD) {
         OOR_LOG(LDBG_1,"ttable_insert: Max size of forwarding table reached.");
         return (BAD);
     }
 
-    k = kh_put(ttable,tt->htable,tpl,&ret);
-    kh_value(tt->htable, k) = fi;
+    entry = mem_pool_alloc(&ttable_entry_pool);
+    if (!entry){
+        return (BAD);
+    }
+    __atomic_store_n(&tt->now, time(NULL), __ATOMIC_RELAXED);
+    entry->key = *key;
+    entry->hash = hash;
+    entry->tpl = tpl;
+    entry->fi = fi;
+    entry->last_used = tt->now;
+    entry->referenced = FALSE;
+    list_push_back(&tt->head_list, &entry->list);
+    /* The entry is visible to the readers once initialized */
+    bucket = &tt->buckets[hash & tt->mask];
+    entry->next = *bucket;
+    __atomic_store_n(bucket, entry, __ATOMIC_RELEASE);
+    tt->size++;
+    tt->stats.insertions++;
     OOR_LOG(LDBG_3,"ttable_insert: Inserted tupla: %s ", pkt_tuple_to_char(tpl));
     return (GOOD);
 }
@@ -92,46 +204,153 @@ ttable_insert(ttable_t *tt, packet_tuple_t *tpl, fwd_info_t *fi)
 void
 ttable_remove(ttable_t *tt, packet_tuple_t *tpl)
 {
-    khiter_t k;
-    fwd_info_t *fi;
+    ttable_entry_t *entry;
+    pkt_flow_key_t key;
 
-    k = kh_get(ttable,tt->htable, tpl);
-    if (k == kh_end(tt->htable)){
+    pkt_flow_key_init(&key, tpl);
+    entry = ttable_find(tt, &key, pkt_flow_key_hash(&key));
+    if (!entry){
         return;
     }
 
-    fi = kh_value(tt->htable,k);
     OOR_LOG(LDBG_3,"ttable_remove: Remove tupla: %s ", pkt_tuple_to_char(tpl));
-    // We don't remove the key (tuple). It is part of the fwd_info_t;
-    /* Free value */
-    fwd_info_del(fi);
-    /* Remove entry from hash table */
-    kh_del(ttable,tt->htable,k);
+    ttable_remove_entry(tt, entry);
 }
 
-void
-ttable_remove_with_khiter(ttable_t *tt, khiter_t k)
+/* Release an entry. The tuple is part of the fwd_info_t and is released
+ * with it */
+static void
+ttable_entry_free(void *arg)
 {
-    fwd_info_t *fi;
+    ttable_entry_t *entry = arg;
 
-    fi = kh_value(tt->htable,k);
-    OOR_LOG(LDBG_3,"ttable_remove_with_khiter: Remove tupla: %s ", pkt_tuple_to_char((packet_tuple_t *)fi->dp_conf_inf));
-    fwd_info_del(fi);
-    kh_del(ttable,tt->htable,k);
+    fwd_info_del(entry->fi);
+    mem_pool_free(&ttable_entry_pool, entry);
 }
 
+/* Unlink the entry from its bucket. The readers in the entry can still follow
+ * its next pointer, so it is released after a grace period */
+static void
+ttable_remove_entry(ttable_t *tt, ttable_entry_t *entry)
+{
+    ttable_entry_t **prev;
+
+    prev = &tt->buckets[entry->hash & tt->mask];
+    while (*prev != entry){
+        prev = &(*prev)->next;
+    }
+    __atomic_store_n(prev, entry->next, __ATOMIC_RELEASE);
+    list_remove(&entry->list);
+    tt->size--;
+    rcu_defer(ttable_entry_free, entry);
+}
+
+/* Entry removed by the table itself. The owner is notified before releasing
+ * the forwarding information */
+static void
+ttable_drop_entry(ttable_t *tt, ttable_entry_t *entry)
+{
+    tt->rm_fn(entry->fi);
+    ttable_remove_entry(tt, entry);
+}
+
+/* CLOCK replacement: entries used since the last pass of the hand get a
+ * second chance and are moved to the back of the ring */
+static int
+ttable_evict(ttable_t *tt)
+{
+    ttable_entry_t *entry;
+    int scanned;
+
+    if (!tt->rm_fn || list_is_empty(&tt->head_list)){
+        return (BAD);
+    }
+
+    for (scanned = 0; scanned < TTABLE_MAX_EVICTION_SCAN; scanned++){
+        entry = CONTAINER_OF(list_front(&tt->head_list), ttable_entry_t, list);
+        if (!__atomic_load_n(&entry->referenced, __ATOMIC_RELAXED)){
+            break;
+        }
+        __atomic_store_n(&entry->referenced, FALSE, __ATOMIC_RELAXED);
+        list_remove(&entry->list);
+        list_push_back(&tt->head_list, &entry->list);
+    }
+    entry = CONTAINER_OF(list_front(&tt->head_list), ttable_entry_t, list);
+
+    OOR_LOG(LDBG_3,"ttable_evict: Evicting tupla: %s ", pkt_tuple_to_char(entry->tpl));
+    ttable_drop_entry(tt, entry);
+    tt->stats.evictions++;
+    return (GOOD);
+}
+
+/* Remove the entries not used during the idle timeout. Returns the number of
+ * removed entries */
+int
+ttable_expire(ttable_t *tt, time_t now)
+{
+    ttable_entry_t *entry, *next;
+    int removed = 0;
+
+    __atomic_store_n(&tt->now, now, __ATOMIC_RELAXED);
+    if (!tt->rm_fn || tt->idle_timeout == 0){
+        return (0);
+    }
+
+    LIST_FOR_EACH_SAFE(entry, next, list, &tt->head_list){
+        if (now - __atomic_load_n(&entry->last_used, __ATOMIC_RELAXED) < tt->idle_timeout){
+            continue;
+        }
+        OOR_LOG(LDBG_3,"ttable_expire: Expired tupla: %s ", pkt_tuple_to_char(entry->tpl));
+        ttable_drop_entry(tt, entry);
+        removed++;
+    }
+    tt->stats.expirations += removed;
+    return (removed);
+}
+
+/* It can be called by other threads than the one modifying the table. The
+ * forwarding information can be used until the next quiescent state */
 fwd_info_t *
 ttable_lookup(ttable_t *tt, packet_tuple_t *tpl)
 {
-    fwd_info_t *fi;
-    khiter_t k;
+    pkt_flow_key_t key;
 
-    k = kh_get(ttable,tt->htable, tpl);
-    if (k == kh_end(tt->htable)){
+    pkt_flow_key_init(&key, tpl);
+    return (ttable_lookup_key(tt, &key, pkt_flow_key_hash(&key)));
+}
+
+/* Look up the flow with the key and hash of the tupla already calculated by
+ * the caller */
+fwd_info_t *
+ttable_lookup_key(ttable_t *tt, pkt_flow_key_t *key, uint32_t hash)
+{
+    ttable_entry_t *entry;
+
+    entry = ttable_find(tt, key, hash);
+    if (!entry){
+        tt->stats.misses++;
         return (NULL);
     }
-    fi = kh_value(tt->htable,k);
+    __atomic_store_n(&entry->referenced, TRUE, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->last_used, __atomic_load_n(&tt->now, __ATOMIC_RELAXED),
+            __ATOMIC_RELAXED);
+    tt->stats.hits++;
 
-    return (fi);
+    return (entry->fi);
 }
 
+/* Return the last time the flow was used, without marking it as used.
+ * 0 if the flow is not in the table */
+time_t
+ttable_last_used(ttable_t *tt, packet_tuple_t *tpl)
+{
+    ttable_entry_t *entry;
+    pkt_flow_key_t key;
+
+    pkt_flow_key_init(&key, tpl);
+    entry = ttable_find(tt, &key, pkt_flow_key_hash(&key));
+    if (!entry){
+        return (0);
+    }
+    return (__atomic_load_n(&entry->last_used, __ATOMIC_RELAXED));
+}
@@ -21,27 +21,86 @@
 #define TTABLE_H_
 
 #include <time.h>
-#include "../elibs/khash/khash.h"
 #include "../elibs/ovs/list.h"
 #include "../lib/packets.h"
 
 typedef struct fwd_info_ fwd_info_t;
 
+/* Default maximum number of flows of a tuple table */
+#define TTABLE_DEFAULT_MAX_SIZE     10000
+/* Maximum number of entries visited by the CLOCK hand to find a victim
+ * before evicting the entry it points to */
+#define TTABLE_MAX_EVICTION_SCAN    64
 
-KHASH_INIT(ttable, packet_tuple_t *, fwd_info_t *, 1, pkt_tuple_hash, pkt_tuple_cmp)
+/* Called when the table removes by itself an entry (eviction or idle timeout)
+ * before the forwarding information is released */
+typedef void (*ttable_rm_fn)(fwd_info_t *fi);
 
+typedef struct ttable_entry_ {
+    /* Next entry of the bucket */
+    struct ttable_entry_ *next;
+    /* The compact key of the flow is compared by the lookups */
+    pkt_flow_key_t key;
+    uint32_t hash;
+    packet_tuple_t *tpl;
+    fwd_info_t *fi;
+    struct ovs_list list;
+    time_t last_used;
+    /* Set when the entry is used. Cleared by the CLOCK hand */
+    uint8_t referenced;
+} ttable_entry_t;
+
+/* Statistics are updated without atomics and should be taken as an
+ * approximation when the table is shared between threads */
+typedef struct ttable_stats_ {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t insertions;
+    uint64_t evictions;
+    uint64_t expirations;
+} ttable_stats_t;
+
+/* Hash table with chained buckets. Only one thread modifies the table while
+ * other threads can look it up without locks: the entries are published in
+ * the buckets once initialized and the removed ones are released with
+ * rcu_defer, so the readers should report their quiescent states (rcu.h) */
 typedef struct ttable {
-    khash_t(ttable) *htable; //<packet_tuple_t *, fwd_info_t *>
-    struct ovs_list head_list; /* To order flows */
+    ttable_entry_t **buckets;
+    /* Number of buckets - 1. The number of buckets is a power of 2 */
+    uint32_t mask;
+    uint32_t size;
+    /* Ring of entries. The front is the CLOCK hand */
+    struct ovs_list head_list;
+    uint32_t max_size;
+    /* Seconds without traffic before an entry is removed. 0 disables it */
+    uint32_t idle_timeout;
+    /* Coarse clock used to time stamp the entries when they are used */
+    time_t now;
+    /* Without removal function, entries are never evicted */
+    ttable_rm_fn rm_fn;
+    ttable_stats_t stats;
 } ttable_t;
 
 void ttable_init(ttable_t *tt);
+void ttable_conf(ttable_t *tt, uint32_t max_size, uint32_t idle_timeout,
+        ttable_rm_fn rm_fn);
 void ttable_uninit(ttable_t *tt);
+void ttable_flush(ttable_t *tt);
 ttable_t *ttable_create();
 void ttable_destroy(ttable_t *tt);
 int ttable_insert(ttable_t *, packet_tuple_t *tpl, fwd_info_t *fe);
+int ttable_insert_key(ttable_t *tt, pkt_flow_key_t *key, uint32_t hash,
+        packet_tuple_t *tpl, fwd_info_t *fi);
 void ttable_remove(ttable_t *tt, packet_tuple_t *tpl);
 fwd_info_t *ttable_lookup(ttable_t *tt, packet_tuple_t *tpl);
+fwd_info_t *ttable_lookup_key(ttable_t *tt, pkt_flow_key_t *key, uint32_t hash);
+time_t ttable_last_used(ttable_t *tt, packet_tuple_t *tpl);
+int ttable_expire(ttable_t *tt, time_t now);
+static inline uint32_t
+ttable_size(ttable_t *tt)
+{
+    return (tt->size);
+}
 
 
 #endif /* TTABLE_H_ */
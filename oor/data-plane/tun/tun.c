@@ -18,16 +18,23 @@
  */
 
 
+#include <errno.h>
+#include <fcntl.h>
 #include <linux/rtnetlink.h>
 #include "tun.h"
 #include "tun_input.h"
+#include "tun_offload.h"
 #include "tun_output.h"
+#include "tun_worker.h"
 #include "../data-plane.h"
 #include "../../oor_external.h"
 #include "../../fwd_policies/fwd_policy.h"
 #include "../../lib/interfaces_lib.h"
+#include "../../lib/mem_util.h"
 #include "../../lib/oor_log.h"
+#include "../../lib/rcu.h"
 #include "../../lib/routing_tables_lib.h"
+#include "../../lib/sockets-util.h"
 
 int tun_configure_data_plane(oor_dev_type_e dev_type, oor_encap_t encap_type, ...);
 void tun_uninit_data_plane();
@@ -54,10 +61,16 @@ void tun_process_rm_gateway(iface_t *iface,lisp_addr_t *gateway);
 void tun_set_default_output_ifaces();
 void tun_iface_remove_routing_rules(iface_t *iface);
 int tun_rm_fwd_from_entry(lisp_addr_t *eid_prefix, uint8_t is_local);
-tun_dplane_data_t * tun_dplane_data_new_init(oor_encap_t encap_type);
+time_t tun_fwd_entry_last_used(lisp_addr_t *eid_prefix);
+tun_dplane_data_t * tun_dplane_data_new_init(oor_encap_t encap_type, int nworkers);
 void tun_dplane_data_free(tun_dplane_data_t *data);
+static int tun_ttable_aging_cb(oor_timer_t *timer);
+static int tun_open_data_input_socket(int afi, int data_port, uint8_t offload);
+static int tun_rm_eid_flows(tun_eid_index_t *idx, pkt_eid_key_t *key);
 
 
+tun_io_t tun_main_io;
+
 data_plane_struct_t dplane_tun = {
         .datap_init = tun_configure_data_plane,
         .datap_uninit = tun_uninit_data_plane,
@@ -73,6 +86,7 @@ data_plane_struct_t dplane_tun = {
         .datap_update_link = tun_updated_link,
         .datap_rm_fwd_from_entry = tun_rm_fwd_from_entry,
         .datap_reset_all_fwd = tun_reset_all_fwd,
+        .datap_fwd_entry_last_used = tun_fwd_entry_last_used,
         .datap_data = NULL
 };
 
@@ -82,6 +96,37 @@ tun_get_datap_data()
     return ((tun_dplane_data_t *)dplane_tun.datap_data);
 }
 
+/* Shard of the table of forwarding entries where the tupla is stored. The
+ * hash is the one of the flow key of the tupla, also used to find its bucket
+ * inside the shard */
+tun_ttable_shard_t *
+tun_get_ttable_shard(tun_dplane_data_t *data, uint32_t hash)
+{
+    if (data->nttables == 1){
+        return (&data->ttables[0]);
+    }
+    /* The low bits of the hash select the bucket inside the shard */
+    return (&data->ttables[(hash >> 24) % data->nttables]);
+}
+
+/* Open the socket used by the main thread to receive the data packets. With
+ * offload, it is a datagram socket that receives the packets of a flow
+ * coalesced (GRO). Otherwise, a raw socket */
+static int
+tun_open_data_input_socket(int afi, int data_port, uint8_t offload)
+{
+    int sock;
+
+    if (!offload){
+        return (open_data_raw_input_socket(afi, data_port));
+    }
+    sock = open_data_reuseport_input_socket(afi, data_port);
+    if (sock != ERR_SOCKET){
+        socket_conf_udp_gro(sock);
+    }
+    return (sock);
+}
+
 /*
  * tun_configure_data_plane not has variable list of parameters
  */
@@ -89,19 +134,46 @@ int
 tun_configure_data_plane(oor_dev_type_e dev_type, oor_encap_t encap_type, ...)
 {
     int (*cb_func)(sock_t *) = NULL;
-    int ipv4_data_input_fd = -1;
-    int ipv6_data_input_fd = -1;
+    int ipv4_data_input_fd = ERR_SOCKET;
+    int ipv6_data_input_fd = ERR_SOCKET;
+    int tun_fds[DATA_PLANE_MAX_WORKERS];
+    int ntun_fds, nworkers, i;
     int data_port;
+    tun_dplane_data_t *data;
 
-    /* Configure data plane */
-    tun_receive_fd = create_tun_tap(TUN, TUN_IFACE_NAME, TUN_MTU);
-    if (tun_receive_fd <= BAD){
-        return (BAD);
+    /* The tun is not read when working as RTR */
+    ntun_fds = dev_type == RTR_MODE ? 1 : data_plane_conf.tun_queues;
+
+    /* Configure data plane. The virtio-net header used by the offload
+     * is only supported by the multiqueue version */
+    if (ntun_fds > 1 || data_plane_conf.offload){
+        if (create_tun_tap_mq(TUN, TUN_IFACE_NAME, TUN_MTU, tun_fds, ntun_fds,
+                data_plane_conf.offload) != GOOD){
+            return (BAD);
+        }
+        tun_receive_fd = tun_fds[0];
+    }else{
+        tun_receive_fd = create_tun_tap(TUN, TUN_IFACE_NAME, TUN_MTU);
+        if (tun_receive_fd <= BAD){
+            return (BAD);
+        }
+        tun_fds[0] = tun_receive_fd;
     }
     tun_ifindex = if_nametoindex (TUN_IFACE_NAME);
+    /* In burst mode the tun is drained until no more packets are pending */
+    for (i = 0; i < ntun_fds && data_plane_conf.burst_size > 1; i++){
+        if (fcntl(tun_fds[i], F_SETFL, fcntl(tun_fds[i], F_GETFL, 0) | O_NONBLOCK) == -1){
+            OOR_LOG(LWRN, "tun_configure_data_plane: Couldn't set the tun interface as non blocking: %s",
+                    strerror(errno));
+        }
+    }
     switch (dev_type){
     case MN_MODE:
-        sockmstr_register_read_listener(smaster, tun_output_recv, NULL,tun_receive_fd);
+        /* With several queues, each one is read by a worker */
+        if (ntun_fds == 1){
+            sockmstr_register_read_listener_prio(smaster, tun_output_recv, NULL,
+                    tun_receive_fd, SOCK_PRIO_LOW);
+        }
         cb_func = tun_process_input_packet;
         break;
     case xTR_MODE:
@@ -109,7 +181,10 @@ tun_configure_data_plane(oor_dev_type_e dev_type, oor_encap_t encap_type, ...)
         /* Rules created for EID will redirect traffic to this table*/
         configure_routing_to_tun_router(AF_INET);
         configure_routing_to_tun_router(AF_INET6);
-        sockmstr_register_read_listener(smaster, tun_output_recv, NULL,tun_receive_fd);
+        if (ntun_fds == 1){
+            sockmstr_register_read_listener_prio(smaster, tun_output_recv, NULL,
+                    tun_receive_fd, SOCK_PRIO_LOW);
+        }
         cb_func = tun_process_input_packet;
         break;
     case RTR_MODE:
@@ -130,24 +205,100 @@ tun_configure_data_plane(oor_dev_type_e dev_type, oor_encap_t encap_type, ...)
         return (BAD);
     }
 
-    /* Generate receive sockets for data port (4341) */
-    if (default_rloc_afi != AF_INET6) {
-        ipv4_data_input_fd = open_data_raw_input_socket(AF_INET, data_port);
-        sockmstr_register_read_listener(smaster, cb_func, NULL,
-                ipv4_data_input_fd);
+    /* Worker i reads the data socket i and the queue i of the tun */
+    nworkers = data_plane_conf.workers;
+    if (ntun_fds > 1 && ntun_fds > nworkers){
+        nworkers = ntun_fds;
+    }
+    data = tun_dplane_data_new_init(encap_type, nworkers);
+    dplane_tun.datap_data = (void *)data;
+    if (ntun_fds > 1){
+        memcpy(data->tun_fds, tun_fds, ntun_fds * sizeof(int));
+        data->ntun_fds = ntun_fds;
     }
 
-    if (default_rloc_afi != AF_INET) {
-        ipv6_data_input_fd = open_data_raw_input_socket(AF_INET6, data_port);
-        sockmstr_register_read_listener(smaster, cb_func, NULL,
-                ipv6_data_input_fd);
+    tun_main_io.gso_sock_v4 = ERR_SOCKET;
+    tun_main_io.gso_sock_v6 = ERR_SOCKET;
+    if (data->offload){
+        tun_main_io.offload_buf = xmalloc(TUN_OFFLOAD_BUF_SIZE);
+    }
+
+    /* Generate receive sockets for data port (4341). When using workers, each
+     * one opens its own sockets. With offload, the packets are received with
+     * datagram sockets with UDP_GRO, as the workers do */
+    if (data_plane_conf.workers == 0){
+        if (data->offload){
+            cb_func = dev_type == RTR_MODE ? tun_rtr_process_input_datagram
+                    : tun_process_input_datagram;
+        }
+        if (default_rloc_afi != AF_INET6) {
+            ipv4_data_input_fd = tun_open_data_input_socket(AF_INET, data_port,
+                    data->offload);
+            sockmstr_register_read_listener_prio(smaster, cb_func, NULL,
+                    ipv4_data_input_fd, SOCK_PRIO_LOW);
+        }
+
+        if (default_rloc_afi != AF_INET) {
+            ipv6_data_input_fd = tun_open_data_input_socket(AF_INET6, data_port,
+                    data->offload);
+            sockmstr_register_read_listener_prio(smaster, cb_func, NULL,
+                    ipv6_data_input_fd, SOCK_PRIO_LOW);
+        }
+        /* A new socket bound to the data port would receive part of the
+         * flows of the port, so the input sockets are used to send */
+        if (data->offload){
+            tun_main_io.gso_sock_v4 = ipv4_data_input_fd;
+            tun_main_io.gso_sock_v6 = ipv6_data_input_fd;
+        }
     }
-    dplane_tun.datap_data = (void *)tun_dplane_data_new_init(encap_type);
 
     /* Select the default rlocs for output data packets and output control
      * packets */
     tun_set_default_output_ifaces();
 
+    if (tun_workers_init(data, dev_type, data_port) != GOOD){
+        return (BAD);
+    }
+
+    data->aging_timer = oor_timer_create(TTABLE_AGING_TIMER);
+    oor_timer_init(data->aging_timer, data, tun_ttable_aging_cb, data, NULL, NULL);
+    oor_timer_start(data->aging_timer, TUN_TTABLE_AGING_INTERVAL);
+
+    return (GOOD);
+}
+
+/* Remove the idle flows of the flow table and log its statistics */
+static int
+tun_ttable_aging_cb(oor_timer_t *timer)
+{
+    tun_dplane_data_t *data = (tun_dplane_data_t *)oor_timer_cb_argument(timer);
+    ttable_stats_t stats;
+    ttable_t *tt;
+    time_t now = time(NULL);
+    uint32_t size = 0;
+    int i;
+
+    memset(&stats, 0, sizeof(ttable_stats_t));
+    for (i = 0; i < data->nttables; i++){
+        tt = &(data->ttables[i].ttable);
+        ttable_expire(tt, now);
+        size += ttable_size(tt);
+        stats.hits += tt->stats.hits;
+        stats.misses += tt->stats.misses;
+        stats.insertions += tt->stats.insertions;
+        stats.evictions += tt->stats.evictions;
+        stats.expirations += tt->stats.expirations;
+    }
+    if (rcu_poll() > 0){
+        mem_pools_trim();
+    }
+    OOR_LOG(LDBG_2, "Flow table: %u flows, %"PRIu64" hits, %"PRIu64" misses, "
+            "%"PRIu64" insertions, %"PRIu64" evictions, %"PRIu64" expirations",
+            size, stats.hits, stats.misses, stats.insertions, stats.evictions,
+            stats.expirations);
+    mem_pools_dump(LDBG_2);
+
+    oor_timer_start(timer, TUN_TTABLE_AGING_INTERVAL);
     return (GOOD);
 }
 
@@ -157,8 +308,22 @@ tun_uninit_data_plane()
     tun_dplane_data_t *data = (tun_dplane_data_t *)dplane_tun.datap_data;
     glist_entry_t *iface_it;
     iface_t *iface;
+    int i;
 
     if (data){
+        if (data->aging_timer){
+            oor_timer_stop(data->aging_timer);
+            data->aging_timer = NULL;
+        }
+        tun_workers_uninit(data);
+        /* Without workers, the pending entries can be released */
+        rcu_poll();
+        /* The single queue tun is closed with the rest of sockets of smaster */
+        for (i = 0; i < data->ntun_fds; i++){
+            close(data->tun_fds[i]);
+        }
+        free(tun_main_io.offload_buf);
+        tun_main_io.offload_buf = NULL;
         /* Remove routes associated to each interface */
         glist_for_each_entry(iface_it, interface_list){
             iface = (iface_t *)glist_entry_data(iface_it);
@@ -867,121 +1032,166 @@ tun_iface_remove_routing_rules(iface_t *iface)
     }
 }
 
+/* Remove the fwd entries of the list of the EID in the index */
+static int
+tun_rm_eid_flows(tun_eid_index_t *idx, pkt_eid_key_t *key)
+{
+    tun_eid_flows_t *flows;
+    int removed = 0;
+
+    /* The list is released with its last flow */
+    while ((flows = tun_eid_index_lookup(idx, key)) != NULL){
+        tun_rm_dp_entry(tun_eid_flows_first(flows));
+        removed++;
+    }
+    return (removed);
+}
+
 int
 tun_rm_fwd_from_entry(lisp_addr_t *eid_prefix, uint8_t is_local)
 {
-    char * eid_prefix_char = lisp_addr_to_char(eid_prefix);
-    glist_t *fwd_tpl_list, *pxtr_fwd_tpl_list;
-    glist_entry_t *tpl_it;
-    fwd_info_t *fi;
     tun_dplane_data_t *data = (tun_dplane_data_t *)dplane_tun.datap_data;
-    packet_tuple_t *tpl;
+    pkt_eid_key_t key;
+    int removed;
 
+    if (pkt_eid_key_init(&key, eid_prefix) != GOOD){
+        OOR_LOG(LDBG_1, "tun_rm_fwd_from_entry: The EID %s is not IP",
+                lisp_addr_to_char(eid_prefix));
+        return (BAD);
+    }
 
     if (is_local){
-        return (tun_reset_all_fwd());
+        /* Only the flows with a source EID of the local mapping use its
+         * locators. They are obtained again from the control with the new
+         * locators when the next packet of the flow is processed */
+        removed = tun_rm_eid_flows(&data->src_eid_index, &key);
+        OOR_LOG(LDBG_3, "tun_rm_fwd_from_entry: Removed %d forwarding entries with source EID %s",
+                removed, lisp_addr_to_char(eid_prefix));
+        return (GOOD);
     }
 
-    if (strcmp(eid_prefix_char,FULL_IPv4_ADDRESS_SPACE) == 0){ // Update of the PeTR list for IPv4 EIDs or RTR list
-        OOR_LOG(LDBG_3, "tun_rm_fwd_from_entry: Removing all the forwarding entries association with the PeTRs for IPv4 EIDs");
-        pxtr_fwd_tpl_list = (glist_t *)shash_lookup(data->eid_to_dp_entries,FULL_IPv4_ADDRESS_SPACE);
-        /* Remove all the entries associated with the PxTR */
-
-        while (glist_size(pxtr_fwd_tpl_list) > 0){
-            tpl = (packet_tuple_t *)glist_first_data(pxtr_fwd_tpl_list);
-            fi = ttable_lookup(&(data->ttable), tpl);
-            // When we recurively call this function using the associated_entry we will execute "else" statement where we also
-            // update the list of entries associated with PxTR.
-            tun_rm_fwd_from_entry(fi->associated_entry,is_local);
-        }
-    }else if(strcmp(eid_prefix_char,FULL_IPv6_ADDRESS_SPACE) == 0){ // Update of the PeTR list for IPv6 EIDs or RTR list
-        OOR_LOG(LDBG_3, "tun_rm_fwd_from_entry: Removing all the forwarding entries association with the PeTRs for IPv6 EIDs");
-        pxtr_fwd_tpl_list = (glist_t *)shash_lookup(data->eid_to_dp_entries,FULL_IPv6_ADDRESS_SPACE);
-        /* Remove all the entries associated with the PxTR */
-
-        while (glist_size(pxtr_fwd_tpl_list) > 0){
-            tpl = (packet_tuple_t *)glist_first_data(pxtr_fwd_tpl_list);
-            fi = ttable_lookup(&(data->ttable), tpl);
-            // When we recurively call this function using the associated_entry we will execute "else" statement where we also
-            // update the list of entries associated with PxTR.
-            tun_rm_fwd_from_entry(fi->associated_entry,is_local);
-        }
+    if (key.iid == 0 && key.plen == 0){ // Update of the PeTR list or RTR list
+        OOR_LOG(LDBG_3, "tun_rm_fwd_from_entry: Removing all the forwarding entries association with the PeTRs for IPv%d EIDs",
+                key.ip_version);
+        tun_rm_eid_flows(&data->petrs_index, &key);
+        tun_rm_eid_flows(&data->eid_index, &key);
     }else{
-        OOR_LOG(LDBG_3, "tun_rm_fwd_from_entry: Removing all the forwarding entries association with the EID %s",eid_prefix_char);
-        fwd_tpl_list = (glist_t *)shash_lookup(data->eid_to_dp_entries,eid_prefix_char);
-        if (!fwd_tpl_list){
-            OOR_LOG(LDBG_1, "tun_rm_fwd_from_entry: Entry %s not found in the shasht!",eid_prefix_char);
+        OOR_LOG(LDBG_3, "tun_rm_fwd_from_entry: Removing all the forwarding entries association with the EID %s",
+                lisp_addr_to_char(eid_prefix));
+        if (tun_rm_eid_flows(&data->eid_index, &key) == 0){
+            OOR_LOG(LDBG_1, "tun_rm_fwd_from_entry: Entry %s not found in the index!",
+                    lisp_addr_to_char(eid_prefix));
             return (BAD);
         }
-        /* Check if it is a negative entry in order to remove also from PxTRs list */
-        tpl = (packet_tuple_t *)glist_first_data(fwd_tpl_list);
-        fi = ttable_lookup(&(data->ttable), tpl);
-        if (fi->neg_map_reply_act == ACT_NATIVE_FWD){ //negative mapping
-            switch (lisp_addr_ip_afi(fi->associated_entry)){
-            case AF_INET:
-                pxtr_fwd_tpl_list = (glist_t *)shash_lookup(data->eid_to_dp_entries,FULL_IPv4_ADDRESS_SPACE);
-                break;
-            case AF_INET6:
-                pxtr_fwd_tpl_list = (glist_t *)shash_lookup(data->eid_to_dp_entries,FULL_IPv6_ADDRESS_SPACE);
-                break;
-            default:
-                OOR_LOG(LDBG_1, "tun_rm_fwd_from_entry: Associated entry is not IP");
-                return (BAD);
-            }
-            glist_for_each_entry(tpl_it,fwd_tpl_list){
-                tpl = (packet_tuple_t *)glist_entry_data(tpl_it);
-                glist_remove_obj(tpl,pxtr_fwd_tpl_list);
-            }
-        }
-        /* Remove associated entry from eid_to_dp_entries */
-        shash_remove(data->eid_to_dp_entries, eid_prefix_char);
     }
 
     return (GOOD);
 }
 
+/* Return the last time one of the flows associated with the EID prefix was
+ * used. The time has the granularity of the aging of the flow table */
+time_t
+tun_fwd_entry_last_used(lisp_addr_t *eid_prefix)
+{
+    tun_dplane_data_t *data = (tun_dplane_data_t *)dplane_tun.datap_data;
+    tun_ttable_shard_t *shard;
+    tun_eid_flows_t *flows;
+    fwd_entry_link_t *link;
+    pkt_eid_key_t key;
+    time_t last_used = 0, t;
+
+    if (pkt_eid_key_init(&key, eid_prefix) != GOOD){
+        return (0);
+    }
+    flows = tun_eid_index_lookup(&data->eid_index, &key);
+    if (!flows){
+        return (0);
+    }
+    LIST_FOR_EACH(link, node, &flows->flows){
+        shard = tun_get_ttable_shard(data, pkt_tuple_hash(link->entry->tuple));
+        t = ttable_last_used(&shard->ttable, link->entry->tuple);
+        if (t > last_used){
+            last_used = t;
+        }
+    }
+    return (last_used);
+}
+
 /* Remove all the fwd programmed in the data plane
- * Used when a change is produced in the local mappings */
+ * Used when a change affects to all the flows, as the locators of the RTR */
 
 int
 tun_reset_all_fwd()
 {
     tun_dplane_data_t *data = (tun_dplane_data_t *)dplane_tun.datap_data;
-
-    shash_destroy(data->eid_to_dp_entries);
-    data->eid_to_dp_entries = shash_new_managed((free_value_fn_t)glist_destroy);
-    /* Insert entry for PeTRs */
-    shash_insert(data->eid_to_dp_entries, strdup(FULL_IPv4_ADDRESS_SPACE), glist_new());
-    shash_insert(data->eid_to_dp_entries, strdup(FULL_IPv6_ADDRESS_SPACE), glist_new());
+    int i;
+
+    /* The indexes are released before the flows they link */
+    tun_eid_index_uninit(&data->eid_index);
+    tun_eid_index_uninit(&data->src_eid_index);
+    tun_eid_index_uninit(&data->petrs_index);
+    tun_eid_index_init(&data->eid_index);
+    tun_eid_index_init(&data->src_eid_index);
+    tun_eid_index_init(&data->petrs_index);
+    for (i = 0; i < data->nttables; i++){
+        ttable_flush(&(data->ttables[i].ttable));
+    }
+    /* Return to the system the memory of the released flows. With workers,
+     * the flows are released by rcu_poll once the workers don't use them */
+    if (data->nworkers == 0){
+        mem_pools_trim();
+    }
     return (GOOD);
 }
 
 tun_dplane_data_t *
-tun_dplane_data_new_init(oor_encap_t encap_type)
+tun_dplane_data_new_init(oor_encap_t encap_type, int nworkers)
 {
     tun_dplane_data_t * data;
+    uint32_t shard_size;
+    int i;
     data = xmalloc(sizeof(tun_dplane_data_t));
     if (!data){
         return (NULL);
     }
     data->encap_type = encap_type;
-    data->eid_to_dp_entries = shash_new_managed((free_value_fn_t)glist_destroy);
-    /* Insert entry for PeTRs */
-    shash_insert(data->eid_to_dp_entries, strdup(FULL_IPv4_ADDRESS_SPACE), glist_new());
-    shash_insert(data->eid_to_dp_entries, strdup(FULL_IPv6_ADDRESS_SPACE), glist_new());
-
-    ttable_init(&(data->ttable));
+    data->burst_size = data_plane_conf.burst_size;
+    data->offload = data_plane_conf.offload;
+    data->aging_timer = NULL;
+    tun_eid_index_init(&data->eid_index);
+    tun_eid_index_init(&data->src_eid_index);
+    tun_eid_index_init(&data->petrs_index);
+
+    data->nworkers = nworkers;
+    data->workers = NULL;
+    data->ntun_fds = 0;
+    data->nttables = data->nworkers > 0 ? data->nworkers : 1;
+    data->ttables = xzalloc(data->nttables * sizeof(tun_ttable_shard_t));
+    /* The capacity of the flow table is split between the shards */
+    shard_size = (data_plane_conf.flow_table_size + data->nttables - 1) / data->nttables;
+    for (i = 0; i < data->nttables; i++){
+        ttable_init(&(data->ttables[i].ttable));
+        ttable_conf(&(data->ttables[i].ttable), shard_size,
+                data_plane_conf.flow_idle_timeout, tun_ttable_entry_removed);
+    }
     return (data);
 }
 
 void
 tun_dplane_data_free(tun_dplane_data_t *data)
 {
+    int i;
+
     if (!data){
         return;
     }
-    shash_destroy(data->eid_to_dp_entries);
-    ttable_uninit(&(data->ttable));
+    tun_eid_index_uninit(&data->eid_index);
+    tun_eid_index_uninit(&data->src_eid_index);
+    tun_eid_index_uninit(&data->petrs_index);
+    for (i = 0; i < data->nttables; i++){
+        ttable_uninit(&(data->ttables[i].ttable));
+    }
+    free(data->ttables);
     free(data);
 }
 
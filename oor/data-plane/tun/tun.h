@@ -21,14 +21,21 @@
 #define TUN_H_
 
 
+#include <sys/socket.h>
+#include "../data-plane.h"
 #include "../ttable.h"
 #include "../encapsulations/vxlan-gpe.h"
-#include "../../lib/shash.h"
+#include "tun_eid_index.h"
+#include "../../lib/lbuf.h"
+#include "../../lib/timers.h"
 #include "../../liblisp/liblisp.h"
 
 
 #define TUN_IFACE_NAME          "lispTun0"
 #define TUN_RECEIVE_SIZE        2048
+/* Size of the buffers used to receive packets from the tun and from the
+ * data sockets */
+#define TUN_IO_BUF_SIZE         (MAX_IP_PKT_LEN + 1)
 
 
 /*
@@ -57,6 +64,9 @@
 
 #define TUN_MTU                 1440 /* 1500 - 60 = 1440 */
 
+/* Seconds between two checks of the idle flows of the flow table */
+#define TUN_TTABLE_AGING_INTERVAL   10
+
 
 /* Tun MN variables */
 
@@ -68,20 +78,77 @@ lisp_addr_t * tun_get_default_output_address(int afi);
 int tun_get_default_output_socket(int);
 
 typedef struct iface iface_t;
+typedef struct tun_worker_ tun_worker_t;
+
+/* I/O state of a thread processing data packets: buffers to receive a burst
+ * of packets and queue of packets pending to be sent. The data of the queued
+ * packets is not copied, so the queue should be flushed before reusing the
+ * receive buffers */
+typedef struct tun_io_ {
+    uint8_t rx_buf[DATA_PLANE_MAX_BURST_SIZE][TUN_IO_BUF_SIZE];
+    lbuf_t rx_lbuf[DATA_PLANE_MAX_BURST_SIZE];
+    struct mmsghdr tx_msgs[DATA_PLANE_MAX_BURST_SIZE];
+    struct iovec tx_iov[DATA_PLANE_MAX_BURST_SIZE];
+    struct sockaddr_storage tx_dst[DATA_PLANE_MAX_BURST_SIZE];
+    int tx_sock[DATA_PLANE_MAX_BURST_SIZE];
+    int tx_pending;
+    /* With offload, buffer to receive the packets that don't fit in rx_buf */
+    uint8_t *offload_buf;
+    /* With offload, sockets bound to the data port used to send with UDP
+     * segmentation offload. They are data input sockets of a worker or of the
+     * main thread, so the source port is the one of the encapsulation. They
+     * are not owned by the I/O state */
+    int gso_sock_v4;
+    int gso_sock_v6;
+    /* Worker owning the I/O state. NULL for the main thread */
+    tun_worker_t *worker;
+} tun_io_t;
+
+/* Shard of the table of forwarding entries. Only the main thread modifies the
+ * shards. The workers look them up without locks and the removed entries are
+ * released once all the workers have passed through a quiescent state */
+typedef struct tun_ttable_shard_ {
+    ttable_t ttable;
+} tun_ttable_shard_t;
 
 typedef struct tun_dplane_data_{
     oor_encap_t encap_type;
+    /* Max number of packets read / sent per socket event */
+    int burst_size;
+    /* Packets of the tun with virtio-net header and data sockets with UDP
+     * segmentation / receive offload */
+    uint8_t offload;
     iface_t *default_out_iface_v4;
     iface_t *default_out_iface_v6;
-    /* < char *eid -> glist_t <fwd_info_t *>> Used to find the fwd entries to be removed
-     * of the data plane when there is a change with the mapping of the eid */
-    shash_t *eid_to_dp_entries; //< char *eid -> glist_t <fwd_info_t *>>
-    /* Hash table containg the forward info from a tupla */
-    ttable_t ttable;
+    /* Used to find the fwd entries to be removed of the data plane when there
+     * is a change with the mapping of the eid */
+    tun_eid_index_t eid_index;
+    /* Used to find the fwd entries whose source EID belongs to a local mapping
+     * when its locators change */
+    tun_eid_index_t src_eid_index;
+    /* Fwd entries forwarded to the PeTRs, indexed by the whole address space
+     * of their IP version */
+    tun_eid_index_t petrs_index;
+    /* Hash table containg the forward info from a tupla. It is split in one
+     * shard per worker. The shard of a tupla is selected using its hash */
+    tun_ttable_shard_t *ttables;
+    int nttables;
+    /* Periodically removes the idle flows of the shards */
+    oor_timer_t *aging_timer;
+    /* Threads processing the data packets */
+    tun_worker_t **workers;
+    int nworkers;
+    /* Queues of the tun when it has more than one. Queue i is read by worker i */
+    int tun_fds[DATA_PLANE_MAX_WORKERS];
+    int ntun_fds;
 }tun_dplane_data_t;
 
+/* I/O state of the main thread */
+extern tun_io_t tun_main_io;
+
 tun_dplane_data_t * tun_get_datap_data();
 int tun_reset_all_fwd();
+tun_ttable_shard_t *tun_get_ttable_shard(tun_dplane_data_t *data, uint32_t hash);
 
 extern data_plane_struct_t dplane_tun;
 
@@ -0,0 +1,140 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include <string.h>
+
+#include "tun_eid_index.h"
+#include "../../lib/mem_util.h"
+
+
+void
+tun_eid_index_init(tun_eid_index_t *idx)
+{
+    idx->htable = kh_init(eid_flows);
+}
+
+/* Release the lists of the EIDs. The flows are not released */
+void
+tun_eid_index_uninit(tun_eid_index_t *idx)
+{
+    tun_eid_flows_t *flows;
+    fwd_entry_link_t *link, *next;
+    khiter_t k;
+
+    for (k = kh_begin(idx->htable); k != kh_end(idx->htable); ++k){
+        if (!kh_exist(idx->htable, k)){
+            continue;
+        }
+        flows = kh_value(idx->htable, k);
+        LIST_FOR_EACH_SAFE(link, next, node, &flows->flows){
+            link->owner = NULL;
+        }
+        free(flows);
+    }
+    kh_destroy(eid_flows, idx->htable);
+    idx->htable = NULL;
+}
+
+tun_eid_flows_t *
+tun_eid_index_lookup(tun_eid_index_t *idx, pkt_eid_key_t *key)
+{
+    khiter_t k;
+
+    k = kh_get(eid_flows, idx->htable, *key);
+    if (k == kh_end(idx->htable)){
+        return (NULL);
+    }
+    return (kh_value(idx->htable, k));
+}
+
+/* Add the flow of the link to the list of the EID, creating it if needed */
+int
+tun_eid_index_link(tun_eid_index_t *idx, pkt_eid_key_t *key,
+        fwd_entry_link_t *link)
+{
+    tun_eid_flows_t *flows;
+    khiter_t k;
+    int ret;
+
+    if (link->owner){
+        tun_eid_index_unlink(idx, link);
+    }
+    k = kh_put(eid_flows, idx->htable, *key, &ret);
+    if (ret < 0){
+        return (BAD);
+    }
+    if (ret == 0){
+        flows = kh_value(idx->htable, k);
+    }else{
+        flows = xmalloc(sizeof(tun_eid_flows_t));
+        if (!flows){
+            kh_del(eid_flows, idx->htable, k);
+            return (BAD);
+        }
+        flows->key = *key;
+        list_init(&flows->flows);
+        flows->nflows = 0;
+        kh_value(idx->htable, k) = flows;
+    }
+    list_push_back(&flows->flows, &link->node);
+    link->owner = flows;
+    flows->nflows++;
+
+    return (GOOD);
+}
+
+/* Remove the flow of the link from the list of its EID. The list is released
+ * with its last flow */
+void
+tun_eid_index_unlink(tun_eid_index_t *idx, fwd_entry_link_t *link)
+{
+    tun_eid_flows_t *flows = (tun_eid_flows_t *)link->owner;
+    khiter_t k;
+
+    if (!flows){
+        return;
+    }
+    list_remove(&link->node);
+    link->owner = NULL;
+    if (--flows->nflows > 0){
+        return;
+    }
+    k = kh_get(eid_flows, idx->htable, flows->key);
+    if (k != kh_end(idx->htable)){
+        kh_del(eid_flows, idx->htable, k);
+    }
+    free(flows);
+}
+
+/* Key of the whole address space of the IP version. Used for the flows
+ * forwarded to the PeTRs */
+void
+tun_eid_key_full_space(pkt_eid_key_t *key, uint8_t ip_version)
+{
+    memset(key, 0, sizeof(pkt_eid_key_t));
+    key->ip_version = ip_version;
+}
+
+/*
+ * Editor modelines
+ *
+ * vi: set shiftwidth=4 tabstop=4 expandtab:
+ * :indentSize=4:tabSize=4:noTabs=true:
+ */
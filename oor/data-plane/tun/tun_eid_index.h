@@ -0,0 +1,59 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#ifndef TUN_EID_INDEX_H_
+#define TUN_EID_INDEX_H_
+
+#include "../../elibs/khash/khash.h"
+#include "../../elibs/ovs/list.h"
+#include "../../lib/packets.h"
+#include "../../fwd_policies/flow_balancing/fwd_entry_tuple.h"
+
+/* Flows associated with an EID prefix */
+typedef struct tun_eid_flows_ {
+    pkt_eid_key_t key;
+    struct ovs_list flows; //<fwd_entry_link_t>
+    uint32_t nflows;
+} tun_eid_flows_t;
+
+KHASH_INIT(eid_flows, pkt_eid_key_t, tun_eid_flows_t *, 1, pkt_eid_key_hash_val, pkt_eid_key_equal)
+
+/* Index of the flows of the data plane by EID prefix. The flows are linked
+ * with the links of their forwarding entries, so linking and unlinking a flow
+ * only allocates memory for the first flow of an EID */
+typedef struct tun_eid_index_ {
+    khash_t(eid_flows) *htable; //<pkt_eid_key_t, tun_eid_flows_t *>
+} tun_eid_index_t;
+
+void tun_eid_index_init(tun_eid_index_t *idx);
+void tun_eid_index_uninit(tun_eid_index_t *idx);
+tun_eid_flows_t *tun_eid_index_lookup(tun_eid_index_t *idx, pkt_eid_key_t *key);
+int tun_eid_index_link(tun_eid_index_t *idx, pkt_eid_key_t *key,
+        fwd_entry_link_t *link);
+void tun_eid_index_unlink(tun_eid_index_t *idx, fwd_entry_link_t *link);
+void tun_eid_key_full_space(pkt_eid_key_t *key, uint8_t ip_version);
+
+static inline fwd_entry_tuple_t *
+tun_eid_flows_first(tun_eid_flows_t *flows)
+{
+    return (CONTAINER_OF(list_front(&flows->flows), fwd_entry_link_t, node)->entry);
+}
+
+#endif /* TUN_EID_INDEX_H_ */
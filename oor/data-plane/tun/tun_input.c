@@ -22,50 +22,131 @@
 
 #include "tun.h"
 #include "tun_input.h"
+#include "tun_offload.h"
 #include "tun_output.h"
 #include "../../lib/packets.h"
 #include "../../lib/mem_util.h"
 #include "../../liblisp/liblisp.h"
 #include "../../lib/oor_log.h"
 
-/* static buffer to receive packets */
-static uint8_t pkt_recv_buf[MAX_IP_PKT_LEN+1];
-static lbuf_t pkt_buf;
+static int tun_read_burst(tun_io_t *io, int sock, uint32_t headroom,
+        sock_data_inf_t *inf);
+static int tun_decap_pkt(lbuf_t *b, sock_data_inf_t *inf, uint8_t is_raw,
+        uint32_t *iid);
+static int tun_input_pkt(tun_io_t *io, lbuf_t *b, sock_data_inf_t *inf,
+        uint8_t is_raw);
+static int tun_rtr_input_pkt(tun_io_t *io, lbuf_t *b, sock_data_inf_t *inf,
+        uint8_t is_raw);
+static int tun_process_gro_burst(tun_io_t *io, int sock, uint32_t headroom,
+        int (*input_pkt)(tun_io_t *, lbuf_t *, sock_data_inf_t *, uint8_t));
 
-int
-tun_read_and_decap_pkt(int sock, lbuf_t *b, uint32_t *iid)
+/* Read from the socket up to burst size packets. Each packet is stored in
+ * its own buffer of the I/O state, so they are valid until next burst. */
+static int
+tun_read_burst(tun_io_t *io, int sock, uint32_t headroom, sock_data_inf_t *inf)
+{
+    tun_dplane_data_t *data = tun_get_datap_data();
+    int i;
+
+    for (i = 0; i < data->burst_size; i++){
+        lbuf_use_stack(&io->rx_lbuf[i], &io->rx_buf[i], MAX_IP_PKT_LEN);
+        lbuf_reserve(&io->rx_lbuf[i], headroom);
+    }
+
+    return (sock_data_recv_mmsg(sock, io->rx_lbuf, inf, data->burst_size));
+}
+
+/* Read up to burst size datagrams from a datagram socket with UDP_GRO. Each
+ * read can return several packets of a same flow coalesced, so they are split
+ * and processed one by one. Without headroom, the packets are processed in the
+ * offload buffer where they are read. Otherwise they are copied to the buffers
+ * of the burst. */
+static int
+tun_process_gro_burst(tun_io_t *io, int sock, uint32_t headroom,
+        int (*input_pkt)(tun_io_t *, lbuf_t *, sock_data_inf_t *, uint8_t))
+{
+    tun_dplane_data_t *data = tun_get_datap_data();
+    sock_data_inf_t inf;
+    lbuf_t gro, *b;
+    uint8_t *pos;
+    int i, slot = 0, seg_size, len, left;
+
+    for (i = 0; i < data->burst_size; i++){
+        lbuf_use_stack(&gro, io->offload_buf, TUN_OFFLOAD_BUF_SIZE);
+        if (sock_data_recv_gro(sock, &gro, &inf, &seg_size) != GOOD){
+            break;
+        }
+        pos = lbuf_data(&gro);
+        left = lbuf_size(&gro);
+        if (seg_size == 0){
+            seg_size = left;
+        }
+        for (; left > 0; pos += len, left -= len){
+            len = left < seg_size ? left : seg_size;
+            if (headroom == 0){
+                lbuf_use_stack(&gro, pos, len);
+                lbuf_set_size(&gro, len);
+                input_pkt(io, &gro, &inf, FALSE);
+                continue;
+            }
+            if (slot == DATA_PLANE_MAX_BURST_SIZE){
+                tun_output_flush(io);
+                slot = 0;
+            }
+            b = &io->rx_lbuf[slot];
+            lbuf_use_stack(b, &io->rx_buf[slot], MAX_IP_PKT_LEN);
+            lbuf_reserve(b, headroom);
+            if (len > lbuf_tailroom(b)){
+                continue;
+            }
+            slot++;
+            lbuf_put(b, pos, len);
+            input_pkt(io, b, &inf, FALSE);
+        }
+    }
+
+    return (i == 0 ? BAD : GOOD);
+}
+
+static int
+tun_decap_pkt(lbuf_t *b, sock_data_inf_t *inf, uint8_t is_raw, uint32_t *iid)
 {
-    uint8_t ttl = 0, tos = 0;
-    int afi;
+    tun_dplane_data_t *data = tun_get_datap_data();
     struct udphdr *udph;
     lisp_data_hdr_t *lisph;
     vxlan_gpe_hdr_t *vxlanh;
     int port;
 
-    if (sock_data_recv(sock, b, &afi, &ttl, &tos) != GOOD) {
-        return(BAD);
-    }
+    if (is_raw){
+        if (inf->afi == AF_INET){
+            /* With input RAW UDP sockets in IPv4, we get the whole external
+             * IPv4 packet */
+            lbuf_reset_ip(b);
+            pkt_pull_ip(b);
+            lbuf_reset_udp(b);
+        }else{
+            /* With input RAW UDP sockets in IPv6, we get the whole external
+             * UDP packet */
+            lbuf_reset_udp(b);
+        }
 
-    if (afi == AF_INET){
-        /* With input RAW UDP sockets in IPv4, we get the whole external
-         * IPv4 packet */
-        lbuf_reset_ip(b);
-        pkt_pull_ip(b);
-        lbuf_reset_udp(b);
+        udph = pkt_pull_udp(b);
+        if (ntohs(udplen(udph)) < 16){//8 udp header + 8 lisp header
+            return (ERR_NOT_ENCAP);
+        }
+        port = ntohs(udpdport(udph));
     }else{
-        /* With input RAW UDP sockets in IPv6, we get the whole external
-         * UDP packet */
-        lbuf_reset_udp(b);
-    }
-
-    udph = pkt_pull_udp(b);
-    if (ntohs(udplen(udph)) < 16){//8 udp header + 8 lisp header
-        return (ERR_NOT_ENCAP);
+        /* With datagram sockets we get the UDP payload. The socket is bound
+         * to the port of the encapsulation in use */
+        port = data->encap_type == ENCP_VXLAN_GPE ? VXLAN_GPE_DATA_PORT : LISP_DATA_PORT;
+        if (lbuf_size(b) < 8){
+            return (ERR_NOT_ENCAP);
+        }
     }
 
     /* FILTER UDP: with input RAW UDP sockets, we receive all UDP packets,
      * we only want LISP data ones */
-    switch (ntohs(udpdport(udph))){
+    switch (port){
     case LISP_DATA_PORT:
         lisph = lisp_data_pull_hdr(b);
         if (LDHDR_LSB_BIT(lisph)){
@@ -73,16 +154,15 @@ tun_read_and_decap_pkt(int sock, lbuf_t *b, uint32_t *iid)
         }else{
             *iid = 0;
         }
-
-        port = LISP_DATA_PORT;
         break;
     case VXLAN_GPE_DATA_PORT:
 
         vxlanh = vxlan_gpe_data_pull_hdr(b);
         if (VXLAN_HDR_VNI_BIT(vxlanh)){
             *iid = vxlan_gpe_hdr_get_vni(vxlanh);
+        }else{
+            *iid = 0;
         }
-        port = VXLAN_GPE_DATA_PORT;
         break;
     default:
         return (ERR_NOT_ENCAP);
@@ -93,7 +173,7 @@ tun_read_and_decap_pkt(int sock, lbuf_t *b, uint32_t *iid)
 
     /* UPDATE IP TOS and TTL. Checksum is also updated for IPv4
      * NOTE: we always assume an IP payload*/
-    ip_hdr_set_ttl_and_tos(lbuf_data(b), ttl, tos);
+    ip_hdr_set_ttl_and_tos(lbuf_data(b), inf->ttl, inf->tos);
 
     OOR_LOG(LDBG_3, "INPUT (%d): %s",port, ip_src_and_dst_to_char(lbuf_l3(b),
             "Inner IP: %s -> %s"));
@@ -101,47 +181,122 @@ tun_read_and_decap_pkt(int sock, lbuf_t *b, uint32_t *iid)
     return(GOOD);
 }
 
-int
-tun_process_input_packet(sock_t *sl)
+/* Decapsulate a received packet and write it to the tun */
+static int
+tun_input_pkt(tun_io_t *io, lbuf_t *b, sock_data_inf_t *inf, uint8_t is_raw)
 {
+    tun_dplane_data_t *data = tun_get_datap_data();
     uint32_t iid;
-    lbuf_use_stack(&pkt_buf, &pkt_recv_buf, MAX_IP_PKT_LEN);
 
-    if (tun_read_and_decap_pkt(sl->fd, &pkt_buf, &iid) != GOOD) {
+    if (tun_decap_pkt(b, inf, is_raw, &iid) != GOOD) {
         return (BAD);
     }
 
     /* XXX Destination packet should be checked it belongs to this xTR */
-    if ((write(tun_receive_fd, lbuf_l3(&pkt_buf), lbuf_size(&pkt_buf))) < 0) {
+    if (data->offload){
+        return (tun_offload_write(tun_receive_fd, b));
+    }
+    if ((write(tun_receive_fd, lbuf_l3(b), lbuf_size(b))) < 0) {
         OOR_LOG(LDBG_2, "lisp_input: write error: %s\n ", strerror(errno));
+        return (BAD);
     }
-
     return (GOOD);
 }
 
-int
-tun_rtr_process_input_packet(struct sock *sl)
+/* Decapsulate a received packet and encapsulate it again to its next hop */
+static int
+tun_rtr_input_pkt(tun_io_t *io, lbuf_t *b, sock_data_inf_t *inf, uint8_t is_raw)
 {
     packet_tuple_t tpl;
-    lbuf_use_stack(&pkt_buf, &pkt_recv_buf, MAX_IP_PKT_LEN);
-    /* Reserve space in case the received packet was IPv6. In this case the IPv6 header is
-     * not provided */
-    lbuf_reserve(&pkt_buf,LBUF_STACK_OFFSET);
 
-    if (tun_read_and_decap_pkt(sl->fd, &pkt_buf, &(tpl.iid)) != GOOD) {
+    if (tun_decap_pkt(b, inf, is_raw, &(tpl.iid)) != GOOD) {
         return (BAD);
     }
 
     OOR_LOG(LDBG_3, "Forwarding packet to OUPUT for re-encapsulation");
 
-    lbuf_point_to_l3(&pkt_buf);
-    lbuf_reset_ip(&pkt_buf);
+    lbuf_point_to_l3(b);
+    lbuf_reset_ip(b);
 
-    if (pkt_parse_5_tuple(&pkt_buf, &tpl) != GOOD) {
+    if (pkt_parse_5_tuple(b, &tpl) != GOOD) {
         return (BAD);
     }
-    tun_output(&pkt_buf, &tpl);
+    return (tun_output(io, b, &tpl));
+}
 
-    return(GOOD);
+int
+tun_process_input_burst(tun_io_t *io, int sock, uint8_t is_raw)
+{
+    tun_dplane_data_t *data = tun_get_datap_data();
+    sock_data_inf_t inf[DATA_PLANE_MAX_BURST_SIZE];
+    int i, npkts;
+
+    if (!is_raw && data->offload){
+        return (tun_process_gro_burst(io, sock, 0, tun_input_pkt));
+    }
+
+    npkts = tun_read_burst(io, sock, 0, inf);
+    if (npkts == 0) {
+        return (BAD);
+    }
+
+    for (i = 0; i < npkts; i++){
+        tun_input_pkt(io, &io->rx_lbuf[i], &inf[i], is_raw);
+    }
+
+    return (GOOD);
+}
+
+int
+tun_rtr_process_input_burst(tun_io_t *io, int sock, uint8_t is_raw)
+{
+    tun_dplane_data_t *data = tun_get_datap_data();
+    sock_data_inf_t inf[DATA_PLANE_MAX_BURST_SIZE];
+    int i, npkts, ret = GOOD;
+
+    /* Reserve space in case the received packet was IPv6. In this case the IPv6 header is
+     * not provided */
+    if (!is_raw && data->offload){
+        ret = tun_process_gro_burst(io, sock, LBUF_STACK_OFFSET, tun_rtr_input_pkt);
+    }else{
+        npkts = tun_read_burst(io, sock, LBUF_STACK_OFFSET, inf);
+        if (npkts == 0) {
+            return (BAD);
+        }
+        for (i = 0; i < npkts; i++){
+            tun_rtr_input_pkt(io, &io->rx_lbuf[i], &inf[i], is_raw);
+        }
+    }
+    /* Send the re-encapsulated packets of the burst */
+    tun_output_flush(io);
+
+    return (ret);
+}
+
+int
+tun_process_input_packet(sock_t *sl)
+{
+    return (tun_process_input_burst(&tun_main_io, sl->fd, TRUE));
+}
+
+int
+tun_rtr_process_input_packet(struct sock *sl)
+{
+    return (tun_rtr_process_input_burst(&tun_main_io, sl->fd, TRUE));
+}
+
+/* Used instead of the previous ones when the main thread receives the data
+ * packets with datagram sockets (offload) */
+int
+tun_process_input_datagram(sock_t *sl)
+{
+    return (tun_process_input_burst(&tun_main_io, sl->fd, FALSE));
 }
 
+int
+tun_rtr_process_input_datagram(struct sock *sl)
+{
+    return (tun_rtr_process_input_burst(&tun_main_io, sl->fd, FALSE));
+}
+
+
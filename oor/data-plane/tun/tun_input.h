@@ -26,6 +26,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <linux/if_tun.h>
+#include "tun.h"
 #include "tun_output.h"
 #include "../../defs.h"
 #include "../../lib/sockets.h"
@@ -33,5 +34,9 @@
 
 int tun_process_input_packet(struct sock *sl);
 int tun_rtr_process_input_packet(struct sock *sl);
+int tun_process_input_datagram(struct sock *sl);
+int tun_rtr_process_input_datagram(struct sock *sl);
+int tun_process_input_burst(tun_io_t *io, int sock, uint8_t is_raw);
+int tun_rtr_process_input_burst(tun_io_t *io, int sock, uint8_t is_raw);
 
 #endif /*TUN_IFACE_LIST_H_*/
@@ -0,0 +1,405 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/ip.h>
+#include <netinet/ip6.h>
+#include <netinet/tcp.h>
+#include <netinet/udp.h>
+#include <sys/uio.h>
+
+#include "tun_offload.h"
+#include "../../lib/cksum.h"
+#include "../../lib/oor_log.h"
+#include "../../lib/sockets-util.h"
+
+/* TCP flags of a TCP header */
+#define TCP_HDR_FLAGS(tcph)     (((uint8_t *)(tcph))[13])
+#define TCP_HDR_FLAG_CWR        0x80
+
+/* Headers of a TCP packet read from the tun to be segmented */
+typedef struct tun_offload_tso_ {
+    uint8_t *data;
+    int afi;
+    uint32_t ip_len;
+    /* IP and TCP headers */
+    uint32_t hdr_len;
+    uint32_t payload_len;
+    uint16_t seg_size;
+} tun_offload_tso_t;
+
+static int tun_offload_parse_tso(lbuf_t *pkt, struct virtio_net_hdr *vh,
+        tun_offload_tso_t *tso);
+static void tun_offload_seg_hdrs(tun_offload_tso_t *tso, uint32_t offset,
+        uint32_t len, uint8_t *hdrs);
+static void tun_offload_tmpl_to_sockaddr(pkt_encap_tmpl_t *tmpl,
+        struct sockaddr_storage *src, struct sockaddr_storage *dst, int *ttl);
+
+
+/* Read a packet from a tun with virtio-net header. The packet is stored in
+ * 'b' if it fits. TCP packets to be segmented are stored in 'offload_buf'
+ * and 'b' is moved to it, as the segments are stored in the buffers of the
+ * burst. Returns BAD if there is no packet to be read */
+int
+tun_offload_read(int fd, lbuf_t *b, uint8_t *offload_buf,
+        struct virtio_net_hdr *vh)
+{
+    struct iovec iov[3];
+    uint32_t room = lbuf_tailroom(b);
+    uint8_t *pkt = offload_buf + LBUF_STACK_OFFSET;
+    int nread;
+
+    iov[0].iov_base = vh;
+    iov[0].iov_len = sizeof(struct virtio_net_hdr);
+    iov[1].iov_base = lbuf_data(b);
+    iov[1].iov_len = room;
+    /* The part that doesn't fit in 'b' is read after the place it would
+     * occupy in the offload buffer */
+    iov[2].iov_base = pkt + room;
+    iov[2].iov_len = TUN_OFFLOAD_BUF_SIZE - LBUF_STACK_OFFSET - room;
+
+    nread = readv(fd, iov, 3);
+    if (nread <= (int)sizeof(struct virtio_net_hdr)) {
+        if (nread >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            OOR_LOG(LWRN, "tun_offload_read: read error: %s", strerror(errno));
+        }
+        return (BAD);
+    }
+    nread -= sizeof(struct virtio_net_hdr);
+
+    if (vh->gso_type == VIRTIO_NET_HDR_GSO_NONE) {
+        if (nread > room) {
+            OOR_LOG(LWRN, "tun_offload_read: Packet of %d bytes bigger than the MTU",
+                    nread);
+            return (BAD);
+        }
+        lbuf_set_size(b, lbuf_size(b) + nread);
+        return (GOOD);
+    }
+
+    memcpy(pkt, lbuf_data(b), nread < room ? nread : room);
+    lbuf_use_stack(b, offload_buf, TUN_OFFLOAD_BUF_SIZE);
+    lbuf_reserve(b, LBUF_STACK_OFFSET);
+    lbuf_set_size(b, nread);
+
+    return (GOOD);
+}
+
+/* Write a packet to a tun with virtio-net header. Packets are written one by
+ * one, so no offload is requested */
+int
+tun_offload_write(int fd, lbuf_t *b)
+{
+    struct virtio_net_hdr vh;
+    struct iovec iov[2];
+
+    memset(&vh, 0, sizeof(struct virtio_net_hdr));
+    iov[0].iov_base = &vh;
+    iov[0].iov_len = sizeof(struct virtio_net_hdr);
+    iov[1].iov_base = lbuf_data(b);
+    iov[1].iov_len = lbuf_size(b);
+
+    if (writev(fd, iov, 2) < 0) {
+        OOR_LOG(LDBG_2, "tun_offload_write: write error: %s", strerror(errno));
+        return (BAD);
+    }
+    return (GOOD);
+}
+
+/* The kernel doesn't calculate the checksum of the transport header of the
+ * packets read from the tun with the virtio-net header flag NEEDS_CSUM. The
+ * checksum field has the sum of the pseudo header and the checksum of the
+ * rest of the packet should be added */
+int
+tun_offload_csum(lbuf_t *b, struct virtio_net_hdr *vh)
+{
+    uint8_t *data = lbuf_data(b);
+    uint16_t csum;
+
+    if (!(vh->flags & VIRTIO_NET_HDR_F_NEEDS_CSUM)) {
+        return (GOOD);
+    }
+    if (vh->csum_start + vh->csum_offset + sizeof(uint16_t) > lbuf_size(b)) {
+        OOR_LOG(LDBG_2, "tun_offload_csum: Wrong checksum offset");
+        return (BAD);
+    }
+    csum = cksum_fold(cksum_partial(data + vh->csum_start,
+            lbuf_size(b) - vh->csum_start, 0));
+    /* A zero checksum means no checksum in UDP. 0xffff is equivalent */
+    if (csum == 0) {
+        csum = 0xffff;
+    }
+    memcpy(data + vh->csum_start + vh->csum_offset, &csum, sizeof(uint16_t));
+
+    return (GOOD);
+}
+
+/* Check the headers of the TCP packet 'pkt' read from the tun to be segmented
+ * and fill 'tso' with their lengths */
+static int
+tun_offload_parse_tso(lbuf_t *pkt, struct virtio_net_hdr *vh,
+        tun_offload_tso_t *tso)
+{
+    uint8_t *data = lbuf_data(pkt);
+    uint32_t size = lbuf_size(pkt);
+    struct iphdr *iph;
+    struct ip6_hdr *ip6h;
+    struct tcphdr *tcph;
+
+    switch (vh->gso_type & ~VIRTIO_NET_HDR_GSO_ECN) {
+    case VIRTIO_NET_HDR_GSO_TCPV4:
+        iph = (struct iphdr *)data;
+        if (size < sizeof(struct iphdr) || iph->version != 4
+                || iph->protocol != IPPROTO_TCP) {
+            return (BAD);
+        }
+        tso->ip_len = iph->ihl * 4;
+        tso->afi = AF_INET;
+        break;
+    case VIRTIO_NET_HDR_GSO_TCPV6:
+        ip6h = (struct ip6_hdr *)data;
+        /* XXX: assuming no extra headers */
+        if (size < sizeof(struct ip6_hdr) || (ip6h->ip6_vfc >> 4) != 6
+                || ip6h->ip6_nxt != IPPROTO_TCP) {
+            return (BAD);
+        }
+        tso->ip_len = sizeof(struct ip6_hdr);
+        tso->afi = AF_INET6;
+        break;
+    default:
+        OOR_LOG(LDBG_2, "tun_offload_parse_tso: Offload type %d not supported",
+                vh->gso_type);
+        return (BAD);
+    }
+    if (size < tso->ip_len + sizeof(struct tcphdr) || vh->gso_size == 0) {
+        return (BAD);
+    }
+    tcph = (struct tcphdr *)(data + tso->ip_len);
+    tso->hdr_len = tso->ip_len + tcph->doff * 4;
+    if (size < tso->hdr_len || tso->hdr_len > TUN_OFFLOAD_MAX_HDRS_LEN) {
+        return (BAD);
+    }
+    tso->data = data;
+    tso->payload_len = size - tso->hdr_len;
+    tso->seg_size = vh->gso_size;
+
+    return (GOOD);
+}
+
+/* Build in 'hdrs' the IP and TCP headers of the segment of 'len' bytes of
+ * payload that starts at 'offset'. They are the headers of the packet with
+ * the length, sequence number, flags and checksums updated. The payload is
+ * not copied, the checksum is calculated where it is in the packet */
+static void
+tun_offload_seg_hdrs(tun_offload_tso_t *tso, uint32_t offset, uint32_t len,
+        uint8_t *hdrs)
+{
+    struct iphdr *iph;
+    struct ip6_hdr *ip6h;
+    struct tcphdr *tcph;
+    uint32_t tcp_len = tso->hdr_len - tso->ip_len;
+    uint32_t sum;
+
+    memcpy(hdrs, tso->data, tso->hdr_len);
+    tcph = (struct tcphdr *)(hdrs + tso->ip_len);
+    tcph->seq = htonl(ntohl(tcph->seq) + offset);
+    if (offset != 0) {
+        TCP_HDR_FLAGS(tcph) &= ~TCP_HDR_FLAG_CWR;
+    }
+    if (offset + len < tso->payload_len) {
+        TCP_HDR_FLAGS(tcph) &= ~(TH_FIN | TH_PUSH);
+    }
+    tcph->check = 0;
+
+    if (tso->afi == AF_INET) {
+        iph = (struct iphdr *)hdrs;
+        iph->tot_len = htons(tso->hdr_len + len);
+        iph->id = htons(ntohs(iph->id) + offset / tso->seg_size);
+        iph->check = 0;
+        iph->check = ip_checksum((uint16_t *)iph, tso->ip_len);
+        sum = cksum_partial(&iph->saddr, 2 * sizeof(struct in_addr), 0);
+    } else {
+        ip6h = (struct ip6_hdr *)hdrs;
+        ip6h->ip6_plen = htons(tcp_len + len);
+        sum = cksum_partial(&ip6h->ip6_src, 2 * sizeof(struct in6_addr), 0);
+    }
+    sum += htons(IPPROTO_TCP);
+    sum += htons(tcp_len + len);
+    /* The TCP header has an even length, so the payload is added apart */
+    sum = cksum_partial(tcph, tcp_len, sum);
+    sum = cksum_partial(tso->data + tso->hdr_len + offset, len, sum);
+    tcph->check = cksum_fold(sum);
+}
+
+/* Build in 'seg' the next segment of the TCP packet 'pkt' read from the tun.
+ * 'offset' is the position in the TCP payload of the segment to be built and
+ * it is updated to the next one. Returns BAD when there are no more segments
+ * to be built */
+int
+tun_offload_segment(lbuf_t *pkt, struct virtio_net_hdr *vh, uint32_t *offset,
+        lbuf_t *seg)
+{
+    tun_offload_tso_t tso;
+    uint32_t len;
+
+    if (tun_offload_parse_tso(pkt, vh, &tso) != GOOD
+            || *offset >= tso.payload_len) {
+        return (BAD);
+    }
+    len = tso.payload_len - *offset;
+    if (len > tso.seg_size) {
+        len = tso.seg_size;
+    }
+    if (tso.hdr_len + len > lbuf_tailroom(seg)) {
+        OOR_LOG(LDBG_2, "tun_offload_segment: Segment of %d bytes too big",
+                tso.hdr_len + len);
+        return (BAD);
+    }
+
+    tun_offload_seg_hdrs(&tso, *offset, len, lbuf_put_uninit(seg, tso.hdr_len));
+    lbuf_put(seg, tso.data + tso.hdr_len + *offset, len);
+
+    *offset += len;
+    return (GOOD);
+}
+
+/* Get the addresses and ports of the outer headers of an encapsulation
+ * template */
+static void
+tun_offload_tmpl_to_sockaddr(pkt_encap_tmpl_t *tmpl,
+        struct sockaddr_storage *src, struct sockaddr_storage *dst, int *ttl)
+{
+    struct iphdr *iph = (struct iphdr *)tmpl->hdr;
+    struct ip6_hdr *ip6h = (struct ip6_hdr *)tmpl->hdr;
+    struct udphdr *udph = (struct udphdr *)(tmpl->hdr + tmpl->ip_len);
+    struct sockaddr_in *sa4;
+    struct sockaddr_in6 *sa6;
+
+    memset(src, 0, sizeof(struct sockaddr_storage));
+    memset(dst, 0, sizeof(struct sockaddr_storage));
+    if (tmpl->afi == AF_INET) {
+        sa4 = (struct sockaddr_in *)src;
+        sa4->sin_family = AF_INET;
+        memcpy(&sa4->sin_addr, &iph->saddr, sizeof(struct in_addr));
+        sa4 = (struct sockaddr_in *)dst;
+        sa4->sin_family = AF_INET;
+        sa4->sin_port = udpdport(udph);
+        memcpy(&sa4->sin_addr, &iph->daddr, sizeof(struct in_addr));
+        *ttl = iph->ttl;
+    } else {
+        sa6 = (struct sockaddr_in6 *)src;
+        sa6->sin6_family = AF_INET6;
+        memcpy(&sa6->sin6_addr, &ip6h->ip6_src, sizeof(struct in6_addr));
+        sa6 = (struct sockaddr_in6 *)dst;
+        sa6->sin6_family = AF_INET6;
+        sa6->sin6_port = udpdport(udph);
+        memcpy(&sa6->sin6_addr, &ip6h->ip6_dst, sizeof(struct in6_addr));
+        *ttl = ip6h->ip6_hops;
+    }
+}
+
+/* Encapsulate with the template 'tmpl' the segments of the TCP packet 'pkt'
+ * read from the tun and send them with UDP segmentation offload. Each UDP
+ * payload is built as the tunnel header and the headers of the segment,
+ * followed by its payload where it is in 'pkt'. The kernel builds the outer
+ * IP and UDP headers and their checksums from the ones of the socket, so the
+ * UDP source port is the data port the socket is bound to and the UDP
+ * checksum is always calculated. When the source port identifies the flow or
+ * the IPv4 UDP checksum is not sent, the segments are not offloaded.
+ * 'offset' is updated with the position in the TCP payload of the first
+ * segment not sent. Returns BAD if not all the segments have been sent */
+int
+tun_offload_send_segments(tun_io_t *io, lbuf_t *pkt, struct virtio_net_hdr *vh,
+        uint32_t *offset, pkt_encap_tmpl_t *tmpl)
+{
+    uint8_t hdrs[TUN_OFFLOAD_MAX_SEGS][PKT_ENCAP_TUN_HDR_MAX_LEN
+                                       + TUN_OFFLOAD_MAX_HDRS_LEN];
+    struct iovec iov[2 * TUN_OFFLOAD_MAX_SEGS];
+    struct sockaddr_storage src, dst;
+    tun_offload_tso_t tso;
+    uint32_t tun_len, udp_len, max_len, total, off, len;
+    int n, sock, ttl, tos, tmpl_ttl;
+
+    if (data_plane_conf.udp_src_port_entropy) {
+        return (BAD);
+    }
+    if (tmpl->afi == AF_INET && tmpl->zero_udp_csum) {
+        return (BAD);
+    }
+    sock = tmpl->afi == AF_INET ? io->gso_sock_v4 : io->gso_sock_v6;
+    if (sock == ERR_SOCKET || tun_offload_parse_tso(pkt, vh, &tso) != GOOD) {
+        return (BAD);
+    }
+    tun_len = tmpl->len - tmpl->ip_len - sizeof(struct udphdr);
+    /* Size of the UDP payload of all the segments but the last one */
+    udp_len = tun_len + tso.hdr_len + tso.seg_size;
+    /* The IPv4 total length includes the header */
+    max_len = TUN_OFFLOAD_MAX_GSO_LEN;
+    if (tmpl->afi == AF_INET) {
+        max_len -= sizeof(struct iphdr);
+    }
+    if (udp_len > max_len) {
+        return (BAD);
+    }
+    tun_offload_tmpl_to_sockaddr(tmpl, &src, &dst, &tmpl_ttl);
+    /* As with pkt_push_encap_tmpl, TTL and TOS are copied from the inner
+     * header */
+    ip_hdr_ttl_and_tos((struct iphdr *)tso.data, &ttl, &tos);
+    if (ttl == 0) {
+        ttl = tmpl_ttl;
+    }
+
+    off = *offset;
+    while (off < tso.payload_len) {
+        n = 0;
+        total = 0;
+        while (off < tso.payload_len && n < TUN_OFFLOAD_MAX_SEGS
+                && total + udp_len <= max_len) {
+            len = tso.payload_len - off;
+            if (len > tso.seg_size) {
+                len = tso.seg_size;
+            }
+            memcpy(hdrs[n], tmpl->hdr + tmpl->len - tun_len, tun_len);
+            tun_offload_seg_hdrs(&tso, off, len, hdrs[n] + tun_len);
+            iov[2 * n].iov_base = hdrs[n];
+            iov[2 * n].iov_len = tun_len + tso.hdr_len;
+            iov[2 * n + 1].iov_base = tso.data + tso.hdr_len + off;
+            iov[2 * n + 1].iov_len = len;
+            total += tun_len + tso.hdr_len + len;
+            off += len;
+            n++;
+        }
+        if (send_datagram_gso(sock, iov, 2 * n, udp_len, &src, &dst, tos,
+                ttl) != GOOD) {
+            return (BAD);
+        }
+        *offset = off;
+    }
+
+    return (GOOD);
+}
+
+/*
+ * Editor modelines
+ *
+ * vi: set shiftwidth=4 tabstop=4 expandtab:
+ * :indentSize=4:tabSize=4:noTabs=true:
+ */
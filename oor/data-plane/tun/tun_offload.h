@@ -0,0 +1,48 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef TUN_OFFLOAD_H_
+#define TUN_OFFLOAD_H_
+
+#include <linux/virtio_net.h>
+#include <netinet/ip6.h>
+#include "tun.h"
+
+/* Size of the buffer used to receive the TCP packets of up to 64KB from the
+ * tun and the coalesced datagrams from the data sockets */
+#define TUN_OFFLOAD_BUF_SIZE        (65536 + LBUF_STACK_OFFSET)
+/* Maximum number of packets sent with a single UDP segmentation offload call */
+#define TUN_OFFLOAD_MAX_SEGS        64
+/* Maximum size of the UDP payloads sent with a single UDP segmentation offload
+ * call (IPv6 payload length - UDP header). With IPv4, the IPv4 header is also
+ * subtracted */
+#define TUN_OFFLOAD_MAX_GSO_LEN     (65535 - 8)
+/* Maximum size of the IP and TCP headers of the segments */
+#define TUN_OFFLOAD_MAX_HDRS_LEN    (sizeof(struct ip6_hdr) + 60)
+
+int tun_offload_read(int fd, lbuf_t *b, uint8_t *offload_buf,
+        struct virtio_net_hdr *vh);
+int tun_offload_write(int fd, lbuf_t *b);
+int tun_offload_csum(lbuf_t *b, struct virtio_net_hdr *vh);
+int tun_offload_segment(lbuf_t *pkt, struct virtio_net_hdr *vh,
+        uint32_t *offset, lbuf_t *seg);
+int tun_offload_send_segments(tun_io_t *io, lbuf_t *pkt,
+        struct virtio_net_hdr *vh, uint32_t *offset, pkt_encap_tmpl_t *tmpl);
+
+#endif /* TUN_OFFLOAD_H_ */
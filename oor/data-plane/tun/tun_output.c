@@ -19,9 +19,12 @@
 
 
 #include <errno.h>
+#include <string.h>
 
 #include "tun.h"
+#include "tun_offload.h"
 #include "tun_output.h"
+#include "tun_worker.h"
 #include "../encapsulations/vxlan-gpe.h"
 #include "../../fwd_policies/fwd_policy.h"
 #include "../../fwd_policies/flow_balancing/fwd_entry_tuple.h"
@@ -33,17 +36,85 @@
 #include "../../lib/sockets-util.h"
 
 
-/* static buffer to receive packets */
-static uint8_t pkt_recv_buf[TUN_RECEIVE_SIZE];
-static lbuf_t pkt_buf;
+static int tun_output_multicast(tun_io_t *io, lbuf_t *b, packet_tuple_t *tuple);
+static int tun_output_unicast(tun_io_t *io, lbuf_t *b, packet_tuple_t *tuple);
+static int tun_output_fwd_info(tun_io_t *io, lbuf_t *b, packet_tuple_t *tuple,
+        fwd_info_t *fi);
+static int tun_forward_native(tun_io_t *io, lbuf_t *b, lisp_addr_t *dst);
+static int tun_send_pkt(tun_io_t *io, int sock, lbuf_t *b, ip_addr_t *dst);
+static void tun_output_tun_pkt(tun_io_t *io, lbuf_t *b);
+static uint16_t tun_encap_src_port(packet_tuple_t *tuple, uint16_t port);
+static void tun_encap_udp_csum(lbuf_t *b, lisp_addr_t *drloc);
+static void tun_encap_tmpl_init(fwd_info_t *fi);
+static void tun_fwd_entry_unlink(tun_dplane_data_t *data, fwd_entry_tuple_t *fe);
+static fwd_info_t *tun_output_get_fwd_info(tun_io_t *io, packet_tuple_t *tuple);
+static int tun_output_segments_gso(tun_io_t *io, lbuf_t *pkt,
+        struct virtio_net_hdr *vh, uint32_t *offset);
+static void tun_output_segments(tun_io_t *io, lbuf_t *pkt,
+        struct virtio_net_hdr *vh, int *slot);
+
+/* Sends the packet or, when working in burst mode, queues it to be sent
+ * with the rest of the burst in tun_output_flush */
+static int
+tun_send_pkt(tun_io_t *io, int sock, lbuf_t *b, ip_addr_t *dst)
+{
+    tun_dplane_data_t *data = tun_get_datap_data();
+    int slen, pos;
+
+    if (data->burst_size <= 1){
+        return (send_raw_packet(sock, lbuf_data(b), lbuf_size(b), dst));
+    }
+
+    if (io->tx_pending >= data->burst_size){
+        tun_output_flush(io);
+    }
+
+    pos = io->tx_pending;
+    slen = ip_addr_to_sockaddr(dst, &io->tx_dst[pos]);
+    if (slen == 0){
+        return (BAD);
+    }
+    io->tx_iov[pos].iov_base = lbuf_data(b);
+    io->tx_iov[pos].iov_len = lbuf_size(b);
+    memset(&io->tx_msgs[pos], 0, sizeof(struct mmsghdr));
+    io->tx_msgs[pos].msg_hdr.msg_name = &io->tx_dst[pos];
+    io->tx_msgs[pos].msg_hdr.msg_namelen = slen;
+    io->tx_msgs[pos].msg_hdr.msg_iov = &io->tx_iov[pos];
+    io->tx_msgs[pos].msg_hdr.msg_iovlen = 1;
+    io->tx_sock[pos] = sock;
+    io->tx_pending++;
 
+    return (GOOD);
+}
 
-static int tun_output_multicast(lbuf_t *b, packet_tuple_t *tuple);
-static int tun_output_unicast(lbuf_t *b, packet_tuple_t *tuple);
-static int tun_forward_native(lbuf_t *b, lisp_addr_t *dst);
+/* Sends the queued packets. Packets are grouped by output socket in order
+ * to send each group with a single system call */
+void
+tun_output_flush(tun_io_t *io)
+{
+    struct mmsghdr msgs[DATA_PLANE_MAX_BURST_SIZE];
+    int i, j, sock, vlen;
+
+    for (i = 0; i < io->tx_pending; i++){
+        if (io->tx_sock[i] == ERR_SOCKET){
+            continue;
+        }
+        sock = io->tx_sock[i];
+        vlen = 0;
+        for (j = i; j < io->tx_pending; j++){
+            if (io->tx_sock[j] != sock){
+                continue;
+            }
+            msgs[vlen++] = io->tx_msgs[j];
+            io->tx_sock[j] = ERR_SOCKET;
+        }
+        send_raw_packets(sock, msgs, vlen);
+    }
+    io->tx_pending = 0;
+}
 
 static int
-tun_forward_native(lbuf_t *b, lisp_addr_t *dst)
+tun_forward_native(tun_io_t *io, lbuf_t *b, lisp_addr_t *dst)
 {
     int ret, sock, afi;
 
@@ -58,7 +129,7 @@ tun_forward_native(lbuf_t *b, lisp_addr_t *dst)
         return (BAD);
     }
 
-    ret = send_raw_packet(sock, lbuf_data(b), lbuf_size(b), lisp_addr_ip(dst));
+    ret = tun_send_pkt(io, sock, b, lisp_addr_ip(dst));
     return (ret);
 }
 
@@ -93,15 +164,40 @@ make_mcast_addr(packet_tuple_t *tuple, lisp_addr_t *addr){
 }
 
 
+/* Remove the flow from the table of its shard and from the indexes of EIDs.
+ * It should only be called from the main thread */
 void
-tun_rm_dp_entry(packet_tuple_t *tuple)
+tun_rm_dp_entry(fwd_entry_tuple_t *fe)
 {
     tun_dplane_data_t *data = tun_get_datap_data();
-    ttable_remove(&(data->ttable), tuple);
+    tun_ttable_shard_t *shard = tun_get_ttable_shard(data, pkt_tuple_hash(fe->tuple));
+
+    tun_fwd_entry_unlink(data, fe);
+    /* The tupla is released with the entry */
+    ttable_remove(&shard->ttable, fe->tuple);
+}
+
+/* Unlink the flow from the lists of the destination EID, of the source EID
+ * and of the PeTRs */
+static void
+tun_fwd_entry_unlink(tun_dplane_data_t *data, fwd_entry_tuple_t *fe)
+{
+    tun_eid_index_unlink(&data->eid_index, &fe->eid_link);
+    tun_eid_index_unlink(&data->src_eid_index, &fe->src_eid_link);
+    tun_eid_index_unlink(&data->petrs_index, &fe->petrs_link);
+}
+
+/* Called when the flow table evicts or expires an
+ * entry. The tupla is unlinked from the indexes of EIDs before the table
+ * releases the entry */
+void
+tun_ttable_entry_removed(fwd_info_t *fi)
+{
+    tun_fwd_entry_unlink(tun_get_datap_data(), (fwd_entry_tuple_t *)fi->dp_conf_inf);
 }
 
 static int
-tun_output_multicast(lbuf_t *b, packet_tuple_t *tuple)
+tun_output_multicast(tun_io_t *io, lbuf_t *b, packet_tuple_t *tuple)
 {
     glist_t *or_list = NULL;
     lisp_addr_t *src_rloc = NULL, *daddr = NULL, *dst_rloc = NULL;
@@ -139,7 +235,9 @@ tun_output_multicast(lbuf_t *b, packet_tuple_t *tuple)
         if (out_sock == NULL){
             return (BAD);
         }
-        lisp_data_encap(b, LISP_DATA_PORT, LISP_DATA_PORT, src_rloc, dst_rloc, 0);
+        lisp_data_encap(b, tun_encap_src_port(tuple, LISP_DATA_PORT), LISP_DATA_PORT,
+                src_rloc, dst_rloc, 0);
+        tun_encap_udp_csum(b, dst_rloc);
 
         send_raw_packet(*out_sock, lbuf_data(b), lbuf_size(b),lisp_addr_ip(dst_rloc));
     }
@@ -149,65 +247,189 @@ tun_output_multicast(lbuf_t *b, packet_tuple_t *tuple)
     return (GOOD);
 }
 
-static int
-tun_output_unicast(lbuf_t *b, packet_tuple_t *tuple)
+/* UDP source port of the packets of the tupla encapsulated to the data port
+ * 'port'. With entropy, the port identifies the inner flow to the underlay
+ * (RFC 6830) */
+static uint16_t
+tun_encap_src_port(packet_tuple_t *tuple, uint16_t port)
+{
+    uint32_t hash;
+
+    if (!data_plane_conf.udp_src_port_entropy){
+        return (port);
+    }
+    hash = pkt_tuple_hash(tuple);
+    return (DATA_PLANE_UDP_SRC_PORT_MIN
+            + ((hash ^ (hash >> 16)) % DATA_PLANE_UDP_SRC_PORT_RANGE));
+}
+
+/* Clear the checksum of the outer UDP header of a packet encapsulated
+ * without template when IPv4 UDP checksums are disabled */
+static void
+tun_encap_udp_csum(lbuf_t *b, lisp_addr_t *drloc)
+{
+    struct udphdr *uh;
+
+    if (data_plane_conf.ipv4_udp_checksum || lisp_addr_ip_afi(drloc) != AF_INET){
+        return;
+    }
+    uh = lbuf_udp(b);
+    udpsum(uh) = 0;
+}
+
+/* Prebuild the outer headers of the packets encapsulated with the entry. If
+ * it fails, the headers are built for each packet */
+static void
+tun_encap_tmpl_init(fwd_info_t *fi)
+{
+    fwd_entry_tuple_t *fe = (fwd_entry_tuple_t *)fi->dp_conf_inf;
+    int ret = BAD;
+
+    switch (fi->encap){
+    case ENCP_LISP:
+        fe->encap_sport = tun_encap_src_port(fe->tuple, LISP_DATA_PORT);
+        ret = lisp_data_encap_tmpl_init(&fe->encap_tmpl,
+                fe->encap_sport, LISP_DATA_PORT,
+                fe->srloc, fe->drloc, fe->iid);
+        break;
+    case ENCP_VXLAN_GPE:
+        fe->encap_sport = tun_encap_src_port(fe->tuple, VXLAN_GPE_DATA_PORT);
+        ret = vxlan_gpe_data_encap_tmpl_init(&fe->encap_tmpl,
+                fe->encap_sport, VXLAN_GPE_DATA_PORT,
+                fe->srloc, fe->drloc, fe->iid);
+        break;
+    }
+    if (ret != GOOD){
+        OOR_LOG(LDBG_2, "tun_encap_tmpl_init: Couldn't build the encapsulation "
+                "template of RLOC %s -> %s", lisp_addr_to_char(fe->srloc),
+                lisp_addr_to_char(fe->drloc));
+        return;
+    }
+    fe->encap_tmpl.zero_udp_csum = !data_plane_conf.ipv4_udp_checksum;
+}
+
+/* Obtain from the control the forwarding information of the tupla and add it
+ * to the data plane. The flow key and its hash are the ones of the tupla, used
+ * by the caller in the lookup that missed. It should only be called from the
+ * main thread */
+fwd_info_t *
+tun_install_fwd_info(packet_tuple_t *tuple, pkt_flow_key_t *flow_key,
+        uint32_t hash)
 {
     fwd_info_t *fi;
     fwd_entry_tuple_t *fe;
-    glist_t *fwd_tuple_lst, *pxtr_fwd_tuple_list;
+    pkt_eid_key_t key, src_key;
     tun_dplane_data_t *dp_data;
+    tun_ttable_shard_t *shard;
+    uint32_t iid = tuple->iid;
 
     dp_data = tun_get_datap_data();
 
-    fi = ttable_lookup(&(dp_data->ttable), tuple);
-    if (!fi) {
-        fi = (fwd_info_t *)ctrl_get_forwarding_info(tuple);
-        if (!fi){
-            return (BAD);
-        }
-        fe = (fwd_entry_tuple_t *)fi->dp_conf_inf;
-        if (fe && fe->srloc && fe->drloc)  {
-            fe->out_sock = get_out_socket_ptr_from_address(fe->srloc);
-        }
-        // While we can not get iid from interface, we insert the tupla with iid = 0.
-        //   We only support a same EID prefix per xTR
-        fe->tuple->iid = 0;
-        // fe->tuple is cloned from tuple
-        if (ttable_insert(&(dp_data->ttable), fe->tuple, fi) != GOOD){
-            /* If table is full, reset the data plane */
-            tun_reset_all_fwd();
-            ttable_insert(&(dp_data->ttable), fe->tuple, fi);
-        }
+    fi = (fwd_info_t *)ctrl_get_forwarding_info(tuple);
+    if (!fi){
+        return (NULL);
+    }
+    fe = (fwd_entry_tuple_t *)fi->dp_conf_inf;
+    if (!fe){
+        fwd_info_del(fi);
+        return (NULL);
+    }
+    if (fe->srloc && fe->drloc)  {
+        fe->out_sock = get_out_socket_ptr_from_address(fe->srloc);
+        tun_encap_tmpl_init(fi);
+    }
+    // The entry is inserted with the iid used in the lookup. While we can not get iid
+    //   from interface, xTR and MN use iid = 0. We only support a same EID prefix per xTR
+    fe->tuple->iid = iid;
+    // fe->tuple is cloned from tuple
+    shard = tun_get_ttable_shard(dp_data, hash);
+    if (ttable_insert_key(&shard->ttable, flow_key, hash, fe->tuple, fi) != GOOD){
+        /* The table evicts the least recently used flows when it is full, so
+         * the flow was already in the table. Use the existing entry */
+        fwd_info_del(fi);
+        return (ttable_lookup_key(&shard->ttable, flow_key, hash));
+    }
 
+    /* Associate eid with fwd_info */
+    if (pkt_eid_key_init(&key, fi->associated_entry) != GOOD){
+        OOR_LOG(LDBG_3, "tun_install_fwd_info: The EID %s is not IP. It should never reach here",
+                lisp_addr_to_char(fi->associated_entry));
+        return (fi);
+    }
+    fe->eid_link.entry = fe;
+    tun_eid_index_link(&dp_data->eid_index, &key, &fe->eid_link);
+    OOR_LOG(LDBG_3, "tun_install_fwd_info: The tupla [%s] has been associated with the EID %s",
+            pkt_tuple_to_char(tuple),lisp_addr_to_char(fi->associated_entry));
+
+    /* Associate the source EID of the local mapping with fwd_info */
+    if (fi->associated_local_entry
+            && pkt_eid_key_init(&src_key, fi->associated_local_entry) == GOOD){
+        fe->src_eid_link.entry = fe;
+        tun_eid_index_link(&dp_data->src_eid_index, &src_key, &fe->src_eid_link);
+    }
 
-        /* Associate eid with fwd_info */
-        fwd_tuple_lst = (glist_t *)shash_lookup(dp_data->eid_to_dp_entries,lisp_addr_to_char(fi->associated_entry));
-        if (!fwd_tuple_lst){
-            fwd_tuple_lst = glist_new_managed((glist_del_fct)tun_rm_dp_entry);
-            shash_insert(dp_data->eid_to_dp_entries, strdup(lisp_addr_to_char(fi->associated_entry)), fwd_tuple_lst);
-        }
-        glist_add(fe->tuple,fwd_tuple_lst);
-        OOR_LOG(LDBG_3, "tun_output_unicast: The tupla [%s] has been associated with the EID %s",
-                pkt_tuple_to_char(tuple),lisp_addr_to_char(fi->associated_entry));
-
-        if(fi->neg_map_reply_act == ACT_NATIVE_FWD){ // Forwarding entry should be also associated with PeTRs list
-            switch (lisp_addr_ip_afi(fi->associated_entry)){
-            case AF_INET:
-                pxtr_fwd_tuple_list = (glist_t *)shash_lookup(dp_data->eid_to_dp_entries,FULL_IPv4_ADDRESS_SPACE);
-                break;
-            case AF_INET6:
-                pxtr_fwd_tuple_list = (glist_t *)shash_lookup(dp_data->eid_to_dp_entries,FULL_IPv6_ADDRESS_SPACE);
-                break;
-            default:
-                OOR_LOG(LDBG_3, "tun_output_unicast: Forwarding to PeTR is only for IP EIDs. It should never reach here");
-                return (BAD);
-            }
-            glist_add(fe->tuple,pxtr_fwd_tuple_list);
-            OOR_LOG(LDBG_3, "  and with PeTRs");
+    if(fi->neg_map_reply_act == ACT_NATIVE_FWD){ // Forwarding entry should be also associated with PeTRs list
+        tun_eid_key_full_space(&key, key.ip_version);
+        fe->petrs_link.entry = fe;
+        tun_eid_index_link(&dp_data->petrs_index, &key, &fe->petrs_link);
+        OOR_LOG(LDBG_3, "  and with PeTRs");
+    }
+
+    return (fi);
+}
+
+/* Get the forwarding information of the tupla. Returns NULL if the packet
+ * should be dropped */
+static fwd_info_t *
+tun_output_get_fwd_info(tun_io_t *io, packet_tuple_t *tuple)
+{
+    fwd_info_t *fi;
+    tun_dplane_data_t *dp_data;
+    tun_ttable_shard_t *shard;
+    pkt_flow_key_t key;
+    uint32_t hash;
+
+    /* The hash of the key selects the shard and the bucket inside it */
+    pkt_flow_key_init(&key, tuple);
+    hash = pkt_flow_key_hash(&key);
+    dp_data = tun_get_datap_data();
+    shard = tun_get_ttable_shard(dp_data, hash);
+
+    if (io->worker == NULL){
+        /* Main thread: it is the only one modifying the table */
+        fi = ttable_lookup_key(&shard->ttable, &key, hash);
+        if (!fi) {
+            fi = tun_install_fwd_info(tuple, &key, hash);
         }
-    }else{
-        fe = fi->dp_conf_inf;
+        return (fi);
+    }
+
+    /* Worker: the entry is valid until its next quiescent state. Misses are
+     * processed by the main thread and the packet is dropped */
+    fi = ttable_lookup_key(&shard->ttable, &key, hash);
+    if (!fi) {
+        tun_worker_push_miss(io->worker, tuple, hash);
+    }
+    return (fi);
+}
+
+static int
+tun_output_unicast(tun_io_t *io, lbuf_t *b, packet_tuple_t *tuple)
+{
+    fwd_info_t *fi;
+
+    fi = tun_output_get_fwd_info(io, tuple);
+    if (!fi){
+        return (BAD);
     }
+    return (tun_output_fwd_info(io, b, tuple, fi));
+}
+
+static int
+tun_output_fwd_info(tun_io_t *io, lbuf_t *b, packet_tuple_t *tuple,
+        fwd_info_t *fi)
+{
+    fwd_entry_tuple_t *fe = fi->dp_conf_inf;
 
     /* Packets with no/negative map cache entry AND no PETR
      * OR packets with missing src or dst RLOCs*/
@@ -216,10 +438,10 @@ tun_output_unicast(lbuf_t *b, packet_tuple_t *tuple)
         case ACT_NO_ACTION:
         case ACT_SEND_MREQ:
         case ACT_DROP:
-            OOR_LOG(LDBG_3, "tun_output_unicast: Packet dropped");
+            OOR_LOG(LDBG_3, "tun_output_fwd_info: Packet dropped");
             return (GOOD);
         case ACT_NATIVE_FWD:
-            return(tun_forward_native(b, &tuple->dst_addr));
+            return(tun_forward_native(io, b, &tuple->dst_addr));
         }
     }
 
@@ -227,21 +449,26 @@ tun_output_unicast(lbuf_t *b, packet_tuple_t *tuple)
             lisp_addr_to_char(fe->srloc),
             lisp_addr_to_char(fe->drloc));
 
-    switch (fi->encap){
-    case ENCP_LISP:
-        lisp_data_encap(b, LISP_DATA_PORT, LISP_DATA_PORT, fe->srloc, fe->drloc, fe->iid);
-        break;
-    case ENCP_VXLAN_GPE:
-        vxlan_gpe_data_encap(b, VXLAN_GPE_DATA_PORT, VXLAN_GPE_DATA_PORT, fe->srloc, fe->drloc, fe->iid);
-        break;
+    if (fe->encap_tmpl.len != 0){
+        pkt_push_encap_tmpl(b, &fe->encap_tmpl);
+    }else{
+        /* The source port was chosen when the template was tried */
+        switch (fi->encap){
+        case ENCP_LISP:
+            lisp_data_encap(b, fe->encap_sport, LISP_DATA_PORT, fe->srloc, fe->drloc, fe->iid);
+            break;
+        case ENCP_VXLAN_GPE:
+            vxlan_gpe_data_encap(b, fe->encap_sport, VXLAN_GPE_DATA_PORT, fe->srloc, fe->drloc, fe->iid);
+            break;
+        }
+        tun_encap_udp_csum(b, fe->drloc);
     }
 
-    return(send_raw_packet(*(fe->out_sock), lbuf_data(b), lbuf_size(b),
-               lisp_addr_ip(fe->drloc)));
+    return(tun_send_pkt(io, *(fe->out_sock), b, lisp_addr_ip(fe->drloc)));
 }
 
 int
-tun_output(lbuf_t *b, packet_tuple_t *tpl)
+tun_output(tun_io_t *io, lbuf_t *b, packet_tuple_t *tpl)
 {
     OOR_LOG(LDBG_3,"OUTPUT: Received EID %s -> %s, Proto: %d, Port: %d -> %d ",
             lisp_addr_to_char(&tpl->src_addr), lisp_addr_to_char(&tpl->dst_addr),
@@ -250,12 +477,12 @@ tun_output(lbuf_t *b, packet_tuple_t *tpl)
     /* If already LISP packet, do not encapsulate again */
     if (pkt_tuple_is_lisp(tpl)) {
         OOR_LOG(LDBG_3,"OUTPUT: Is a lisp packet, do not encapsulate again");
-        return (tun_forward_native(b, &tpl->dst_addr));
+        return (tun_forward_native(io, b, &tpl->dst_addr));
     }
     if (ip_addr_is_multicast(lisp_addr_ip(&tpl->dst_addr))) {
-        tun_output_multicast(b, tpl);
+        tun_output_multicast(io, b, tpl);
     } else {
-        tun_output_unicast(b, tpl);
+        tun_output_unicast(io, b, tpl);
     }
     return(GOOD);
 }
@@ -263,24 +490,140 @@ tun_output(lbuf_t *b, packet_tuple_t *tpl)
 int
 tun_output_recv(sock_t *sl)
 {
-    packet_tuple_t tpl;
+    return (tun_output_recv_burst(&tun_main_io, sl->fd));
+}
 
-    lbuf_use_stack(&pkt_buf, &pkt_recv_buf, TUN_RECEIVE_SIZE);
-    lbuf_reserve(&pkt_buf, LBUF_STACK_OFFSET);
+/* Encapsulate and send a packet read from the tun */
+static void
+tun_output_tun_pkt(tun_io_t *io, lbuf_t *b)
+{
+    packet_tuple_t tpl;
 
-    if (sock_recv(sl->fd, &pkt_buf) != GOOD) {
-        OOR_LOG(LWRN, "OUTPUT: Error while reading from tun!");
-        return (BAD);
-    }
-    lbuf_reset_ip(&pkt_buf);
-    if (pkt_parse_5_tuple(&pkt_buf, &tpl) != GOOD) {
-        return (BAD);
+    lbuf_reset_ip(b);
+    if (pkt_parse_5_tuple(b, &tpl) != GOOD) {
+        return;
     }
     /* XXX Since OOR doesn't support same local prefixes with different IIDs when
      * operating as a XTR or MN, we use IID = 0 to calculate the hash of the ttable.
      * The actual IID to be used on the encapsulation processed is already stored
      * in the forwarding entry, which is obtained on a ttable miss.*/
     tpl.iid = 0;
-    tun_output(&pkt_buf, &tpl);
-    return (GOOD);
+    tun_output(io, b, &tpl);
+}
+
+/* Send with UDP segmentation offload the segments of a TCP packet read from
+ * the tun, when its flow is encapsulated with a template. The segments are
+ * built straight into the GSO datagram, without building their outer
+ * headers. 'offset' is updated with the position in the TCP payload of the
+ * first segment not sent. Returns BAD if not all the segments have been
+ * sent */
+static int
+tun_output_segments_gso(tun_io_t *io, lbuf_t *pkt, struct virtio_net_hdr *vh,
+        uint32_t *offset)
+{
+    lbuf_t b = *pkt;
+    packet_tuple_t tpl;
+    fwd_info_t *fi;
+    fwd_entry_tuple_t *fe;
+
+    /* All the segments have the 5 tuple of the packet */
+    lbuf_reset_ip(&b);
+    if (pkt_parse_5_tuple(&b, &tpl) != GOOD || pkt_tuple_is_lisp(&tpl)
+            || ip_addr_is_multicast(lisp_addr_ip(&tpl.dst_addr))) {
+        return (BAD);
+    }
+    tpl.iid = 0;
+    fi = tun_output_get_fwd_info(io, &tpl);
+    if (!fi){
+        /* Each one of the segments would be dropped */
+        return (GOOD);
+    }
+    fe = fi->dp_conf_inf;
+    if (!fe || !fe->srloc || !fe->drloc || fe->encap_tmpl.len == 0){
+        return (BAD);
+    }
+    /* The queued packets of the flow are sent before the segments */
+    if (io->tx_pending > 0){
+        tun_output_flush(io);
+    }
+    return (tun_offload_send_segments(io, pkt, vh, offset, &fe->encap_tmpl));
+}
+
+/* Split in MTU sized segments a TCP packet read from the tun with offload.
+ * Each segment uses the next free buffer of the burst. When all of them are
+ * in use, the queued packets are sent to reuse the buffers. The data of the
+ * packet is in the offload buffer, but its descriptor is the buffer of the
+ * slot, so it is copied before the slot is reused. The segments not sent
+ * with UDP segmentation offload are encapsulated one by one */
+static void
+tun_output_segments(tun_io_t *io, lbuf_t *b, struct virtio_net_hdr *vh,
+        int *slot)
+{
+    lbuf_t pkt = *b;
+    uint32_t offset = 0;
+
+    if (tun_output_segments_gso(io, &pkt, vh, &offset) == GOOD){
+        return;
+    }
+    while (1){
+        if (*slot == DATA_PLANE_MAX_BURST_SIZE){
+            tun_output_flush(io);
+            *slot = 0;
+        }
+        b = &io->rx_lbuf[*slot];
+        lbuf_use_stack(b, &io->rx_buf[*slot], TUN_IO_BUF_SIZE);
+        lbuf_reserve(b, LBUF_STACK_OFFSET);
+        if (tun_offload_segment(&pkt, vh, &offset, b) != GOOD){
+            return;
+        }
+        (*slot)++;
+        tun_output_tun_pkt(io, b);
+    }
+}
+
+int
+tun_output_recv_burst(tun_io_t *io, int fd)
+{
+    tun_dplane_data_t *data = tun_get_datap_data();
+    struct virtio_net_hdr vh;
+    lbuf_t *b;
+    int i, slot = 0, ret;
+
+    /* Drain up to burst size packets from the tun. Each packet uses its own
+     * buffer as they are not sent until the end of the burst */
+    for (i = 0; i < data->burst_size; i++){
+        if (slot == DATA_PLANE_MAX_BURST_SIZE){
+            tun_output_flush(io);
+            slot = 0;
+        }
+        b = &io->rx_lbuf[slot];
+        lbuf_use_stack(b, &io->rx_buf[slot], TUN_RECEIVE_SIZE);
+        lbuf_reserve(b, LBUF_STACK_OFFSET);
+
+        if (data->offload){
+            ret = tun_offload_read(fd, b, io->offload_buf, &vh);
+        }else{
+            ret = sock_recv(fd, b);
+        }
+        if (ret != GOOD) {
+            if (i == 0){
+                OOR_LOG(LWRN, "OUTPUT: Error while reading from tun!");
+            }
+            break;
+        }
+        if (data->offload){
+            if (vh.gso_type != VIRTIO_NET_HDR_GSO_NONE){
+                tun_output_segments(io, b, &vh, &slot);
+                continue;
+            }
+            if (tun_offload_csum(b, &vh) != GOOD){
+                continue;
+            }
+        }
+        slot++;
+        tun_output_tun_pkt(io, b);
+    }
+    tun_output_flush(io);
+
+    return (i == 0 ? BAD : GOOD);
 }
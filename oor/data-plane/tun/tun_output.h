@@ -32,9 +32,16 @@
 #include "../../iface_list.h"
 #include "../../oor_external.h"
 #include "../../lib/cksum.h"
+#include "tun.h"
 
 
 int tun_output_recv(sock_t *sl);
-int tun_output(lbuf_t *, packet_tuple_t *);
+int tun_output_recv_burst(tun_io_t *io, int fd);
+int tun_output(tun_io_t *io, lbuf_t *, packet_tuple_t *);
+void tun_output_flush(tun_io_t *io);
+fwd_info_t *tun_install_fwd_info(packet_tuple_t *tuple, pkt_flow_key_t *flow_key,
+        uint32_t hash);
+void tun_ttable_entry_removed(fwd_info_t *fi);
+void tun_rm_dp_entry(fwd_entry_tuple_t *fe);
 
 #endif /*TUN_OUTPUT_H_*/
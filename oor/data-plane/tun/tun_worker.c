@@ -0,0 +1,390 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include "tun_worker.h"
+#include "tun_input.h"
+#include "tun_offload.h"
+#include "tun_output.h"
+#include "../../oor_external.h"
+#include "../../lib/mem_util.h"
+#include "../../lib/oor_log.h"
+#include "../../lib/sockets.h"
+#include "../../lib/sockets-util.h"
+
+
+/* Used by the workers to notify the main thread that there are misses
+ * pending to be processed */
+static int miss_event_fd = ERR_SOCKET;
+
+static tun_worker_t *tun_worker_new(int id, oor_dev_type_e dev_type, int data_port,
+        int tun_fd);
+static void tun_worker_free(tun_worker_t *worker);
+static int tun_worker_start(tun_worker_t *worker);
+static void tun_worker_stop(tun_worker_t *worker);
+static void *tun_worker_run(void *arg);
+static int tun_worker_pop_miss(tun_worker_t *worker, packet_tuple_t *tpl);
+static int tun_workers_process_misses(sock_t *sl);
+
+
+/* Create a worker. If data_port is 0, the worker doesn't process input data
+ * packets. If tun_fd is ERR_SOCKET, the worker doesn't read from the tun */
+static tun_worker_t *
+tun_worker_new(int id, oor_dev_type_e dev_type, int data_port, int tun_fd)
+{
+    tun_worker_t *worker;
+
+    worker = xzalloc(sizeof(tun_worker_t));
+    if (!worker){
+        return (NULL);
+    }
+    worker->id = id;
+    worker->dev_type = dev_type;
+    worker->io.worker = worker;
+    worker->fd_v4 = ERR_SOCKET;
+    worker->fd_v6 = ERR_SOCKET;
+    worker->tun_fd = tun_fd;
+    /* The filter of misses starts empty */
+    worker->misses.gen = 1;
+    worker->io.gso_sock_v4 = ERR_SOCKET;
+    worker->io.gso_sock_v6 = ERR_SOCKET;
+    if (data_plane_conf.offload){
+        worker->io.offload_buf = xmalloc(TUN_OFFLOAD_BUF_SIZE);
+        if (!worker->io.offload_buf){
+            tun_worker_free(worker);
+            return (NULL);
+        }
+    }
+
+    if (data_port == 0){
+        return (worker);
+    }
+    /* Each worker has its own sockets. The kernel balances the flows between them */
+    if (default_rloc_afi != AF_INET6) {
+        worker->fd_v4 = open_data_reuseport_input_socket(AF_INET, data_port);
+        if (worker->fd_v4 == ERR_SOCKET){
+            tun_worker_free(worker);
+            return (NULL);
+        }
+    }
+    if (default_rloc_afi != AF_INET) {
+        worker->fd_v6 = open_data_reuseport_input_socket(AF_INET6, data_port);
+        if (worker->fd_v6 == ERR_SOCKET){
+            tun_worker_free(worker);
+            return (NULL);
+        }
+    }
+    /* Without GRO, the packets are processed as with no offload. The worker
+     * sends with GSO using its input sockets */
+    if (data_plane_conf.offload){
+        if (worker->fd_v4 != ERR_SOCKET){
+            socket_conf_udp_gro(worker->fd_v4);
+        }
+        if (worker->fd_v6 != ERR_SOCKET){
+            socket_conf_udp_gro(worker->fd_v6);
+        }
+        worker->io.gso_sock_v4 = worker->fd_v4;
+        worker->io.gso_sock_v6 = worker->fd_v6;
+    }
+
+    return (worker);
+}
+
+static void
+tun_worker_free(tun_worker_t *worker)
+{
+    if (worker->fd_v4 != ERR_SOCKET){
+        close(worker->fd_v4);
+    }
+    if (worker->fd_v6 != ERR_SOCKET){
+        close(worker->fd_v6);
+    }
+    free(worker->io.offload_buf);
+    free(worker);
+}
+
+static int
+tun_worker_start(tun_worker_t *worker)
+{
+    sigset_t all, old;
+    int err;
+
+    /* Signals should be processed by the main thread */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    worker->running = TRUE;
+    rcu_thread_register(&worker->rcu);
+    err = pthread_create(&worker->thread, NULL, tun_worker_run, worker);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (err != 0){
+        OOR_LOG(LERR, "tun_worker_start: Couldn't create worker %d: %s",
+                worker->id, strerror(err));
+        rcu_thread_unregister(&worker->rcu);
+        worker->running = FALSE;
+        return (BAD);
+    }
+
+    return (GOOD);
+}
+
+static void
+tun_worker_stop(tun_worker_t *worker)
+{
+    if (!worker->running){
+        return;
+    }
+    __atomic_store_n(&worker->running, FALSE, __ATOMIC_RELEASE);
+    pthread_join(worker->thread, NULL);
+    rcu_thread_unregister(&worker->rcu);
+}
+
+static void *
+tun_worker_run(void *arg)
+{
+    tun_worker_t *worker = (tun_worker_t *)arg;
+    struct pollfd fds[3];
+    int nfds = 0, i;
+
+    if (worker->fd_v4 != ERR_SOCKET){
+        fds[nfds].fd = worker->fd_v4;
+        fds[nfds].events = POLLIN;
+        nfds++;
+    }
+    if (worker->fd_v6 != ERR_SOCKET){
+        fds[nfds].fd = worker->fd_v6;
+        fds[nfds].events = POLLIN;
+        nfds++;
+    }
+    if (worker->tun_fd != ERR_SOCKET){
+        fds[nfds].fd = worker->tun_fd;
+        fds[nfds].events = POLLIN;
+        nfds++;
+    }
+
+    OOR_LOG(LDBG_1, "Data plane worker %d started", worker->id);
+
+    while (__atomic_load_n(&worker->running, __ATOMIC_ACQUIRE)){
+        /* The forwarding entries obtained while processing the previous
+         * packets are no longer used */
+        rcu_thread_offline(&worker->rcu);
+        if (poll(fds, nfds, TUN_WORKER_POLL_TIMEOUT) <= 0){
+            continue;
+        }
+        rcu_thread_online(&worker->rcu);
+        for (i = 0; i < nfds; i++){
+            if (!(fds[i].revents & POLLIN)){
+                continue;
+            }
+            if (fds[i].fd == worker->tun_fd){
+                tun_output_recv_burst(&worker->io, fds[i].fd);
+            }else if (worker->dev_type == RTR_MODE){
+                tun_rtr_process_input_burst(&worker->io, fds[i].fd, FALSE);
+            }else{
+                tun_process_input_burst(&worker->io, fds[i].fd, FALSE);
+            }
+        }
+    }
+    rcu_thread_offline(&worker->rcu);
+
+    return (NULL);
+}
+
+/* Called by the worker when there is no forwarding entry for a tupla. The
+ * forwarding entry is obtained later by the main thread. The hash is the one
+ * of the flow key of the tupla. The packets of a flow received until the main
+ * thread drains the queue are not queued again */
+int
+tun_worker_push_miss(tun_worker_t *worker, packet_tuple_t *tpl, uint32_t hash)
+{
+    tun_miss_queue_t *q = &worker->misses;
+    uint32_t head = q->head;
+    uint32_t gen = __atomic_load_n(&q->gen, __ATOMIC_RELAXED);
+    int slot = hash & (TUN_WORKER_MISS_FILTER_SIZE - 1);
+    uint64_t ev = 1;
+
+    if (q->filter_hash[slot] == hash && q->filter_gen[slot] == gen){
+        return (GOOD);
+    }
+    if (head - __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE) == TUN_WORKER_MISS_QUEUE_SIZE){
+        OOR_LOG(LDBG_2, "tun_worker_push_miss: Queue of misses of worker %d full",
+                worker->id);
+        return (BAD);
+    }
+    q->tuples[head & (TUN_WORKER_MISS_QUEUE_SIZE - 1)] = *tpl;
+    __atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+    q->filter_hash[slot] = hash;
+    q->filter_gen[slot] = gen;
+
+    /* Only the first miss queued since the main thread started draining the
+     * queue notifies it. The exchange synchronizes with the one of the main
+     * thread, so a miss not notified is seen by the drain that follows */
+    if (__atomic_exchange_n(&q->notified, TRUE, __ATOMIC_SEQ_CST)){
+        return (GOOD);
+    }
+    if (write(miss_event_fd, &ev, sizeof(ev)) == -1){
+        OOR_LOG(LDBG_2, "tun_worker_push_miss: Couldn't notify the miss: %s",
+                strerror(errno));
+    }
+    return (GOOD);
+}
+
+static int
+tun_worker_pop_miss(tun_worker_t *worker, packet_tuple_t *tpl)
+{
+    tun_miss_queue_t *q = &worker->misses;
+    uint32_t tail = q->tail;
+
+    if (tail == __atomic_load_n(&q->head, __ATOMIC_ACQUIRE)){
+        return (BAD);
+    }
+    *tpl = q->tuples[tail & (TUN_WORKER_MISS_QUEUE_SIZE - 1)];
+    __atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+    return (GOOD);
+}
+
+/* Process in the main thread the misses of the workers */
+static int
+tun_workers_process_misses(sock_t *sl)
+{
+    tun_dplane_data_t *data = tun_get_datap_data();
+    tun_ttable_shard_t *shard;
+    tun_miss_queue_t *q;
+    packet_tuple_t tpl;
+    pkt_flow_key_t key;
+    uint32_t hash;
+    uint64_t ev;
+    int i;
+
+    if (read(sl->fd, &ev, sizeof(ev)) != sizeof(ev)){
+        return (BAD);
+    }
+
+    for (i = 0; i < data->nworkers; i++){
+        q = &data->workers[i]->misses;
+        /* The misses queued from now on notify again */
+        __atomic_exchange_n(&q->notified, FALSE, __ATOMIC_SEQ_CST);
+        while (tun_worker_pop_miss(data->workers[i], &tpl) == GOOD){
+            /* The flow could have been installed by the miss of another
+             * worker */
+            pkt_flow_key_init(&key, &tpl);
+            hash = pkt_flow_key_hash(&key);
+            shard = tun_get_ttable_shard(data, hash);
+            if (ttable_lookup_key(&shard->ttable, &key, hash) != NULL){
+                continue;
+            }
+            tun_install_fwd_info(&tpl, &key, hash);
+        }
+        /* The flows of the drained misses are already in the table or could
+         * not be installed. In both cases the worker can queue them again */
+        __atomic_store_n(&q->gen, q->gen + 1, __ATOMIC_RELEASE);
+    }
+    /* Release the entries removed while installing the new ones, and return
+     * to the system the memory of the pools left empty */
+    if (rcu_poll() > 0){
+        mem_pools_trim();
+    }
+
+    return (GOOD);
+}
+
+int
+tun_workers_init(tun_dplane_data_t *data, oor_dev_type_e dev_type,
+        int data_port)
+{
+    tun_worker_t *worker;
+    tun_io_t *gso_io;
+    int i;
+
+    if (data->nworkers == 0){
+        return (GOOD);
+    }
+
+    miss_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (miss_event_fd == -1){
+        OOR_LOG(LERR, "tun_workers_init: Couldn't create eventfd: %s",
+                strerror(errno));
+        return (BAD);
+    }
+    sockmstr_register_read_listener_prio(smaster, tun_workers_process_misses,
+            NULL, miss_event_fd, SOCK_PRIO_NORMAL);
+
+    data->workers = xzalloc(data->nworkers * sizeof(tun_worker_t *));
+    for (i = 0; i < data->nworkers; i++){
+        worker = tun_worker_new(i, dev_type,
+                i < data_plane_conf.workers ? data_port : 0,
+                i < data->ntun_fds ? data->tun_fds[i] : ERR_SOCKET);
+        data->workers[i] = worker;
+        if (!worker){
+            OOR_LOG(LERR, "tun_workers_init: Couldn't initialize data plane worker %d", i);
+            return (BAD);
+        }
+        /* The workers without data sockets send with the ones of the first
+         * worker or, if there are no workers receiving data packets, with the
+         * ones of the main thread */
+        if (i >= data_plane_conf.workers){
+            gso_io = data_plane_conf.workers > 0 ? &data->workers[0]->io : &tun_main_io;
+            worker->io.gso_sock_v4 = gso_io->gso_sock_v4;
+            worker->io.gso_sock_v6 = gso_io->gso_sock_v6;
+        }
+        if (tun_worker_start(worker) != GOOD){
+            OOR_LOG(LERR, "tun_workers_init: Couldn't initialize data plane worker %d", i);
+            return (BAD);
+        }
+    }
+    /* The main thread, that still reads the tun with a single queue, sends
+     * with the sockets of the first worker */
+    if (data_plane_conf.workers > 0){
+        tun_main_io.gso_sock_v4 = data->workers[0]->io.gso_sock_v4;
+        tun_main_io.gso_sock_v6 = data->workers[0]->io.gso_sock_v6;
+    }
+    OOR_LOG(LDBG_1, "tun_workers_init: %d data plane workers started", data->nworkers);
+
+    return (GOOD);
+}
+
+void
+tun_workers_uninit(tun_dplane_data_t *data)
+{
+    int i;
+
+    if (!data->workers){
+        return;
+    }
+    for (i = 0; i < data->nworkers; i++){
+        if (data->workers[i]){
+            tun_worker_stop(data->workers[i]);
+            tun_worker_free(data->workers[i]);
+        }
+    }
+    free(data->workers);
+    data->workers = NULL;
+}
+
+/*
+ * Editor modelines
+ *
+ * vi: set shiftwidth=4 tabstop=4 expandtab:
+ * :indentSize=4:tabSize=4:noTabs=true:
+ */
@@ -0,0 +1,74 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef TUN_WORKER_H_
+#define TUN_WORKER_H_
+
+#include <pthread.h>
+#include "tun.h"
+#include "../../lib/rcu.h"
+
+/* Number of misses that can be pending to be processed by the main thread.
+ * It should be a power of 2 */
+#define TUN_WORKER_MISS_QUEUE_SIZE  256
+/* Number of recent misses remembered by a worker to not queue again the
+ * tuplas of a flow still pending in the main thread. It should be a power of 2 */
+#define TUN_WORKER_MISS_FILTER_SIZE 64
+/* Time (ms) a worker waits for packets before checking if it should stop */
+#define TUN_WORKER_POLL_TIMEOUT     200
+
+/* Lock free queue of tuplas without forwarding entry. Only the worker adds
+ * tuplas and only the main thread removes them */
+typedef struct tun_miss_queue_ {
+    packet_tuple_t tuples[TUN_WORKER_MISS_QUEUE_SIZE];
+    uint32_t head;
+    uint32_t tail;
+    /* Set by the worker when it notifies the main thread and cleared by the
+     * main thread before draining the queue */
+    uint8_t notified;
+    /* Incremented by the main thread each time it drains the queue */
+    uint32_t gen;
+    /* Hashes of the tuplas queued by the worker, indexed by their low bits,
+     * and the gen when they were queued. Only used by the worker */
+    uint32_t filter_hash[TUN_WORKER_MISS_FILTER_SIZE];
+    uint32_t filter_gen[TUN_WORKER_MISS_FILTER_SIZE];
+} tun_miss_queue_t;
+
+struct tun_worker_ {
+    int id;
+    pthread_t thread;
+    int running;
+    oor_dev_type_e dev_type;
+    /* Input data sockets of the worker */
+    int fd_v4;
+    int fd_v6;
+    /* Queue of the tun read by the worker. It is not owned by the worker */
+    int tun_fd;
+    tun_io_t io;
+    tun_miss_queue_t misses;
+    /* Quiescent states of the worker. It is offline while waiting for packets */
+    rcu_thread_t rcu;
+};
+
+int tun_workers_init(tun_dplane_data_t *data, oor_dev_type_e dev_type,
+        int data_port);
+void tun_workers_uninit(tun_dplane_data_t *data);
+int tun_worker_push_miss(tun_worker_t *worker, packet_tuple_t *tpl, uint32_t hash);
+
+#endif /* TUN_WORKER_H_ */
@@ -85,7 +85,8 @@ vpnapi_init(oor_dev_type_e dev_type, oor_encap_t encap_type,...)
     tun_fd = va_arg(ap, int);
     va_end(ap);
 
-    sockmstr_register_read_listener(smaster, vpnapi_output_recv, NULL,tun_fd);
+    sockmstr_register_read_listener_prio(smaster, vpnapi_output_recv, NULL,tun_fd,
+            SOCK_PRIO_LOW);
 
     switch (dev_type){
     case MN_MODE:
@@ -110,7 +111,8 @@ vpnapi_init(oor_dev_type_e dev_type, oor_encap_t encap_type,...)
 
     if (default_rloc_afi != AF_INET6){
         ipv4_data_socket = open_data_datagram_input_socket(AF_INET, data_port);
-        sockmstr_register_read_listener(smaster, cb_func, NULL,ipv4_data_socket);
+        sockmstr_register_read_listener_prio(smaster, cb_func, NULL,ipv4_data_socket,
+                SOCK_PRIO_LOW);
         oor_jni_protect_socket(ipv4_data_socket);
     }else {
         ipv4_data_socket = ERR_SOCKET;
@@ -118,7 +120,8 @@ vpnapi_init(oor_dev_type_e dev_type, oor_encap_t encap_type,...)
 
     if (default_rloc_afi != AF_INET){
         ipv6_data_socket = open_data_datagram_input_socket(AF_INET6, data_port);
-        sockmstr_register_read_listener(smaster, cb_func, NULL,ipv6_data_socket);
+        sockmstr_register_read_listener_prio(smaster, cb_func, NULL,ipv6_data_socket,
+                SOCK_PRIO_LOW);
         oor_jni_protect_socket(ipv6_data_socket);
     }else {
         ipv6_data_socket = ERR_SOCKET;
@@ -333,7 +336,8 @@ vpnapi_reset_socket(int fd, int afi)
     default:
         return (BAD);
     }
-    sockmstr_register_read_listener(smaster,old_sock->recv_cb,old_sock->arg,new_fd);
+    sockmstr_register_read_listener_prio(smaster,old_sock->recv_cb,old_sock->arg,new_fd,
+            old_sock->prio);
     sockmstr_unregister_read_listenedr(smaster,old_sock);
     /* Protect the socket from loops in the system*/
     oor_jni_protect_socket(new_fd);
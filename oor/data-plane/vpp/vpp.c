@@ -108,7 +108,8 @@ vpp_init_data_plane(oor_dev_type_e dev_type, oor_encap_t encap_type, ...)
     }
     OOR_LOG(LDBG_2,"VPP: Enabled oor packet miss plugin.");
 
-    sockmstr_register_read_listener(smaster, vpp_output_recv, NULL,vpp_data_fd);
+    sockmstr_register_read_listener_prio(smaster, vpp_output_recv, NULL,vpp_data_fd,
+            SOCK_PRIO_LOW);
 
     dplane_vpp.datap_data = vpp_dplane_data_new();
 
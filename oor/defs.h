@@ -56,6 +56,7 @@ typedef struct htable_nonces_ htable_nonces_t;
 /* Protocols constants related with timeouts */
 #define OOR_INITIAL_MRQ_TIMEOUT       2  // Initial expiration timer for the first MRq
 #define OOR_INITIAL_SMR_TIMEOUT       3  // Initial expiration timer for the first MRq SMR
+#define MAP_CACHE_REFRESH_PERCENT     90 // Part of the TTL (%) after which the map cache entries used are refreshed
 #define OOR_INITIAL_MREG_TIMEOUT      3  // Initial expiration timer for the first Encapsulated Map Register
 #define OOR_INITIAL_INF_REQ_TIMEOUT   3  // Initial expiration timer for the first info request
 #define OOR_INF_REQ_HANDOVER_TIMEOUT  2  // Time before sending an info request after a handover
@@ -71,6 +72,15 @@ typedef struct htable_nonces_ htable_nonces_t;
 
 
 #define DEFAULT_MAP_REQUEST_RETRIES             3
+#define DEFAULT_MAP_REQUEST_BATCH_WINDOW        0   /* Time in ms to wait for other misses before sending a Map-Request. 0: No batching */
+#define MAP_REQUEST_BATCH_MAX_WINDOW            1000
+#define MAP_REQUEST_BATCH_MAX_RECORDS           32  /* Maximum number of EID records of a batched Map-Request */
+#define DEFAULT_MAP_REQUEST_RATE                0   /* Map-Requests per second generated by cache misses. 0: No limit */
+#define DEFAULT_MAP_REQUEST_BURST               10
+#define MAP_REQUEST_SUPPRESSED_TIMEOUT          1   /* Time in sec a miss not requested by the rate limits is not processed again */
+#define DEFAULT_MAP_CACHE_MAX_ENTRIES           0   /* Maximum number of dynamic map cache entries. 0: No limit */
+#define DEFAULT_MAP_CACHE_MAX_MEMORY            0   /* Maximum memory in KB of the dynamic map cache entries. 0: No limit */
+#define MAP_REQUEST_LIMITS_MAX_BUCKETS          1024 /* Maximum number of source EID (or Map Resolver) buckets of the Map-Request limits */
 
 #define MAP_REGISTER_INTERVAL                   60
 #define MS_SITE_EXPIRATION                      180
@@ -78,9 +88,11 @@ typedef struct htable_nonces_ htable_nonces_t;
 #define RLOC_PROBING_INTERVAL                   30
 #define DEFAULT_RLOC_PROBING_RETRIES            2
 #define DEFAULT_RLOC_PROBING_RETRIES_INTERVAL   5   /* Interval in seconds between RLOC probing retries  */
+#define DEFAULT_RLOC_PROBING_MIN_INTERVAL       0   /* Minimum interval in ms between RLOC probes. 0: fixed interval */
+#define RLOC_PROBING_MIN_RETRIES_INTERVAL       50  /* Minimum interval in ms between RLOC probing retries estimated from the RTT */
 
 #define DEFAULT_DATA_CACHE_TTL                  10
-#define DEFAULT_SELECT_TIMEOUT                  1000/* ms */
+#define DEFAULT_EPOLL_TIMEOUT                   1   /* ms */
 
 #define FIELD_AFI_LEN                    2
 #define FIELD_PORT_LEN                   2
@@ -26,7 +26,9 @@
 
 static void balancing_locators_vecs_reset(balancing_locators_vecs *blv);
 static int select_best_priority_locators(glist_t *loct_list, locator_t **selected_locators,
-        uint8_t is_mce);
+        uint8_t is_mce, uint8_t *lossy);
+static int select_best_priority_locators_loss(glist_t *loct_list,
+        locator_t **selected_locators, uint8_t is_mce, uint8_t skip_lossy);
 static locator_t **set_balancing_vector(locator_t **locators, int total_weight, int hcf,
         int *locators_vec_length);
 static inline void get_hcf_locators_weight(locator_t **locators, int *total_weight,int *hcf);
@@ -135,6 +137,7 @@ balancing_vectors_calculate(balancing_locators_vecs *blv, mapping_t * map, glist
     glist_t *ipv6_loct_list  = glist_new();
 
     int min_priority[2] = { 255, 255 };
+    uint8_t lossy[2]    = { FALSE, FALSE };
     int total_weight[3] = { 0, 0, 0 };
     int hcf[3]          = { 0, 0, 0 };
     int ctr             = 0;
@@ -154,7 +157,7 @@ balancing_vectors_calculate(balancing_locators_vecs *blv, mapping_t * map, glist
     if (glist_size(ipv4_loct_list) != 0)
     {
         min_priority[0] = select_best_priority_locators(
-                ipv4_loct_list, locators[0], is_mce);
+                ipv4_loct_list, locators[0], is_mce, &lossy[0]);
         if (min_priority[0] != UNUSED_RLOC_PRIORITY) {
             get_hcf_locators_weight(locators[0], &total_weight[0], &hcf[0]);
             blv->v4_balancing_locators_vec = set_balancing_vector(
@@ -168,7 +171,7 @@ balancing_vectors_calculate(balancing_locators_vecs *blv, mapping_t * map, glist
     if (glist_size(ipv6_loct_list) != 0)
     {
         min_priority[1] = select_best_priority_locators(
-                ipv6_loct_list, locators[1], is_mce);
+                ipv6_loct_list, locators[1], is_mce, &lossy[1]);
         if (min_priority[1] != UNUSED_RLOC_PRIORITY) {
             get_hcf_locators_weight(locators[1], &total_weight[1], &hcf[1]);
             blv->v6_balancing_locators_vec = set_balancing_vector(
@@ -180,8 +183,14 @@ balancing_vectors_calculate(balancing_locators_vecs *blv, mapping_t * map, glist
      * to their priority and weight*/
     if (blv->v4_balancing_locators_vec != NULL
             && blv->v6_balancing_locators_vec != NULL) {
-        //Only IPv4 locators are involved (due to priority reasons)
-        if (min_priority[0] < min_priority[1]) {
+        //Only the locators of the family not losing probes are involved
+        if (lossy[0] != lossy[1]) {
+            blv->balancing_locators_vec = lossy[0] ?
+                    blv->v6_balancing_locators_vec : blv->v4_balancing_locators_vec;
+            blv->locators_vec_length = lossy[0] ?
+                    blv->v6_locators_vec_length : blv->v4_locators_vec_length;
+        } //Only IPv4 locators are involved (due to priority reasons)
+        else if (min_priority[0] < min_priority[1]) {
             blv->balancing_locators_vec =
                     blv->v4_balancing_locators_vec;
             blv->locators_vec_length =
@@ -248,8 +257,33 @@ balancing_locators_vecs_reset(balancing_locators_vecs *blv)
 }
 
 
+/* Select the locators with the best priority. The remote locators losing
+ * RLOC probes are only used when all the other ones are down. lossy is set
+ * when the selected locators are losing probes */
 static int
-select_best_priority_locators(glist_t *loct_list, locator_t **selected_locators, uint8_t is_mce)
+select_best_priority_locators(glist_t *loct_list, locator_t **selected_locators,
+        uint8_t is_mce, uint8_t *lossy)
+{
+    int min_priority;
+
+    *lossy = FALSE;
+    if (is_mce){
+        min_priority = select_best_priority_locators_loss(loct_list,
+                selected_locators, is_mce, TRUE);
+        if (min_priority != UNUSED_RLOC_PRIORITY){
+            return (min_priority);
+        }
+    }
+    min_priority = select_best_priority_locators_loss(loct_list,
+            selected_locators, is_mce, FALSE);
+    *lossy = is_mce && min_priority != UNUSED_RLOC_PRIORITY;
+
+    return (min_priority);
+}
+
+static int
+select_best_priority_locators_loss(glist_t *loct_list, locator_t **selected_locators,
+        uint8_t is_mce, uint8_t skip_lossy)
 {
     glist_entry_t *it_loct;
     locator_t *locator;
@@ -271,6 +305,12 @@ select_best_priority_locators(glist_t *loct_list, locator_t **selected_locators,
         if (!is_mce && locator_L_bit(locator) == 0){
             continue;
         }
+        if (skip_lossy && locator_is_lossy(locator)){
+            OOR_LOG(LDBG_2, "Avoiding locator %s: %d%% of the probes lost (RTT: %u us)",
+                    lisp_addr_to_char(locator_addr(locator)), locator_loss(locator),
+                    locator_rtt(locator));
+            continue;
+        }
         /* If priority of the locator equal to min_priority, then add the
          * locator to the list */
         if (locator_priority(locator) == min_priority) {
@@ -19,17 +19,28 @@
 
 #include "fwd_entry_tuple.h"
 
+/* An entry is created and released for each flow of the data plane */
+static mem_pool_t fwd_entry_tuple_pool = MEM_POOL_INITIALIZER("fwd_entry_tuple",
+        sizeof(fwd_entry_tuple_t));
+
 inline fwd_entry_tuple_t *
 fwd_entry_tuple_new_init(packet_tuple_t *tuple, lisp_addr_t *srloc,
         lisp_addr_t *drloc, uint32_t iid, int *out_socket)
 {
-    fwd_entry_tuple_t *fw_entry = xzalloc(sizeof(fwd_entry_tuple_t));
+    fwd_entry_tuple_t *fw_entry = mem_pool_alloc(&fwd_entry_tuple_pool);
     if (!fw_entry){
         return (NULL);
     }
     fw_entry->tuple = pkt_tuple_clone(tuple);
-    fw_entry->srloc = lisp_addr_clone(srloc);
-    fw_entry->drloc = lisp_addr_clone(drloc);
+    /* The RLOCs are copied into the entry to not allocate them */
+    if (srloc){
+        lisp_addr_copy(&fw_entry->srloc_addr, srloc);
+        fw_entry->srloc = &fw_entry->srloc_addr;
+    }
+    if (drloc){
+        lisp_addr_copy(&fw_entry->drloc_addr, drloc);
+        fw_entry->drloc = &fw_entry->drloc_addr;
+    }
     fw_entry->iid = iid;
     fw_entry->out_sock = out_socket;
     return (fw_entry);
@@ -42,8 +53,12 @@ fwd_entry_tuple_del(fwd_entry_tuple_t *fwd_entry)
         return;
     }
     pkt_tuple_del(fwd_entry->tuple);
-    lisp_addr_del(fwd_entry->srloc);
-    lisp_addr_del(fwd_entry->drloc);
-    free(fwd_entry);
+    if (fwd_entry->srloc){
+        lisp_addr_dealloc(fwd_entry->srloc);
+    }
+    if (fwd_entry->drloc){
+        lisp_addr_dealloc(fwd_entry->drloc);
+    }
+    mem_pool_free(&fwd_entry_tuple_pool, fwd_entry);
     fwd_entry = NULL;
 }
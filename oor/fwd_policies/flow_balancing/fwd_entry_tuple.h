@@ -20,17 +20,39 @@
 #ifndef OOR_FWD_POLICIES_FLOW_BALANCING_FWD_ENTRY_TUPLE_H_
 #define OOR_FWD_POLICIES_FLOW_BALANCING_FWD_ENTRY_TUPLE_H_
 
+#include "../../elibs/ovs/list.h"
 #include "../../lib/packets.h"
 #include "../../liblisp/lisp_address.h"
 
+typedef struct fwd_entry_tuple_ fwd_entry_tuple_t;
 
-typedef struct fwd_entry_tuple_ {
+/* Link of a flow in a list of flows of the data plane. owner is the list
+ * containing the flow, NULL if it is not linked */
+typedef struct fwd_entry_link_ {
+    struct ovs_list node;
+    void *owner;
+    fwd_entry_tuple_t *entry;
+} fwd_entry_link_t;
+
+struct fwd_entry_tuple_ {
     packet_tuple_t *tuple; // Must be the first element
+    /* Point to srloc_addr and drloc_addr. NULL if there is no RLOC */
     lisp_addr_t *srloc;
     lisp_addr_t *drloc;
+    lisp_addr_t srloc_addr;
+    lisp_addr_t drloc_addr;
     int *out_sock;
     uint32_t iid;
-} fwd_entry_tuple_t;
+    /* Outer headers of the encapsulated packets and their UDP source port.
+     * Filled by the data plane */
+    pkt_encap_tmpl_t encap_tmpl;
+    uint16_t encap_sport;
+    /* Links in the lists of flows of the destination EID, of the source EID
+     * and of the PeTRs. Filled by the data plane */
+    fwd_entry_link_t eid_link;
+    fwd_entry_link_t src_eid_link;
+    fwd_entry_link_t petrs_link;
+};
 
 fwd_entry_tuple_t *fwd_entry_tuple_new_init(packet_tuple_t *tuple, lisp_addr_t *srloc,
         lisp_addr_t *drloc, uint32_t iid, int *out_socket);
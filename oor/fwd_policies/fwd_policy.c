@@ -93,10 +93,14 @@ policy_loct_parm_del(fwd_policy_loct_parm *pol_loct)
 }
 
 
+/* Forwarding information is created and released for each flow of the data
+ * plane */
+static mem_pool_t fwd_info_pool = MEM_POOL_INITIALIZER("fwd_info", sizeof(fwd_info_t));
+
 fwd_info_t *
 fwd_info_new()
 {
-    fwd_info_t * fi = xzalloc(sizeof(fwd_info_t));
+    fwd_info_t * fi = mem_pool_alloc(&fwd_info_pool);
     return (fi);
 }
 
@@ -109,5 +113,8 @@ fwd_info_del(fwd_info_t * fwd_info)
     if(fwd_info->associated_entry){
        lisp_addr_del(fwd_info->associated_entry);
     }
-    free(fwd_info);
+    if(fwd_info->associated_local_entry){
+       lisp_addr_del(fwd_info->associated_local_entry);
+    }
+    mem_pool_free(&fwd_info_pool, fwd_info);
 }
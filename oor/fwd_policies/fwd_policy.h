@@ -58,6 +58,9 @@ typedef struct fwd_policy_loct_parm_t{
 
 typedef struct fwd_info_{
     lisp_addr_t *associated_entry;
+    /* EID prefix of the local mapping of the source. Used to find the entries
+     * to be removed when the locators of the local mapping change */
+    lisp_addr_t *associated_local_entry;
     void *dp_conf_inf;
     lisp_action_e neg_map_reply_act;
     oor_encap_t encap;
@@ -47,6 +47,41 @@ ip_checksum(uint16_t *buffer, int size)
     return ((uint16_t) (~cksum));
 }
 
+/* Add to sum the 16 bits words of buffer without folding the carries. Used to
+ * precompute the checksum of the fields that don't change between packets */
+uint32_t
+cksum_partial(const void *buffer, int size, uint32_t sum)
+{
+    const uint16_t *buf = buffer;
+    uint16_t last = 0;
+
+    while (size > 1) {
+        sum += *buf++;
+        if (sum & 0x80000000){
+            sum = (sum & 0xFFFF) + (sum >> 16);
+        }
+        size -= sizeof(uint16_t);
+    }
+
+    if (size) {
+        *(uint8_t *)&last = *(uint8_t *)buf;
+        sum += last;
+    }
+
+    return (sum);
+}
+
+/* Fold the carries of a partial sum and return its one's complement */
+uint16_t
+cksum_fold(uint32_t sum)
+{
+    while (sum >> 16){
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+
+    return ((uint16_t) (~sum));
+}
+
 /*
  *
  *  Calculate the IPv4 UDP checksum (calculated with the whole packet).
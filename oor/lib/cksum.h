@@ -25,6 +25,8 @@
 #include "../defs.h"
 
 uint16_t ip_checksum(uint16_t *buffer, int size);
+uint32_t cksum_partial(const void *buffer, int size, uint32_t sum);
+uint16_t cksum_fold(uint32_t sum);
 
 /* Calculate the IPv4 or IPv6 UDP checksum */
 uint16_t udp_checksum(struct udphdr *udph, int udp_len, void *iphdr, int afi);
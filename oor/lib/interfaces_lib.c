@@ -30,28 +30,18 @@
 
 
 
-int
-create_tun_tap(iface_type_t type, const char *iface_name, int mtu)
+static int tun_tap_open_queue(const char *iface_name, int flags);
+static int tun_tap_conf_iface(const char *iface_name, int mtu);
+
+/* Open a file descriptor attached to the tun/tap interface. The interface is
+ * created if it doesn't exist */
+static int
+tun_tap_open_queue(const char *iface_name, int flags)
 {
     struct ifreq ifr;
-    int err = 0;
-    int tmpsocket = 0;
-    int flags = IFF_TAP | IFF_NO_PI; // Create a tunnel without persistence
     char *clonedev = CLONEDEV;
     int receive_fd;
 
-    switch (type){
-    case TUN:
-        flags = flags | IFF_TUN;
-        break;
-    case TAP:
-        flags = flags | IFF_TAP;
-        break;
-    default:
-        OOR_LOG(LCRIT, "create_tun_tap: Unknown interface type");
-        return (BAD);
-    }
-
     /* Arguments taken by the function:
      *
      * char *dev: the name of an interface (or '\0'). MUST have enough
@@ -71,7 +61,7 @@ create_tun_tap(iface_type_t type, const char *iface_name, int mtu)
     strncpy(ifr.ifr_name, iface_name, IFNAMSIZ - 1);
 
     // try to create the device
-    if ((err = ioctl(receive_fd, TUNSETIFF, (void *) &ifr)) < 0) {
+    if (ioctl(receive_fd, TUNSETIFF, (void *) &ifr) < 0) {
         close(receive_fd);
         OOR_LOG(LCRIT, "TUN/TAP: Failed to create tunnel interface: %s.", strerror(errno));
         if (errno == 16){
@@ -80,10 +70,26 @@ create_tun_tap(iface_type_t type, const char *iface_name, int mtu)
         return(BAD);
     }
 
+    /* this is the special file descriptor that the caller will use to talk
+     * with the virtual interface */
+    OOR_LOG(LDBG_2, "Tunnel fd at creation is %d", receive_fd);
+
+    return (receive_fd);
+}
+
+/* Set the MTU of the tun/tap interface and bring it up */
+static int
+tun_tap_conf_iface(const char *iface_name, int mtu)
+{
+    struct ifreq ifr;
+    int tmpsocket = 0;
+
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, iface_name, IFNAMSIZ - 1);
+
     // get the ifindex for the tun/tap
     tmpsocket = socket(AF_INET, SOCK_DGRAM, 0); // Dummy socket for the ioctl, type/details unimportant
-    if ((err = ioctl(tmpsocket, SIOCGIFINDEX, (void *)&ifr)) < 0) {
-        close(receive_fd);
+    if (ioctl(tmpsocket, SIOCGIFINDEX, (void *)&ifr) < 0) {
         close(tmpsocket);
         OOR_LOG(LCRIT, "TUN/TAP: unable to determine ifindex for tunnel interface, errno: %d.", errno);
         return(BAD);
@@ -92,7 +98,7 @@ create_tun_tap(iface_type_t type, const char *iface_name, int mtu)
 
         // Set the MTU to the configured MTU
         ifr.ifr_ifru.ifru_mtu = mtu;
-        if ((err = ioctl(tmpsocket, SIOCSIFMTU, &ifr)) < 0) {
+        if (ioctl(tmpsocket, SIOCSIFMTU, &ifr) < 0) {
             close(tmpsocket);
             OOR_LOG(LCRIT, "TUN/TAP: unable to set interface MTU to %d, errno: %d.", mtu, errno);
             return(BAD);
@@ -101,20 +107,98 @@ create_tun_tap(iface_type_t type, const char *iface_name, int mtu)
         }
     }
 
-
     close(tmpsocket);
 
-    /* this is the special file descriptor that the caller will use to talk
-     * with the virtual interface */
-    OOR_LOG(LDBG_2, "Tunnel fd at creation is %d", receive_fd);
+    return (bring_up_iface(iface_name));
+}
+
+int
+create_tun_tap(iface_type_t type, const char *iface_name, int mtu)
+{
+    int flags = IFF_TAP | IFF_NO_PI; // Create a tunnel without persistence
+    int receive_fd;
 
-    if (bring_up_iface(iface_name) != GOOD){
+    switch (type){
+    case TUN:
+        flags = flags | IFF_TUN;
+        break;
+    case TAP:
+        flags = flags | IFF_TAP;
+        break;
+    default:
+        OOR_LOG(LCRIT, "create_tun_tap: Unknown interface type");
+        return (BAD);
+    }
+
+    receive_fd = tun_tap_open_queue(iface_name, flags);
+    if (receive_fd == BAD){
+        return (BAD);
+    }
+
+    if (tun_tap_conf_iface(iface_name, mtu) != GOOD){
+        close(receive_fd);
         return (BAD);
     }
 
     return (receive_fd);
 }
 
+/* Create a tun/tap interface with several queues. A file descriptor is
+ * returned in 'fds' for each queue. The kernel distributes the packets sent
+ * through the interface between the queues according to the flow.
+ * With 'offload' each packet is preceded by a virtio-net header and the
+ * kernel can hand us TCP packets of up to 64KB pending to be segmented and
+ * packets without the transport checksum */
+int
+create_tun_tap_mq(iface_type_t type, const char *iface_name, int mtu, int *fds,
+        int nqueues, uint8_t offload)
+{
+    int flags = IFF_NO_PI | IFF_MULTI_QUEUE;
+    int i, j;
+
+    if (offload){
+        flags = flags | IFF_VNET_HDR;
+    }
+
+    switch (type){
+    case TUN:
+        flags = flags | IFF_TUN;
+        break;
+    case TAP:
+        flags = flags | IFF_TAP;
+        break;
+    default:
+        OOR_LOG(LCRIT, "create_tun_tap_mq: Unknown interface type");
+        return (BAD);
+    }
+
+    for (i = 0; i < nqueues; i++){
+        fds[i] = tun_tap_open_queue(iface_name, flags);
+        if (fds[i] == BAD){
+            for (j = 0; j < i; j++){
+                close(fds[j]);
+            }
+            return (BAD);
+        }
+    }
+
+    if (tun_tap_conf_iface(iface_name, mtu) != GOOD){
+        for (i = 0; i < nqueues; i++){
+            close(fds[i]);
+        }
+        return (BAD);
+    }
+    if (offload && ioctl(fds[0], TUNSETOFFLOAD,
+            TUN_F_CSUM | TUN_F_TSO4 | TUN_F_TSO6 | TUN_F_TSO_ECN) < 0){
+        /* Packets still have the virtio-net header but are never offloaded */
+        OOR_LOG(LWRN, "TUN/TAP: Failed to enable offloads in %s: %s",
+                iface_name, strerror(errno));
+    }
+    OOR_LOG(LDBG_1, "TUN/TAP %s created with %d queues", iface_name, nqueues);
+
+    return (GOOD);
+}
+
 /*
  * bring_up_iface()
  *
@@ -30,6 +30,8 @@ typedef enum {
 #endif
 
 int create_tun_tap(iface_type_t type, const char *iface_name, int mtu);
+int create_tun_tap_mq(iface_type_t type, const char *iface_name, int mtu, int *fds,
+        int nqueues, uint8_t offload);
 int bring_up_iface(const char *iface_name);
 int add_addr_to_iface(const char *iface_name, lisp_addr_t *addr);
 int del_addr_from_iface(const char *iface_name, lisp_addr_t *addr);
@@ -0,0 +1,428 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include "lpm.h"
+#include "mem_util.h"
+
+
+/* Bits of the internal bitmap of the prefixes, one of each length, covering
+ * each value of the LPM_STRIDE bits of a level. The prefix of l bits with
+ * value v is in the bit (1 << l) - 2 + v, so the longest one is the highest
+ * bit */
+#define LPM_COVER_LO(v_) ((1ULL << ((v_) >> 5)) | (1ULL << (2 + ((v_) >> 4))) \
+        | (1ULL << (6 + ((v_) >> 3))) | (1ULL << (14 + ((v_) >> 2))) \
+        | (1ULL << (30 + ((v_) >> 1))) | ((v_) < 2 ? 1ULL << (62 + (v_) % 2) : 0))
+#define LPM_COVER_HI(v_) ((v_) < 2 ? 0 : 1ULL << ((v_) + 62) % 64)
+#define LPM_COVER(v_) {LPM_COVER_LO(v_), LPM_COVER_HI(v_)}
+#define LPM_COVER4(v_) LPM_COVER(v_), LPM_COVER((v_) + 1), \
+        LPM_COVER((v_) + 2), LPM_COVER((v_) + 3)
+#define LPM_COVER16(v_) LPM_COVER4(v_), LPM_COVER4((v_) + 4), \
+        LPM_COVER4((v_) + 8), LPM_COVER4((v_) + 12)
+
+static const uint64_t lpm_cover[LPM_STRIDE_SLOTS][2] = {
+        LPM_COVER16(0), LPM_COVER16(16), LPM_COVER16(32), LPM_COVER16(48)
+};
+
+static void lpm_node_del(lpm_t *lpm, lpm_node_t *node);
+static void lpm_release_path(lpm_t *lpm, lpm_node_t **path, uint8_t *key,
+        int last);
+
+
+/* Number of bits set. Inlined, as the builtin is a library call when the
+ * instruction is not enabled */
+static inline int
+lpm_popcount(uint64_t x)
+{
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return ((x * 0x0101010101010101ULL) >> 56);
+}
+
+/* Bits of the key used to go through the level depth. The bits after the
+ * end of the key are 0 */
+static inline int
+lpm_key_slot(lpm_t *lpm, uint8_t *key, int depth)
+{
+    int off = depth * LPM_STRIDE;
+    uint32_t bits = key[off / 8] << 8;
+
+    if (off / 8 + 1 < lpm->max_bits / 8){
+        bits |= key[off / 8 + 1];
+    }
+    return ((bits >> (16 - LPM_STRIDE - off % 8)) & (LPM_STRIDE_SLOTS - 1));
+}
+
+/* Bit of the internal bitmap of the prefix of plen bits ending in the level
+ * of slot. plen is relative to the level, from 1 to LPM_STRIDE */
+static inline int
+lpm_prefix_bit(int slot, int plen)
+{
+    return ((1 << plen) - 2 + (slot >> (LPM_STRIDE - plen)));
+}
+
+static inline int
+lpm_internal_test(lpm_node_t *node, int bit)
+{
+    return ((node->internal[bit / 64] >> (bit % 64)) & 1);
+}
+
+static inline int
+lpm_nprefixes(lpm_node_t *node)
+{
+    return (lpm_popcount(node->internal[0])
+            + lpm_popcount(node->internal[1]));
+}
+
+/* Position in the data array of the prefix of the bit */
+static inline int
+lpm_prefix_index(lpm_node_t *node, int bit)
+{
+    if (bit < 64){
+        return (lpm_popcount(node->internal[0] & ((1ULL << bit) - 1)));
+    }
+    return (lpm_popcount(node->internal[0])
+            + lpm_popcount(node->internal[1] & ((1ULL << (bit - 64)) - 1)));
+}
+
+static inline int
+lpm_external_test(lpm_node_t *node, int slot)
+{
+    return ((node->external >> slot) & 1);
+}
+
+static inline int
+lpm_nchildren(lpm_node_t *node)
+{
+    return (lpm_popcount(node->external));
+}
+
+/* Position in the children array of the child of the slot */
+static inline int
+lpm_child_index(lpm_node_t *node, int slot)
+{
+    return (lpm_popcount(node->external & ((1ULL << slot) - 1)));
+}
+
+static void *
+lpm_array_insert(void *array, int n, int index, size_t size)
+{
+    array = xrealloc(array, (n + 1) * size);
+    memmove((char *)array + (index + 1) * size, (char *)array + index * size,
+            (n - index) * size);
+    memset((char *)array + index * size, 0, size);
+    return (array);
+}
+
+static void *
+lpm_array_remove(void *array, int n, int index, size_t size)
+{
+    if (n == 1){
+        free(array);
+        return (NULL);
+    }
+    memmove((char *)array + index * size, (char *)array + (index + 1) * size,
+            (n - index - 1) * size);
+    return (xrealloc(array, (n - 1) * size));
+}
+
+static void
+lpm_prefix_remove(lpm_t *lpm, lpm_node_t *node, int bit)
+{
+    node->data = lpm_array_remove(node->data, lpm_nprefixes(node),
+            lpm_prefix_index(node, bit), sizeof(void *));
+    node->internal[bit / 64] &= ~(1ULL << (bit % 64));
+    lpm->nprefixes--;
+}
+
+static void
+lpm_child_remove(lpm_t *lpm, lpm_node_t *node, int slot)
+{
+    int index = lpm_child_index(node, slot);
+
+    lpm_node_del(lpm, &node->children[index]);
+    node->children = lpm_array_remove(node->children, lpm_nchildren(node),
+            index, sizeof(lpm_node_t));
+    node->external &= ~(1ULL << slot);
+    lpm->nnodes--;
+}
+
+lpm_t *
+lpm_new(uint8_t max_bits)
+{
+    lpm_t *lpm;
+
+    if (max_bits == 0 || max_bits > LPM_MAX_BITS || max_bits % 8 != 0){
+        return (NULL);
+    }
+    lpm = xzalloc(sizeof(lpm_t));
+    lpm->max_bits = max_bits;
+    return (lpm);
+}
+
+void
+lpm_del(lpm_t *lpm)
+{
+    if (!lpm){
+        return;
+    }
+    if (lpm->root){
+        lpm_node_del(lpm, lpm->root);
+        free(lpm->root);
+    }
+    free(lpm);
+}
+
+/* Free the children of the node and the prefixes stored in the subtree. The
+ * node itself belongs to the array of its parent */
+static void
+lpm_node_del(lpm_t *lpm, lpm_node_t *node)
+{
+    int i, nchildren = lpm_nchildren(node);
+
+    for (i = 0; i < nchildren; i++){
+        lpm_node_del(lpm, &node->children[i]);
+    }
+    lpm->nprefixes -= lpm_nprefixes(node);
+    lpm->nnodes -= nchildren;
+    free(node->children);
+    free(node->data);
+    memset(node, 0, sizeof(lpm_node_t));
+}
+
+/* Release the nodes of the path to the key, from the level last to the root,
+ * that have neither prefixes nor children */
+static void
+lpm_release_path(lpm_t *lpm, lpm_node_t **path, uint8_t *key, int last)
+{
+    lpm_node_t *parent;
+    int depth, slot;
+
+    for (depth = last; depth >= 0; depth--){
+        if (lpm_nprefixes(path[depth]) > 0 || path[depth]->external != 0){
+            break;
+        }
+        lpm->nnodes--;
+        if (depth == 0){
+            free(lpm->root);
+            lpm->root = NULL;
+            break;
+        }
+        parent = path[depth - 1];
+        slot = lpm_key_slot(lpm, key, depth - 1);
+        parent->children = lpm_array_remove(parent->children,
+                lpm_nchildren(parent), lpm_child_index(parent, slot),
+                sizeof(lpm_node_t));
+        parent->external &= ~(1ULL << slot);
+    }
+}
+
+/* Go down the path to the node of the level depth. The nodes are stored in
+ * path. Returns NULL if the node doesn't exist */
+static lpm_node_t *
+lpm_find_node(lpm_t *lpm, uint8_t *key, int depth, lpm_node_t **path)
+{
+    lpm_node_t *node = lpm->root;
+    int i, slot;
+
+    for (i = 0; node && i < depth; i++){
+        path[i] = node;
+        slot = lpm_key_slot(lpm, key, i);
+        if (!lpm_external_test(node, slot)){
+            return (NULL);
+        }
+        node = &node->children[lpm_child_index(node, slot)];
+    }
+    if (node){
+        path[depth] = node;
+    }
+    return (node);
+}
+
+/* Add the prefix of plen bits of the key. The data of an existing prefix is
+ * replaced */
+int
+lpm_insert(lpm_t *lpm, uint8_t *key, uint8_t plen, void *data)
+{
+    lpm_node_t *node;
+    int depth, last, slot, bit, index;
+
+    if (plen > lpm->max_bits){
+        return (BAD);
+    }
+    if (plen == 0){
+        if (!lpm->has_default){
+            lpm->nprefixes++;
+        }
+        lpm->default_data = data;
+        lpm->has_default = TRUE;
+        return (GOOD);
+    }
+
+    if (!lpm->root){
+        lpm->root = xzalloc(sizeof(lpm_node_t));
+        lpm->nnodes++;
+    }
+    node = lpm->root;
+    last = (plen - 1) / LPM_STRIDE;
+    for (depth = 0; depth < last; depth++){
+        slot = lpm_key_slot(lpm, key, depth);
+        index = lpm_child_index(node, slot);
+        if (!lpm_external_test(node, slot)){
+            node->children = lpm_array_insert(node->children,
+                    lpm_nchildren(node), index, sizeof(lpm_node_t));
+            node->external |= 1ULL << slot;
+            lpm->nnodes++;
+        }
+        node = &node->children[index];
+    }
+
+    bit = lpm_prefix_bit(lpm_key_slot(lpm, key, last), plen - LPM_STRIDE * last);
+    index = lpm_prefix_index(node, bit);
+    if (!lpm_internal_test(node, bit)){
+        node->data = lpm_array_insert(node->data, lpm_nprefixes(node), index,
+                sizeof(void *));
+        node->internal[bit / 64] |= 1ULL << (bit % 64);
+        lpm->nprefixes++;
+    }
+    node->data[index] = data;
+
+    return (GOOD);
+}
+
+/* Remove the prefix of plen bits of the key */
+int
+lpm_remove(lpm_t *lpm, uint8_t *key, uint8_t plen)
+{
+    lpm_node_t *path[LPM_MAX_DEPTH];
+    lpm_node_t *node;
+    int last, bit;
+
+    if (plen > lpm->max_bits){
+        return (BAD);
+    }
+    if (plen == 0){
+        if (!lpm->has_default){
+            return (BAD);
+        }
+        lpm->default_data = NULL;
+        lpm->has_default = FALSE;
+        lpm->nprefixes--;
+        return (GOOD);
+    }
+
+    last = (plen - 1) / LPM_STRIDE;
+    node = lpm_find_node(lpm, key, last, path);
+    if (!node){
+        return (BAD);
+    }
+    bit = lpm_prefix_bit(lpm_key_slot(lpm, key, last), plen - LPM_STRIDE * last);
+    if (!lpm_internal_test(node, bit)){
+        return (BAD);
+    }
+    lpm_prefix_remove(lpm, node, bit);
+    lpm_release_path(lpm, path, key, last);
+
+    return (GOOD);
+}
+
+/* Remove the prefix of plen bits of the key, if it exists, and all the
+ * prefixes more specific than it */
+int
+lpm_remove_subtree(lpm_t *lpm, uint8_t *key, uint8_t plen)
+{
+    lpm_node_t *path[LPM_MAX_DEPTH];
+    lpm_node_t *node;
+    int last, rel_plen, slot, first_slot, nslots, len, bit;
+
+    if (plen == 0 || plen > lpm->max_bits){
+        return (BAD);
+    }
+
+    last = (plen - 1) / LPM_STRIDE;
+    node = lpm_find_node(lpm, key, last, path);
+    if (!node){
+        return (GOOD);
+    }
+
+    /* In the node of the prefix, the more specific prefixes are the ones of
+     * its slots, and the children of these slots */
+    rel_plen = plen - LPM_STRIDE * last;
+    nslots = 1 << (LPM_STRIDE - rel_plen);
+    first_slot = lpm_key_slot(lpm, key, last) & ~(nslots - 1);
+    for (len = rel_plen; len <= LPM_STRIDE; len++){
+        for (slot = first_slot; slot < first_slot + nslots;
+                slot += 1 << (LPM_STRIDE - len)){
+            bit = lpm_prefix_bit(slot, len);
+            if (lpm_internal_test(node, bit)){
+                lpm_prefix_remove(lpm, node, bit);
+            }
+        }
+    }
+    for (slot = first_slot; slot < first_slot + nslots; slot++){
+        if (lpm_external_test(node, slot)){
+            lpm_child_remove(lpm, node, slot);
+        }
+    }
+    lpm_release_path(lpm, path, key, last);
+
+    return (GOOD);
+}
+
+/* Return the data of the longest prefix matching the key. The key should
+ * have max_bits bits. Only the data of the longest match is read */
+void *
+lpm_lookup(lpm_t *lpm, uint8_t *key)
+{
+    lpm_node_t *node = lpm->root, *match_node = NULL;
+    int depth, ndepths = (lpm->max_bits + LPM_STRIDE - 1) / LPM_STRIDE;
+    uint64_t match;
+    int slot, match_bit = 0;
+
+    for (depth = 0; node && depth < ndepths; depth++){
+        slot = lpm_key_slot(lpm, key, depth);
+        match = node->internal[1] & lpm_cover[slot][1];
+        if (match){
+            match_node = node;
+            match_bit = 127 - __builtin_clzll(match);
+        }else{
+            match = node->internal[0] & lpm_cover[slot][0];
+            if (match){
+                match_node = node;
+                match_bit = 63 - __builtin_clzll(match);
+            }
+        }
+        if (!lpm_external_test(node, slot)){
+            break;
+        }
+        node = &node->children[lpm_child_index(node, slot)];
+    }
+    if (!match_node){
+        return (lpm->default_data);
+    }
+    return (match_node->data[lpm_prefix_index(match_node, match_bit)]);
+}
+
+/*
+ * Editor modelines
+ *
+ * vi: set shiftwidth=4 tabstop=4 expandtab:
+ * :indentSize=4:tabSize=4:noTabs=true:
+ */
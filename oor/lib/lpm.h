@@ -0,0 +1,74 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#ifndef LPM_H_
+#define LPM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Bits of the key consumed by each level of the trie */
+#define LPM_STRIDE          6
+#define LPM_STRIDE_SLOTS    (1 << LPM_STRIDE)
+/* Maximum length of the keys (IID and IPv6 address) */
+#define LPM_MAX_BITS        160
+#define LPM_MAX_DEPTH       ((LPM_MAX_BITS + LPM_STRIDE - 1) / LPM_STRIDE)
+
+/* Node of the tree bitmap. It stores the prefixes ending in the LPM_STRIDE
+ * bits of the key of its level, 1 to LPM_STRIDE bits longer than the prefix
+ * of the node. The internal bitmap has a bit for each of these prefixes,
+ * ordered by length, and the external bitmap a bit for each child. The data
+ * of the prefixes and the children are packed in arrays in the order of the
+ * bitmaps */
+typedef struct lpm_node_ {
+    uint64_t internal[2];
+    uint64_t external;
+    struct lpm_node_ *children;
+    void **data;
+} lpm_node_t;
+
+/* Multibit trie to find the longest prefix matching a key with one memory
+ * access per LPM_STRIDE bits of the key. Each prefix is stored once, in the
+ * node of the level containing its last bit */
+typedef struct lpm_ {
+    uint8_t max_bits;
+    lpm_node_t *root;
+    /* Data of the prefix of length 0 */
+    void *default_data;
+    uint8_t has_default;
+    uint32_t nprefixes;
+    uint32_t nnodes;
+} lpm_t;
+
+lpm_t *lpm_new(uint8_t max_bits);
+void lpm_del(lpm_t *lpm);
+int lpm_insert(lpm_t *lpm, uint8_t *key, uint8_t plen, void *data);
+int lpm_remove(lpm_t *lpm, uint8_t *key, uint8_t plen);
+int lpm_remove_subtree(lpm_t *lpm, uint8_t *key, uint8_t plen);
+void *lpm_lookup(lpm_t *lpm, uint8_t *key);
+
+static inline size_t
+lpm_mem_size(lpm_t *lpm)
+{
+    return (sizeof(lpm_t) + lpm->nnodes * sizeof(lpm_node_t)
+            + lpm->nprefixes * sizeof(void *));
+}
+
+#endif /* LPM_H_ */
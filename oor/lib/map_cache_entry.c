@@ -34,6 +34,7 @@ mcache_entry_new()
 
     mce->active = NOT_ACTIVE;
     mce->timestamp = time(NULL);
+    mce->last_used = mce->timestamp;
 
     return(mce);
 }
@@ -55,6 +56,51 @@ mcache_entry_init_static(mcache_entry_t *mce, mapping_t *mapping)
     mce->how_learned = MCE_STATIC;
 }
 
+void
+mcache_entry_init_static_file(mcache_entry_t *mce, mapping_t *mapping)
+{
+
+    mce->active = ACTIVE;
+    mce->mapping = mapping;
+    mce->how_learned = MCE_STATIC_FILE;
+}
+
+
+/* Memory used by the entry, its mapping and its locators. The timers are not
+ * included as they vary during the life of the entry */
+size_t
+mcache_entry_mem_size(mcache_entry_t *entry)
+{
+    mapping_t *map = mcache_entry_mapping(entry);
+    size_t size = sizeof(mcache_entry_t);
+
+    if (!map){
+        return (size);
+    }
+    size += sizeof(mapping_t) + sizeof(lisp_addr_t);
+    size += mapping_locator_count(map) * (sizeof(locator_t) + sizeof(lisp_addr_t));
+    return (size);
+}
+
+/* Number of timers associated with the entry and with its locators */
+int
+mcache_entry_timers_count(mcache_entry_t *entry)
+{
+    glist_t *timers;
+    locator_t *loct;
+    int count = 0;
+
+    timers = htable_ptrs_timers_get_timers(ptrs_to_timers_ht, entry);
+    count += timers ? glist_size(timers) : 0;
+    if (!mcache_entry_mapping(entry)){
+        return (count);
+    }
+    mapping_foreach_locator(mcache_entry_mapping(entry),loct){
+        timers = htable_ptrs_timers_get_timers(ptrs_to_timers_ht, loct);
+        count += timers ? glist_size(timers) : 0;
+    }mapping_foreach_locator_end;
+    return (count);
+}
 
 void
 mcache_entry_del(mcache_entry_t *entry)
@@ -124,6 +170,8 @@ map_cache_entry_dump (mcache_entry_t *entry, int log_level)
 
     if (entry->how_learned == MCE_STATIC) {
         snprintf(str + strlen(str),sizeof(str) - strlen(str),"TYPE: Static, ");
+    } else if (entry->how_learned == MCE_STATIC_FILE) {
+        snprintf(str + strlen(str),sizeof(str) - strlen(str),"TYPE: Static file, ");
     } else {
         snprintf(str + strlen(str),sizeof(str) - strlen(str),"TYPE: Dynamic, ");
     }
@@ -21,6 +21,7 @@
 #define MAP_CACHE_ENTRY_H_
 
 #include "timers.h"
+#include "../elibs/ovs/list.h"
 #include "../liblisp/lisp_mapping.h"
 
 /*
@@ -30,7 +31,10 @@
 typedef enum mce_type {
     MCE_= 0,
     MCE_DYNAMIC,
-    MCE_STATIC
+    MCE_STATIC,
+    /* Prefix of the static map cache file. It can be evicted as it is loaded
+     * again from the file table when needed */
+    MCE_STATIC_FILE
 } mce_type_e;
 
 /*
@@ -52,6 +56,12 @@ typedef struct map_cache_entry_ {
     uint8_t active;
     uint8_t active_witin_period;
     time_t timestamp;
+    /* Last time the entry was used. Dynamic entries are ordered by it in the
+     * LRU list of the map cache */
+    time_t last_used;
+    struct ovs_list lru_node;
+    /* Memory (bytes) accounted to the entry by the map cache */
+    size_t mem_size;
 
     /* Routing info */
     void *                  routing_info;
@@ -64,15 +74,19 @@ typedef struct map_cache_entry_ {
 mcache_entry_t *mcache_entry_new();
 void mcache_entry_init(mcache_entry_t *, mapping_t *);
 void mcache_entry_init_static(mcache_entry_t *, mapping_t *);
+void mcache_entry_init_static_file(mcache_entry_t *, mapping_t *);
 
 
 void mcache_entry_del(mcache_entry_t *entry);
 void map_cache_entry_dump(mcache_entry_t *entry, int log_level);
+size_t mcache_entry_mem_size(mcache_entry_t *entry);
+int mcache_entry_timers_count(mcache_entry_t *entry);
 
 static inline mapping_t *mcache_entry_mapping(mcache_entry_t*);
 static inline void mcache_entry_set_mapping(mcache_entry_t* , mapping_t *);
 static inline uint8_t mcache_entry_active(mcache_entry_t *);
 static inline void mcache_entry_set_active(mcache_entry_t *, int);
+static inline uint8_t mcache_entry_evictable(mcache_entry_t *);
 uint8_t mcache_has_locators(mcache_entry_t *m);
 
 static inline void *mcache_entry_routing_info(mcache_entry_t *);
@@ -106,6 +120,14 @@ mcache_entry_set_active(mcache_entry_t *mce, int state)
     mce->active = state;
 }
 
+/* Entries kept in the LRU list and accounted in the limits of the map cache */
+static inline uint8_t
+mcache_entry_evictable(mcache_entry_t *mce)
+{
+    return (mce->how_learned == MCE_DYNAMIC
+            || mce->how_learned == MCE_STATIC_FILE);
+}
+
 
 static inline void *
 mcache_entry_routing_info(mcache_entry_t *m)
@@ -52,6 +52,7 @@ void mdb_for_each_entry_cb(mdb_t *mdb, void (*callback)(void *, void *),
 static int _add_iid_entry(mdb_t *db, void *entry, lcaf_addr_t *iidaddr);
 static void *_rm_iid_entry(mdb_t *db, lcaf_addr_t *iidaddr);
 static patricia_node_t *_find_iid_node(mdb_t *db, lcaf_addr_t *iidaddr, uint8_t exact);
+static void _mdb_del_lpm(mdb_t *db);
 
 
 /*
@@ -216,16 +217,74 @@ _get_grp_pt_for_mc_addr(patricia_tree_t *strie, lcaf_addr_t *mcaddr,
     return (gtrie);
 }
 
+static lpm_t *
+get_ip_lpm_from_afi(mdb_t *db, uint16_t afi)
+{
+    switch (afi) {
+    case AF_INET:
+        return (db->AF4_lpm);
+    case AF_INET6:
+        return (db->AF6_lpm);
+    default:
+        return (NULL);
+    }
+}
+
+static lpm_t *
+get_iid_lpm_from_afi(mdb_t *db, uint16_t afi)
+{
+    switch (afi) {
+    case AF_INET:
+        return (db->AF4_iid_lpm);
+    case AF_INET6:
+        return (db->AF6_iid_lpm);
+    default:
+        return (NULL);
+    }
+}
+
+/* Key of the indexes of the IID entries: the IID followed by the address */
+static void
+_iid_lpm_key(uint32_t iid, ip_addr_t *ip, uint8_t *key)
+{
+    uint32_t niid = htonl(iid);
+
+    memcpy(key, &niid, sizeof(uint32_t));
+    memcpy(key + sizeof(uint32_t), ip_addr_get_addr(ip), ip_addr_get_size(ip));
+}
+
+static void
+_rm_ippref_lpm(mdb_t *db, ip_prefix_t *ippref)
+{
+    lpm_t *lpm = get_ip_lpm_from_afi(db, ip_prefix_afi(ippref));
+
+    if (!lpm){
+        return;
+    }
+    lpm_remove(lpm, ip_addr_get_addr(ip_prefix_addr(ippref)),
+            ip_prefix_get_plen(ippref));
+}
+
 static int
 _add_ippref_entry(mdb_t *db, void *entry, ip_prefix_t *ippref)
 {
-    if (pt_add_ippref(get_ip_pt_from_afi(db, ip_prefix_afi(ippref)), ippref,
-            entry) != GOOD) {
+    patricia_node_t *node;
+    lpm_t *lpm;
+
+    node = pt_add_node(get_ip_pt_from_afi(db, ip_prefix_afi(ippref)),
+            ip_prefix_addr(ippref), ip_prefix_get_plen(ippref), entry);
+    if (!node) {
         OOR_LOG(LDBG_3, "_add_ippref_entry: Attempting to insert (%s) in the "
                 "map-cache but couldn't add the entry to the pt!",
                 ip_prefix_to_char(ippref));
         return (BAD);
     }
+    /* The data of an existing node is not changed */
+    lpm = get_ip_lpm_from_afi(db, ip_prefix_afi(ippref));
+    if (lpm && node->data == entry){
+        lpm_insert(lpm, ip_addr_get_addr(ip_prefix_addr(ippref)),
+                ip_prefix_get_plen(ippref), node->data);
+    }
 
     OOR_LOG(LDBG_3, "_add_ippref_entry: Added map cache data for %s",
             ip_prefix_to_char(ippref));
@@ -275,6 +334,9 @@ _add_iid_entry(mdb_t *db, void *entry, lcaf_addr_t *iidaddr)
     uint32_t iid;
     lisp_addr_t *ip_pref;
     patricia_tree_t *pt;
+    patricia_node_t *node;
+    uint8_t key[LPM_MAX_BITS / 8];
+    lpm_t *lpm;
     uint16_t afi;
 
     iid = lcaf_iid_get_iid(iidaddr);
@@ -291,12 +353,20 @@ _add_iid_entry(mdb_t *db, void *entry, lcaf_addr_t *iidaddr)
         pt = get_iid_pt_from_lcaf(db, iidaddr);
     }
 
-    if (pt_add_ippref(pt, lisp_addr_get_ippref(ip_pref),entry) != GOOD) {
+    node = pt_add_node(pt, lisp_addr_ip_get_addr(ip_pref),
+            lisp_addr_ip_get_plen(ip_pref), entry);
+    if (!node) {
         OOR_LOG(LDBG_3, "_add_iid_entry: Attempting to insert (%s) in the "
                 "map-cache but couldn't add the entry to the patricia tree!",
                 lcaf_addr_to_char(iidaddr));
         return (BAD);
     }
+    lpm = get_iid_lpm_from_afi(db, afi);
+    if (lpm && node->data == entry){
+        _iid_lpm_key(iid, lisp_addr_ip_get_addr(ip_pref), key);
+        lpm_insert(lpm, key, MDB_IID_KEY_BITS + lisp_addr_ip_get_plen(ip_pref),
+                entry);
+    }
 
     OOR_LOG(LDBG_3, "_add_iid_entry: Added map cache data for %s",
             lcaf_addr_to_char(iidaddr));
@@ -308,6 +378,9 @@ _rm_iid_entry(mdb_t *db, lcaf_addr_t *iidaddr)
 {
     lisp_addr_t *ip_pref;
     patricia_tree_t *pt;
+    uint8_t key[LPM_MAX_BITS / 8];
+    lpm_t *lpm;
+    void *data;
 
     pt = get_iid_pt_from_lcaf(db, iidaddr);
     if (!pt){
@@ -321,7 +394,13 @@ _rm_iid_entry(mdb_t *db, lcaf_addr_t *iidaddr)
         return (NULL);
     }
 
-    return (pt_remove_ippref(pt, lisp_addr_get_ippref(ip_pref)));
+    data = pt_remove_ippref(pt, lisp_addr_get_ippref(ip_pref));
+    lpm = get_iid_lpm_from_afi(db, lisp_addr_ip_afi(ip_pref));
+    if (data && lpm){
+        _iid_lpm_key(lcaf_iid_get_iid(iidaddr), lisp_addr_ip_get_addr(ip_pref), key);
+        lpm_remove(lpm, key, MDB_IID_KEY_BITS + lisp_addr_ip_get_plen(ip_pref));
+    }
+    return (data);
 }
 
 static patricia_node_t *
@@ -526,6 +605,7 @@ mdb_del(mdb_t *db, mdb_del_fct del_fct)
         } PATRICIA_WALK_END;
     }
     Destroy_Patricia(db->AF6_mc_db, NULL);
+    _mdb_del_lpm(db);
     free(db);
 }
 
@@ -575,12 +655,18 @@ mdb_remove_entry(mdb_t *db, lisp_addr_t *laddr)
         lisp_addr_ip_to_ippref(taddr);
         ippref = lisp_addr_get_ippref(taddr);
         ret = pt_remove_ippref(get_ip_pt_from_afi(db, ip_prefix_afi(ippref)), ippref);
+        if (ret){
+            _rm_ippref_lpm(db, ippref);
+        }
         lisp_addr_del(taddr);
         break;
     case LM_AFI_IPPREF:
         ippref = lisp_addr_get_ippref(laddr);
         ret = pt_remove_ippref(
                 get_ip_pt_from_afi(db, ip_prefix_afi(ippref)), ippref);
+        if (ret){
+            _rm_ippref_lpm(db, ippref);
+        }
         break;
     case LM_AFI_LCAF:
         ret = _del_lcaf_entry(db, lisp_addr_get_lcaf(laddr));
@@ -601,6 +687,34 @@ void *
 mdb_lookup_entry(mdb_t *db, lisp_addr_t *laddr)
 {
     patricia_node_t *node;
+    uint8_t key[LPM_MAX_BITS / 8];
+    lisp_addr_t *addr;
+    lcaf_addr_t *lcaf;
+    ip_addr_t *ip;
+    lpm_t *lpm;
+
+    /* The IP and IID lookups use the indexes when they are enabled */
+    if (lisp_addr_lafi(laddr) == LM_AFI_IP || lisp_addr_lafi(laddr) == LM_AFI_IPPREF){
+        ip = lisp_addr_ip_get_addr(laddr);
+        lpm = get_ip_lpm_from_afi(db, ip_addr_afi(ip));
+        if (lpm){
+            return (lpm_lookup(lpm, ip_addr_get_addr(ip)));
+        }
+    }else if (lisp_addr_is_iid(laddr)){
+        lcaf = lisp_addr_get_lcaf(laddr);
+        addr = lcaf_get_ip_addr(lcaf);
+        if (!addr){
+            addr = lcaf_get_ip_pref_addr(lcaf);
+        }
+        if (addr){
+            ip = lisp_addr_ip_get_addr(addr);
+            lpm = get_iid_lpm_from_afi(db, ip_addr_afi(ip));
+            if (lpm){
+                _iid_lpm_key(lcaf_iid_get_iid(lcaf), ip, key);
+                return (lpm_lookup(lpm, key));
+            }
+        }
+    }
 
     node = _find_node(db, laddr, NOT_EXACT);
     if (node){
@@ -627,6 +741,293 @@ mdb_n_entries(mdb_t *mdb) {
     return(mdb->n_entries);
 }
 
+/* Add the entries of the patricia tree pt to the index. The keys have the
+ * key_off bits of key before the address */
+static int
+_lpm_load_pt(lpm_t *lpm, patricia_tree_t *pt, uint8_t *key, uint8_t key_off)
+{
+    patricia_node_t *node;
+
+    if (!pt->head){
+        return (GOOD);
+    }
+    PATRICIA_WALK(pt->head, node) {
+        memcpy(key + key_off / 8, prefix_touchar(node->prefix), pt->maxbits / 8);
+        if (lpm_insert(lpm, key, key_off + node->prefix->bitlen,
+                node->data) != GOOD){
+            return (BAD);
+        }
+    } PATRICIA_WALK_END;
+    return (GOOD);
+}
+
+static int
+_lpm_load_iid_db(lpm_t *lpm, int_htable *ht)
+{
+    uint8_t key[LPM_MAX_BITS / 8];
+    uint32_t niid;
+    khiter_t k;
+
+    for (k = kh_begin(ht->htable); k != kh_end(ht->htable); k++){
+        if (!kh_exist(ht->htable, k)){
+            continue;
+        }
+        niid = htonl(kh_key(ht->htable, k));
+        memcpy(key, &niid, sizeof(uint32_t));
+        if (_lpm_load_pt(lpm, ((patricia_tree_t *)kh_value(ht->htable, k))->head->data,
+                key, MDB_IID_KEY_BITS) != GOOD){
+            return (BAD);
+        }
+    }
+    return (GOOD);
+}
+
+static void
+_mdb_del_lpm(mdb_t *db)
+{
+    lpm_del(db->AF4_lpm);
+    lpm_del(db->AF6_lpm);
+    lpm_del(db->AF4_iid_lpm);
+    lpm_del(db->AF6_iid_lpm);
+    db->AF4_lpm = db->AF6_lpm = NULL;
+    db->AF4_iid_lpm = db->AF6_iid_lpm = NULL;
+}
+
+/* Build the indexes used by the longest prefix match lookups of IP and IID
+ * EIDs. They are kept updated with the entries added and removed afterwards */
+int
+mdb_enable_lpm(mdb_t *db)
+{
+    uint8_t key[LPM_MAX_BITS / 8];
+
+    if (db->AF4_lpm){
+        return (GOOD);
+    }
+    db->AF4_lpm = lpm_new(sizeof(struct in_addr) * 8);
+    db->AF6_lpm = lpm_new(sizeof(struct in6_addr) * 8);
+    db->AF4_iid_lpm = lpm_new(MDB_IID_KEY_BITS + sizeof(struct in_addr) * 8);
+    db->AF6_iid_lpm = lpm_new(MDB_IID_KEY_BITS + sizeof(struct in6_addr) * 8);
+    if (_lpm_load_pt(db->AF4_lpm, get_ip_pt_from_afi(db, AF_INET), key, 0) != GOOD
+            || _lpm_load_pt(db->AF6_lpm, get_ip_pt_from_afi(db, AF_INET6), key, 0) != GOOD
+            || _lpm_load_iid_db(db->AF4_iid_lpm, db->AF4_iid_db) != GOOD
+            || _lpm_load_iid_db(db->AF6_iid_lpm, db->AF6_iid_db) != GOOD){
+        OOR_LOG(LERR, "mdb_enable_lpm: Couldn't build the index of the IP entries");
+        _mdb_del_lpm(db);
+        return (BAD);
+    }
+    return (GOOD);
+}
+
+size_t
+mdb_lpm_mem_size(mdb_t *db)
+{
+    if (!db->AF4_lpm){
+        return (0);
+    }
+    return (lpm_mem_size(db->AF4_lpm) + lpm_mem_size(db->AF6_lpm)
+            + lpm_mem_size(db->AF4_iid_lpm) + lpm_mem_size(db->AF6_iid_lpm));
+}
+
+/* Remove all the entries of the instance ID with a cost proportional to the
+ * number of entries of the IID. The callback is called with each entry
+ * removed. Return the number of entries removed */
+int
+mdb_remove_iid(mdb_t *db, uint32_t iid, void (*callback)(void *, void *),
+        void *cb_data)
+{
+    int_htable *hts[2] = {db->AF4_iid_db, db->AF6_iid_db};
+    lpm_t *lpms[2] = {db->AF4_iid_lpm, db->AF6_iid_lpm};
+    patricia_tree_t *pt, *entries;
+    patricia_node_t *node;
+    uint8_t key[LPM_MAX_BITS / 8];
+    uint32_t niid = htonl(iid);
+    int i, removed = 0;
+
+    memcpy(key, &niid, sizeof(uint32_t));
+    for (i = 0; i < 2; i++){
+        pt = int_htable_lookup(hts[i], iid);
+        if (!pt){
+            continue;
+        }
+        entries = pt->head->data;
+        if (entries->head){
+            PATRICIA_WALK(entries->head, node) {
+                if (node->data){
+                    if (callback){
+                        callback(node->data, cb_data);
+                    }
+                    removed++;
+                }
+            } PATRICIA_WALK_END;
+        }
+        if (lpms[i]){
+            lpm_remove_subtree(lpms[i], key, MDB_IID_KEY_BITS);
+        }
+        Destroy_Patricia(entries, NULL);
+        Destroy_Patricia(pt, NULL);
+        int_htable_remove(hts[i], iid);
+    }
+    db->n_entries -= removed;
+
+    OOR_LOG(LDBG_2, "mdb_remove_iid: Removed %d entries of IID %u", removed, iid);
+    return (removed);
+}
+
+/* Tables of the database in the order they are walked */
+typedef enum mdb_iter_table_ {
+    MDB_ITER_AF4_IP,
+    MDB_ITER_AF6_IP,
+    MDB_ITER_AF4_IID,
+    MDB_ITER_AF6_IID,
+    MDB_ITER_AF4_MC,
+    MDB_ITER_AF6_MC
+} mdb_iter_table_e;
+
+/* Next node of a preorder walk of the tree. It only uses the links of the
+ * nodes, so the walk can be resumed from any node */
+static patricia_node_t *
+pt_walk_next(patricia_node_t *node)
+{
+    if (node->l){
+        return (node->l);
+    }
+    if (node->r){
+        return (node->r);
+    }
+    while (node->parent){
+        if (node == node->parent->l && node->parent->r){
+            return (node->parent->r);
+        }
+        node = node->parent;
+    }
+    return (NULL);
+}
+
+/* Return the next first level tree of the tables to walk */
+static patricia_tree_t *
+_mdb_iter_next_tree(mdb_iter_t *it)
+{
+    patricia_tree_t *pt;
+    int_htable *ht;
+
+    for (; it->table <= it->last_table; it->table++, it->pos = 0){
+        switch (it->table){
+        case MDB_ITER_AF4_IID:
+        case MDB_ITER_AF6_IID:
+            ht = it->table == MDB_ITER_AF4_IID ? it->db->AF4_iid_db : it->db->AF6_iid_db;
+            for (; it->pos != kh_end(ht->htable); it->pos++){
+                if (kh_exist(ht->htable, it->pos)){
+                    return (kh_value(ht->htable, it->pos++));
+                }
+            }
+            continue;
+        case MDB_ITER_AF4_IP:
+            pt = it->db->AF4_ip_db;
+            break;
+        case MDB_ITER_AF6_IP:
+            pt = it->db->AF6_ip_db;
+            break;
+        case MDB_ITER_AF4_MC:
+            pt = it->db->AF4_mc_db;
+            break;
+        default:
+            pt = it->db->AF6_mc_db;
+            break;
+        }
+        /* The other tables have a single tree */
+        if (it->pos == 0){
+            it->pos = 1;
+            return (pt);
+        }
+    }
+    return (NULL);
+}
+
+/* Next node of the first level trees with a tree of entries */
+static patricia_node_t *
+_mdb_iter_next_outer(mdb_iter_t *it)
+{
+    patricia_node_t *node = it->outer;
+    patricia_tree_t *pt;
+
+    for (;;){
+        node = node ? pt_walk_next(node) : NULL;
+        if (!node){
+            pt = _mdb_iter_next_tree(it);
+            if (!pt){
+                return (NULL);
+            }
+            node = pt->head;
+        }
+        if (node && node->prefix && node->data){
+            return (node);
+        }
+    }
+}
+
+void
+mdb_iter_init(mdb_iter_t *it, mdb_t *db, mdb_iter_type_e type)
+{
+    memset(it, 0, sizeof(mdb_iter_t));
+    it->db = db;
+    switch (type){
+    case MDB_ITER_IP:
+        it->table = MDB_ITER_AF4_IP;
+        it->last_table = MDB_ITER_AF6_IID;
+        break;
+    case MDB_ITER_MC:
+        it->table = MDB_ITER_AF4_MC;
+        it->last_table = MDB_ITER_AF6_MC;
+        break;
+    default:
+        it->table = MDB_ITER_AF4_IP;
+        it->last_table = MDB_ITER_AF6_MC;
+        break;
+    }
+}
+
+/* Position the iterator in the first node with an entry from 'node' on,
+ * moving to the next trees of entries when needed */
+static void
+_mdb_iter_seek(mdb_iter_t *it, patricia_node_t *node)
+{
+    for (;;){
+        for (; node; node = pt_walk_next(node)){
+            if (node->prefix && node->data){
+                it->next = node;
+                return;
+            }
+        }
+        it->outer = _mdb_iter_next_outer(it);
+        if (!it->outer){
+            it->next = NULL;
+            return;
+        }
+        node = ((patricia_tree_t *)it->outer->data)->head;
+    }
+}
+
+/* Return the next entry of the walk or NULL when all the entries have been
+ * returned */
+void *
+mdb_iter_next(mdb_iter_t *it)
+{
+    patricia_node_t *node;
+
+    if (!it->next && !it->outer){
+        _mdb_iter_seek(it, NULL);
+    }
+    node = it->next;
+    if (!node){
+        return (NULL);
+    }
+    /* The next entry is found before returning this one. Removing the last
+     * entry of a multicast source releases its tree of groups and can release
+     * the node of the source, so none of them is used after it */
+    _mdb_iter_seek(it, pt_walk_next(node));
+    return (node->data);
+}
+
 /*
  * Patricia trie wrappers
  */
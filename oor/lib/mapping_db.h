@@ -27,6 +27,7 @@
 #define MAPPING_DB_H_
 
 #include "int_table.h"
+#include "lpm.h"
 #include "../elibs/patricia/patricia.h"
 #include "../liblisp/lisp_address.h"
 
@@ -34,6 +35,9 @@
 #define NOT_EXACT 0
 #define EXACT 1
 
+/* Bits of the IID before the address in the keys of the IID indexes */
+#define MDB_IID_KEY_BITS    32
+
 /*
  *  Patricia tree based databases
  *  for IP/IP-prefix and multicast addresses
@@ -45,11 +49,45 @@ typedef struct {
     int_htable *AF6_iid_db;
     patricia_tree_t *AF4_mc_db;
     patricia_tree_t *AF6_mc_db;
+    /* Optional read optimized indexes of the IP entries used by the longest
+     * prefix match lookups. NULL if not enabled */
+    lpm_t *AF4_lpm;
+    lpm_t *AF6_lpm;
+    /* Indexes of the IID entries of all the IIDs. The keys are the IID
+     * followed by the address */
+    lpm_t *AF4_iid_lpm;
+    lpm_t *AF6_iid_lpm;
     int n_entries;
 } mdb_t;
 
 typedef void (*mdb_del_fct)(void *);
 
+/* Entries visited by an iterator */
+typedef enum mdb_iter_type_ {
+    MDB_ITER_ALL,
+    MDB_ITER_IP,
+    MDB_ITER_MC
+} mdb_iter_type_e;
+
+/* Position of a walk over the entries of a database. It doesn't allocate
+ * memory, so the walk can be abandoned at any time and resumed later with
+ * the same iterator. The last entry returned can be removed from the
+ * database before getting the next one. Other modifications of the database
+ * invalidate the iterator */
+typedef struct mdb_iter_ {
+    mdb_t *db;
+    /* Current and last tables of the database to walk (mdb_iter_table_e) */
+    uint8_t table;
+    uint8_t last_table;
+    /* Position of the next IID tree in the current table */
+    khiter_t pos;
+    /* Node of the first level tree. Its data is the tree with the entries */
+    patricia_node_t *outer;
+    /* Node of the next entry to return. Nodes with entries are never
+     * released when other entries are removed */
+    patricia_node_t *next;
+} mdb_iter_t;
+
 mdb_t *mdb_new();
 void mdb_del(mdb_t *db, mdb_del_fct del_fct);
 int mdb_add_entry(mdb_t *db, lisp_addr_t *addr, void *data);
@@ -57,164 +95,64 @@ void *mdb_remove_entry(mdb_t *db, lisp_addr_t *laddr);
 void *mdb_lookup_entry(mdb_t *db, lisp_addr_t *laddr);
 void *mdb_lookup_entry_exact(mdb_t *db, lisp_addr_t *laddr);
 int mdb_n_entries(mdb_t *);
+int mdb_enable_lpm(mdb_t *db);
+size_t mdb_lpm_mem_size(mdb_t *db);
+int mdb_remove_iid(mdb_t *db, uint32_t iid, void (*callback)(void *, void *),
+        void *cb_data);
+void mdb_iter_init(mdb_iter_t *it, mdb_t *db, mdb_iter_type_e type);
+void *mdb_iter_next(mdb_iter_t *it);
 patricia_tree_t *_get_local_db_for_lcaf_addr(mdb_t *db, lcaf_addr_t *lcaf);
 patricia_tree_t *_get_local_db_for_addr(mdb_t *db, lisp_addr_t *addr);
 
 
-#define mdb_foreach_entry(_mdb, _it) \
+#define mdb_foreach_entry(_mdb, _it)                                                \
     do {                                                                            \
-        void * _pt_;                                                                 \
-        glist_entry_t *_pt_it_;                                                     \
-        patricia_tree_t *_ptree_;                                                   \
-        patricia_node_t *_node, *_nodein;                                           \
-        glist_t *_pt_list_ = glist_new();                                           \
-        glist_add((_mdb)->AF4_ip_db,_pt_list_);                                     \
-        glist_add((_mdb)->AF6_ip_db,_pt_list_);                                     \
-        int_htable_foreach_value((_mdb)->AF4_iid_db,_pt_){                          \
-            glist_add(_pt_,_pt_list_);                                              \
-        }int_htable_foreach_value_end;                                              \
-        int_htable_foreach_value((_mdb)->AF6_iid_db,_pt_){                          \
-            glist_add(_pt_,_pt_list_);                                              \
-        }int_htable_foreach_value_end;                                              \
-        glist_add((_mdb)->AF4_mc_db,_pt_list_);                                     \
-        glist_add((_mdb)->AF4_mc_db,_pt_list_);                                     \
-        glist_for_each_entry(_pt_it_, _pt_list_){                                   \
-            _ptree_ = (patricia_tree_t *)glist_entry_data(_pt_it_);                 \
-            PATRICIA_WALK(_ptree_->head, _node) {                                   \
-                PATRICIA_WALK(((patricia_tree_t *)(_node->data))->head, _nodein) {  \
-                    if ((_it = _nodein->data)){
+        mdb_iter_t _mdb_it_;                                                        \
+        mdb_iter_init(&_mdb_it_, (_mdb), MDB_ITER_ALL);                             \
+        while (((_it) = mdb_iter_next(&_mdb_it_))){
 
 #define mdb_foreach_entry_end           \
-                    }                   \
-                } PATRICIA_WALK_END;    \
-            } PATRICIA_WALK_END;        \
         }                               \
-        glist_destroy(_pt_list_);       \
     } while (0)
 
 
-#define mdb_foreach_entry_with_break(_mdb, _it, _break) \
-    do {                                                                            \
-        void * _pt_;                                                                 \
-        glist_entry_t *_pt_it_;                                                     \
-        patricia_tree_t *_ptree_;                                                   \
-        patricia_node_t *_node, *_nodein;                                           \
-        glist_t *_pt_list_ = glist_new();                                           \
-        glist_add((_mdb)->AF4_ip_db,_pt_list_);                                     \
-        glist_add((_mdb)->AF6_ip_db,_pt_list_);                                     \
-        int_htable_foreach_value((_mdb)->AF4_iid_db,_pt_){                          \
-            glist_add(_pt_,_pt_list_);                                              \
-        }int_htable_foreach_value_end;                                              \
-        int_htable_foreach_value((_mdb)->AF6_iid_db,_pt_){                          \
-            glist_add(_pt_,_pt_list_);                                              \
-        }int_htable_foreach_value_end;                                              \
-        glist_add((_mdb)->AF4_mc_db,_pt_list_);                                     \
-        glist_add((_mdb)->AF4_mc_db,_pt_list_);                                     \
-        glist_for_each_entry(_pt_it_, _pt_list_){                                   \
-            _ptree_ = (patricia_tree_t *)glist_entry_data(_pt_it_);                 \
-            PATRICIA_WALK(_ptree_->head, _node) {                                   \
-                PATRICIA_WALK(((patricia_tree_t *)(_node->data))->head, _nodein) {  \
-                    if ((_it = _nodein->data)){
+#define mdb_foreach_entry_with_break(_mdb, _it, _break)                             \
+        mdb_foreach_entry(_mdb, _it)
 
 #define mdb_foreach_entry_with_break_end(_break) \
-                        if (_break){    \
-                            break;      \
-                        }               \
-                    }                   \
-                } PATRICIA_WALK_END;    \
-                if (_break){            \
-                    break;              \
-                }                       \
-            } PATRICIA_WALK_END;        \
             if (_break){                \
                 break;                  \
             }                           \
-        }                               \
-        glist_destroy(_pt_list_);       \
-    } while (0)
+        mdb_foreach_entry_end
 
 
 #define mdb_foreach_ip_entry(_mdb, _it)                                             \
     do {                                                                            \
-        void * _pt_;                                                                \
-        glist_entry_t *_pt_it_;                                                     \
-        patricia_tree_t *_ptree_;                                                   \
-        patricia_node_t *_node, *_nodein;                                           \
-        glist_t *_pt_list_ = glist_new();                                           \
-        glist_add((_mdb)->AF4_ip_db,_pt_list_);                                     \
-        glist_add((_mdb)->AF6_ip_db,_pt_list_);                                     \
-        int_htable_foreach_value((_mdb)->AF4_iid_db,_pt_){                          \
-            glist_add(_pt_,_pt_list_);                                              \
-        }int_htable_foreach_value_end;                                              \
-        int_htable_foreach_value((_mdb)->AF6_iid_db,_pt_){                          \
-            glist_add(_pt_,_pt_list_);                                              \
-        }int_htable_foreach_value_end;                                              \
-        glist_for_each_entry(_pt_it_, _pt_list_){                                   \
-            _ptree_ = (patricia_tree_t *)glist_entry_data(_pt_it_);                 \
-            PATRICIA_WALK(_ptree_->head, _node) {                                   \
-                PATRICIA_WALK(((patricia_tree_t *)(_node->data))->head, _nodein) {  \
-                if ((_it = _nodein->data)){
+        mdb_iter_t _mdb_it_;                                                        \
+        mdb_iter_init(&_mdb_it_, (_mdb), MDB_ITER_IP);                              \
+        while (((_it) = mdb_iter_next(&_mdb_it_))){
 
 #define mdb_foreach_ip_entry_end        \
-                }                       \
-                } PATRICIA_WALK_END;    \
-            } PATRICIA_WALK_END;        \
         }                               \
-        glist_destroy(_pt_list_);       \
     } while (0)
 
 
 #define mdb_foreach_ip_entry_with_break(_mdb, _it, _break)                          \
-    do {                                                                            \
-        void * _pt_;                                                                \
-        glist_entry_t *_pt_it_;                                                     \
-        patricia_tree_t *_ptree_;                                                   \
-        patricia_node_t *_node, *_nodein;                                           \
-        glist_t *_pt_list_ = glist_new();                                           \
-        glist_add((_mdb)->AF4_ip_db,_pt_list_);                                     \
-        glist_add((_mdb)->AF6_ip_db,_pt_list_);                                     \
-        int_htable_foreach_value((_mdb)->AF4_iid_db,_pt_){                          \
-            glist_add(_pt_,_pt_list_);                                              \
-        }int_htable_foreach_value_end;                                              \
-        int_htable_foreach_value((_mdb)->AF6_iid_db,_pt_){                          \
-            glist_add(_pt_,_pt_list_);                                              \
-        }int_htable_foreach_value_end;                                              \
-        glist_for_each_entry(_pt_it_, _pt_list_){                                   \
-            _ptree_ = (patricia_tree_t *)glist_entry_data(_pt_it_);                 \
-            PATRICIA_WALK(_ptree_->head, _node) {                                   \
-                PATRICIA_WALK(((patricia_tree_t *)(_node->data))->head, _nodein) {  \
-                    if ((_it = _nodein->data)){
+        mdb_foreach_ip_entry(_mdb, _it)
 
 #define mdb_foreach_ip_entry_with_break_end(_break)        \
-                        if (_break){    \
-                            break;      \
-                        }               \
-                    }                   \
-                } PATRICIA_WALK_END;    \
-                if (_break){            \
-                    break;              \
-                }                       \
-            } PATRICIA_WALK_END;        \
             if (_break){                \
                 break;                  \
             }                           \
-        } glist_destroy(_pt_list_);     \
-    } while (0)
+        mdb_foreach_ip_entry_end
 
-#define mdb_foreach_mc_entry(_mdb, _it) \
-    do { \
-        patricia_tree_t *_ptstack[2] = {(_mdb)->AF4_mc_db, (_mdb)->AF6_mc_db};  \
-        patricia_node_t *_node, *_nodemc;                                       \
-        int _i;                                                                 \
-        for (_i=0; _i < 2; _i++) {                                              \
-            PATRICIA_WALK(_ptstack[_i]->head, _node) {                          \
-                PATRICIA_WALK(((patricia_tree_t *)(_node->data))->head, _nodemc) {      \
-                    if ((_it = _nodemc->data)){
-
-#define mdb_foreach_mc_entry_end \
-                    }                   \
-                } PATRICIA_WALK_END;    \
-            } PATRICIA_WALK_END;        \
+#define mdb_foreach_mc_entry(_mdb, _it)                                             \
+    do {                                                                            \
+        mdb_iter_t _mdb_it_;                                                        \
+        mdb_iter_init(&_mdb_it_, (_mdb), MDB_ITER_MC);                              \
+        while (((_it) = mdb_iter_next(&_mdb_it_))){
+
+#define mdb_foreach_mc_entry_end        \
         }                               \
     } while (0)
 
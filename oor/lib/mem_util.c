@@ -87,6 +87,119 @@ xstrdup(const char *s)
     return xmemdup0(s, strlen(s));
 }
 
+/* Objects are aligned to 8 bytes, enough for 64 bit fields in 32 bit
+ * architectures and to hold the link of the free list */
+#define MEM_POOL_ALIGN          8
+#define MEM_POOL_OBJ_SIZE(pool) \
+    (((pool)->obj_size + MEM_POOL_ALIGN - 1) & ~(MEM_POOL_ALIGN - 1))
+
+static mem_pool_t *mem_pools = NULL;
+
+static void
+mem_pool_add_slab(mem_pool_t *pool)
+{
+    size_t obj_size = MEM_POOL_OBJ_SIZE(pool);
+    uint8_t *slab;
+
+    slab = xmalloc(MEM_POOL_ALIGN + MEM_POOL_SLAB_OBJS * obj_size);
+    *(void **)slab = pool->slabs;
+    pool->slabs = slab;
+    pool->next_obj = slab + MEM_POOL_ALIGN;
+    pool->slab_end = pool->next_obj + MEM_POOL_SLAB_OBJS * obj_size;
+    pool->stats.slabs++;
+
+    if (!pool->registered){
+        pool->next_pool = mem_pools;
+        mem_pools = pool;
+        pool->registered = TRUE;
+    }
+}
+
+/* Return a zeroed object of the pool */
+void *
+mem_pool_alloc(mem_pool_t *pool)
+{
+    void *obj;
+
+    if (pool->free_list){
+        obj = pool->free_list;
+        pool->free_list = *(void **)obj;
+    }else{
+        if (pool->next_obj == pool->slab_end){
+            mem_pool_add_slab(pool);
+        }
+        obj = pool->next_obj;
+        pool->next_obj += MEM_POOL_OBJ_SIZE(pool);
+    }
+    memset(obj, 0, pool->obj_size);
+
+    pool->stats.allocs++;
+    pool->stats.in_use++;
+    if (pool->stats.in_use > pool->stats.max_in_use){
+        pool->stats.max_in_use = pool->stats.in_use;
+    }
+    return (obj);
+}
+
+void
+mem_pool_free(mem_pool_t *pool, void *obj)
+{
+    if (!obj){
+        return;
+    }
+    *(void **)obj = pool->free_list;
+    pool->free_list = obj;
+    pool->stats.frees++;
+    pool->stats.in_use--;
+}
+
+/* Return the slabs of the pool to the system if none of its objects is in
+ * use */
+void
+mem_pool_trim(mem_pool_t *pool)
+{
+    void *slab;
+
+    if (pool->stats.in_use > 0){
+        return;
+    }
+    while (pool->slabs){
+        slab = pool->slabs;
+        pool->slabs = *(void **)slab;
+        free(slab);
+    }
+    pool->free_list = NULL;
+    pool->next_obj = NULL;
+    pool->slab_end = NULL;
+    pool->stats.slabs = 0;
+}
+
+void
+mem_pools_trim()
+{
+    mem_pool_t *pool;
+
+    for (pool = mem_pools; pool; pool = pool->next_pool){
+        mem_pool_trim(pool);
+    }
+}
+
+void
+mem_pools_dump(int log_level)
+{
+    mem_pool_t *pool;
+
+    if (!is_loggable(log_level)){
+        return;
+    }
+    for (pool = mem_pools; pool; pool = pool->next_pool){
+        OOR_LOG(log_level, "Memory pool %s: %u objects in use (max %u), %u slabs, "
+                "%"PRIu64" allocations, %"PRIu64" releases", pool->name,
+                pool->stats.in_use, pool->stats.max_in_use, pool->stats.slabs,
+                pool->stats.allocs, pool->stats.frees);
+    }
+}
+
 void
 lm_assert_failure(const char *where, const char *function,
                    const char *condition)
@@ -101,4 +101,44 @@ void *xmemdup(const void *p_, size_t size);
 char *xmemdup0(const char *p_, size_t length);
 char *xstrdup(const char *s);
 
+/* Number of objects of the slabs requested by a pool */
+#define MEM_POOL_SLAB_OBJS      256
+
+typedef struct mem_pool_stats_ {
+    uint64_t allocs;
+    uint64_t frees;
+    uint32_t in_use;
+    uint32_t max_in_use;
+    uint32_t slabs;
+} mem_pool_stats_t;
+
+/* Pool of objects of a fixed size. The memory is requested in slabs of
+ * objects and the released objects are kept in a free list to be reused.
+ * The slabs are only returned to the system when all the objects of the pool
+ * are released. Pools are not thread safe */
+typedef struct mem_pool_ {
+    const char *name;
+    size_t obj_size;
+    /* Released objects. The first word of an object links the next one */
+    void *free_list;
+    /* Slabs of the pool. The first word of a slab links the next one */
+    void *slabs;
+    /* Objects of the last slab not assigned yet */
+    uint8_t *next_obj;
+    uint8_t *slab_end;
+    mem_pool_stats_t stats;
+    /* Pools in use, to dump their statistics */
+    struct mem_pool_ *next_pool;
+    uint8_t registered;
+} mem_pool_t;
+
+#define MEM_POOL_INITIALIZER(NAME, SIZE) \
+    { NAME, SIZE, NULL, NULL, NULL, NULL, { 0, 0, 0, 0, 0 }, NULL, 0 }
+
+void *mem_pool_alloc(mem_pool_t *pool);
+void mem_pool_free(mem_pool_t *pool, void *obj);
+void mem_pool_trim(mem_pool_t *pool);
+void mem_pools_trim();
+void mem_pools_dump(int log_level);
+
 #endif /* MEM_UTIL_H_ */
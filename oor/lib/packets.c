@@ -34,6 +34,9 @@
 
 uint16_t ip_id = 0;
 
+/* The tuplas are cloned for each flow of the data plane */
+static mem_pool_t pkt_tuple_pool = MEM_POOL_INITIALIZER("packet_tuple", sizeof(packet_tuple_t));
+
 /* Returns IP ID for the packet */
 static inline uint16_t
 get_IP_ID()
@@ -239,6 +242,125 @@ pkt_push_udp_and_ip(lbuf_t *b, uint16_t sp, uint16_t dp, ip_addr_t *sip,
     return(GOOD);
 }
 
+/* Build the outer headers of the encapsulated packets sent from sip:sp to
+ * dip:dp with the tunnel header tun_hdr */
+int
+pkt_encap_tmpl_init(pkt_encap_tmpl_t *tmpl, void *tun_hdr, int tun_hdr_len,
+        uint16_t sp, uint16_t dp, ip_addr_t *sip, ip_addr_t *dip)
+{
+    uint8_t buf[PKT_ENCAP_TMPL_MAX_LEN];
+    lbuf_t b;
+    struct ip *iph;
+    struct ip6_hdr *ip6h;
+    uint16_t *words;
+
+    memset(tmpl, 0, sizeof(pkt_encap_tmpl_t));
+    if (tun_hdr_len > PKT_ENCAP_TUN_HDR_MAX_LEN){
+        return (BAD);
+    }
+
+    /* The flow label of IPv6 is not set by pkt_push_ipv6 */
+    memset(buf, 0, sizeof(buf));
+    lbuf_use_stack(&b, buf, sizeof(buf));
+    lbuf_reserve(&b, sizeof(buf));
+    memcpy(lbuf_push_uninit(&b, tun_hdr_len), tun_hdr, tun_hdr_len);
+    pkt_push_udp(&b, sp, dp);
+    if (pkt_push_ip(&b, sip, dip, IPPROTO_UDP) == NULL) {
+        return (BAD);
+    }
+
+    tmpl->afi = ip_addr_afi(sip);
+    tmpl->len = lbuf_size(&b);
+    memcpy(tmpl->hdr, lbuf_data(&b), tmpl->len);
+    switch (tmpl->afi){
+    case AF_INET:
+        tmpl->ip_len = sizeof(struct ip);
+        iph = (struct ip *)tmpl->hdr;
+        iph->ip_sum = 0;
+        /* Fragment offset and addresses. Version + TOS, length, ID and
+         * TTL + protocol are added per packet */
+        words = (uint16_t *)iph;
+        tmpl->ip_csum = cksum_partial(&words[3], sizeof(uint16_t), 0);
+        tmpl->ip_csum = cksum_partial(&iph->ip_src, 2 * sizeof(struct in_addr),
+                tmpl->ip_csum);
+        tmpl->udp_csum = cksum_partial(&iph->ip_src, 2 * sizeof(struct in_addr),
+                htons(IPPROTO_UDP));
+        break;
+    case AF_INET6:
+        tmpl->ip_len = sizeof(struct ip6_hdr);
+        ip6h = (struct ip6_hdr *)tmpl->hdr;
+        tmpl->udp_csum = cksum_partial(&ip6h->ip6_src, 2 * sizeof(struct in6_addr),
+                htons(IPPROTO_UDP));
+        break;
+    default:
+        tmpl->len = 0;
+        return (BAD);
+    }
+
+    return (GOOD);
+}
+
+/* Encapsulate the IP packet of b using a template. TTL and TOS are copied
+ * from the inner header */
+int
+pkt_push_encap_tmpl(lbuf_t *b, pkt_encap_tmpl_t *tmpl)
+{
+    int ttl = 0, tos = 0;
+    int udp_len;
+    struct ip *iph;
+    struct ip6_hdr *ip6h;
+    struct udphdr *uh;
+    uint16_t *words;
+    uint16_t udpsum;
+
+    ip_hdr_ttl_and_tos(lbuf_data(b), &ttl, &tos);
+
+    uh = lbuf_push_uninit(b, tmpl->len - tmpl->ip_len);
+    lbuf_reset_udp(b);
+    udp_len = lbuf_size(b);
+    lbuf_push_uninit(b, tmpl->ip_len);
+    lbuf_reset_ip(b);
+    memcpy(lbuf_data(b), tmpl->hdr, tmpl->len);
+    udplen(uh) = htons(udp_len);
+
+    switch (tmpl->afi){
+    case AF_INET:
+        iph = lbuf_data(b);
+        iph->ip_len = htons(lbuf_size(b));
+        iph->ip_id = htons(get_IP_ID());
+        /*XXX It seems that there is a bug in uClibc that causes ttl=0 in
+         * OpenWRT. This is a quick workaround */
+        if (ttl != 0) {
+            iph->ip_ttl = ttl;
+        }
+        iph->ip_tos = tos;
+        words = (uint16_t *)iph;
+        iph->ip_sum = cksum_fold(tmpl->ip_csum + words[0] + words[1] + words[2]
+                + words[4]);
+        break;
+    case AF_INET6:
+        ip6h = lbuf_data(b);
+        ip6h->ip6_plen = htons(udp_len);
+        if (ttl != 0) {
+            ip6h->ip6_hops = ttl;
+        }
+        IPV6_SET_TC(ip6h, tos);
+        break;
+    default:
+        return (BAD);
+    }
+
+    if (tmpl->zero_udp_csum && tmpl->afi == AF_INET){
+        udpsum(uh) = 0;
+        return (GOOD);
+    }
+    udpsum = cksum_fold(cksum_partial(uh, udp_len,
+            tmpl->udp_csum + htons(udp_len)));
+    udpsum(uh) = udpsum == 0 ? 0xFFFF : udpsum;
+
+    return (GOOD);
+}
+
 /* Fill the tuple with the 5 tuples of a packet:
  * (SRC IP, DST IP, PROTOCOL, SRC PORT, DST PORT) */
 int
@@ -291,84 +413,133 @@ pkt_parse_5_tuple(lbuf_t *b, packet_tuple_t *tuple)
     return (GOOD);
 }
 
-/* Calculate the hash of the 5 tuples of a packet */
-uint32_t
-pkt_tuple_hash(packet_tuple_t *tuple)
+/* Copy the address of an IP lisp_addr_t to a word aligned buffer. Returns
+ * the number of words copied */
+static inline int
+pkt_hash_copy_addr(uint32_t *dst, lisp_addr_t *addr)
 {
-    int hash = 0;
-    int len = 0;
-    int port = tuple->src_port;
-    uint32_t *tuples = NULL;
+    ip_addr_t *ip = lisp_addr_ip(addr);
 
-    port = port + ((int)tuple->dst_port << 16);
-    switch (lisp_addr_ip_afi(&tuple->src_addr)){
+    switch (ip->afi){
     case AF_INET:
-        /* 1 integer src_addr
-         * + 1 integer dst_adr
-         * + 1 integer (ports)
-         * + 1 integer protocol
-         * + 1 iid*/
-        len = 5;
-        tuples = xmalloc(len * sizeof(uint32_t));
-        lisp_addr_copy_to(&tuples[0], &tuple->src_addr);
-        lisp_addr_copy_to(&tuples[1], &tuple->dst_addr);
-        tuples[2] = port;
-        tuples[3] = tuple->protocol;
-        tuples[4] = tuple->iid;
-        break;
+        dst[0] = ip->addr.v4.s_addr;
+        return (1);
     case AF_INET6:
-        /* 4 integer src_addr
-         * + 4 integer dst_adr
-         * + 1 integer (ports)
-         * + 1 integer protocol
-         * + 1 iid */
-        len = 11;
-        tuples = xmalloc(len * sizeof(uint32_t));
-        lisp_addr_copy_to(&tuples[0], &tuple->src_addr);
-        lisp_addr_copy_to(&tuples[4], &tuple->dst_addr);
-        tuples[8] = port;
-        tuples[9] = tuple->protocol;
-        tuples[10] = tuple->iid;
+        memcpy(dst, &ip->addr.v6, sizeof(struct in6_addr));
+        return (4);
+    default:
+        return (0);
+    }
+}
+
+/* Fill the compact flow key of a tuple */
+void
+pkt_flow_key_init(pkt_flow_key_t *key, packet_tuple_t *tuple)
+{
+    memset(key, 0, sizeof(pkt_flow_key_t));
+    key->iid = tuple->iid;
+    key->src_port = tuple->src_port;
+    key->dst_port = tuple->dst_port;
+    key->protocol = tuple->protocol;
+    if (!lisp_addr_is_ip(&tuple->src_addr)){
+        return;
+    }
+    switch (pkt_hash_copy_addr(key->addr, &tuple->src_addr)){
+    case 1:
+        key->ip_version = 4;
+        pkt_hash_copy_addr(&key->addr[1], &tuple->dst_addr);
+        break;
+    case 4:
+        key->ip_version = 6;
+        pkt_hash_copy_addr(&key->addr[4], &tuple->dst_addr);
+        break;
+    default:
         break;
     }
+}
+
+/* Calculate the hash of a flow key. Only the words used by its IP version
+ * are hashed */
+uint32_t
+pkt_flow_key_hash(pkt_flow_key_t *key)
+{
+    int len = key->ip_version == 6 ? PKT_FLOW_KEY_V6_WORDS : PKT_FLOW_KEY_V4_WORDS;
 
     /* XXX: why 2013 used as initial value? */
-    hash = hashword(tuples, len, 2013);
-    free(tuples);
-    return (hash);
+    return (hashword((uint32_t *)key, len, 2013));
 }
 
-/* Calculate the hash of the src, dst address of a packet */
-uint32_t
-pkt_src_dst_hash(lisp_addr_t *src_addr, lisp_addr_t *dst_addr)
+/* Fill the compact key of an IP EID prefix, with or without iid. Return BAD
+ * if the EID is not IP */
+int
+pkt_eid_key_init(pkt_eid_key_t *key, lisp_addr_t *eid)
 {
-    int hash = 0;
-    int len = 0;
-    uint32_t *tuples = NULL;
+    lisp_addr_t *ip_eid;
+    ip_addr_t *ip;
 
-    switch (lisp_addr_ip_afi(src_addr)){
+    memset(key, 0, sizeof(pkt_eid_key_t));
+    if (lisp_addr_is_iid(eid)){
+        key->iid = lcaf_iid_get_iid(lisp_addr_get_lcaf(eid));
+    }
+    ip_eid = lisp_addr_get_ip_pref_addr(eid);
+    if (!ip_eid){
+        ip_eid = lisp_addr_get_ip_addr(eid);
+    }
+    ip = ip_eid ? lisp_addr_ip_get_addr(ip_eid) : NULL;
+    if (!ip){
+        return (BAD);
+    }
+    switch (ip->afi){
     case AF_INET:
-        /* 1 integer src_addr
-         * + 1 integer dst_adr*/
-        len = 2;
-        tuples = xmalloc(len * sizeof(uint32_t));
-        lisp_addr_copy_to(&tuples[0], src_addr);
-        lisp_addr_copy_to(&tuples[1], dst_addr);
+        key->ip_version = 4;
+        key->addr[0] = ip->addr.v4.s_addr;
         break;
     case AF_INET6:
-        /* 4 integer src_addr
-         * + 4 integer dst_adr */
-        len = 8;
-        tuples = xmalloc(len * sizeof(uint32_t));
-        lisp_addr_copy_to(&tuples[0], src_addr);
-        lisp_addr_copy_to(&tuples[4], dst_addr);
+        key->ip_version = 6;
+        memcpy(key->addr, &ip->addr.v6, sizeof(struct in6_addr));
         break;
+    default:
+        return (BAD);
+    }
+    key->plen = lisp_addr_get_plen(ip_eid);
+
+    return (GOOD);
+}
+
+uint32_t
+pkt_eid_key_hash(pkt_eid_key_t *key)
+{
+    return (hashword((uint32_t *)key, PKT_EID_KEY_WORDS, 2013));
+}
+
+/* Calculate the hash of the 5 tuples of a packet */
+uint32_t
+pkt_tuple_hash(packet_tuple_t *tuple)
+{
+    pkt_flow_key_t key;
+
+    pkt_flow_key_init(&key, tuple);
+    return (pkt_flow_key_hash(&key));
+}
+
+/* Calculate the hash of the src, dst address of a packet */
+uint32_t
+pkt_src_dst_hash(lisp_addr_t *src_addr, lisp_addr_t *dst_addr)
+{
+    uint32_t tuples[8];
+    int len;
+
+    if (!lisp_addr_is_ip(src_addr)){
+        return (hashword(NULL, 0, 2013));
+    }
+    len = pkt_hash_copy_addr(tuples, src_addr);
+    if (len == 0){
+        return (hashword(NULL, 0, 2013));
     }
+    len += pkt_hash_copy_addr(&tuples[len], dst_addr);
 
     /* XXX: why 2013 used as initial value? */
-    hash = hashword(tuples, len, 2013);
-    free(tuples);
-    return (hash);
+    return (hashword(tuples, len, 2013));
 }
 
 int
@@ -384,7 +555,7 @@ pkt_tuple_cmp(packet_tuple_t *t1, packet_tuple_t *t2)
 packet_tuple_t *
 pkt_tuple_clone(packet_tuple_t *tpl)
 {
-    packet_tuple_t *cpy = xzalloc(sizeof(packet_tuple_t));
+    packet_tuple_t *cpy = mem_pool_alloc(&pkt_tuple_pool);
     cpy->src_port = tpl->src_port;
     cpy->dst_port = tpl->dst_port;
     cpy->protocol = tpl->protocol;
@@ -399,7 +570,7 @@ pkt_tuple_del(packet_tuple_t *tpl)
 {
     lisp_addr_dealloc(&tpl->dst_addr);
     lisp_addr_dealloc(&tpl->src_addr);
-    free(tpl);
+    mem_pool_free(&pkt_tuple_pool, tpl);
     tpl = NULL;
 }
 
@@ -72,6 +72,65 @@ typedef struct packet_tuple {
     uint32_t                        iid;
 } packet_tuple_t;
 
+/* Compact binary representation of the 5 tuple and iid of a packet used as
+ * key of the flow tables. The IPv4 addresses use addr[0] (src) and addr[1]
+ * (dst), so an IPv4 key is hashed with 5 words and an IPv6 key with 11.
+ * Unused bytes are always zero to compare keys with memcmp */
+typedef struct pkt_flow_key_ {
+    uint32_t                        iid;
+    uint16_t                        src_port;
+    uint16_t                        dst_port;
+    uint8_t                         protocol;
+    uint8_t                         ip_version;
+    uint16_t                        pad;
+    uint32_t                        addr[8];
+} pkt_flow_key_t;
+
+#define PKT_FLOW_KEY_V4_WORDS       5
+#define PKT_FLOW_KEY_V6_WORDS       11
+
+/* Compact binary representation of an IP EID prefix and its iid. Unused
+ * bytes are always zero to compare keys with memcmp */
+typedef struct pkt_eid_key_ {
+    uint32_t                        iid;
+    uint8_t                         ip_version;
+    uint8_t                         plen;
+    uint16_t                        pad;
+    uint32_t                        addr[4];
+} pkt_eid_key_t;
+
+#define PKT_EID_KEY_WORDS           6
+
+/* Maximum size of the tunnel header (LISP / VXLAN-GPE) following the outer
+ * UDP header of an encapsulation template */
+#define PKT_ENCAP_TUN_HDR_MAX_LEN   8
+#define PKT_ENCAP_TMPL_MAX_LEN      (sizeof(struct ip6_hdr) + sizeof(struct udphdr) \
+        + PKT_ENCAP_TUN_HDR_MAX_LEN)
+
+/* Outer IP, UDP and tunnel headers prebuilt for the encapsulated packets of
+ * a flow. Only the lengths, the IPv4 ID, the TTL / TOS and the checksums are
+ * updated per packet */
+typedef struct pkt_encap_tmpl_ {
+    uint8_t                         hdr[PKT_ENCAP_TMPL_MAX_LEN];
+    /* Size of hdr. 0 if the template is not initialized */
+    uint8_t                         len;
+    uint8_t                         ip_len;
+    int                             afi;
+    /* Partial sums of the constant words of the IPv4 header and of the
+     * UDP pseudo header (addresses and protocol) */
+    uint32_t                        ip_csum;
+    uint32_t                        udp_csum;
+    /* Send the UDP checksum as zero. Only used with IPv4 */
+    uint8_t                         zero_udp_csum;
+} pkt_encap_tmpl_t;
+
+#define pkt_flow_key_equal(k1, k2) \
+    (memcmp(&(k1), &(k2), sizeof(pkt_flow_key_t)) == 0)
+#define pkt_flow_key_hash_val(k) pkt_flow_key_hash(&(k))
+#define pkt_eid_key_equal(k1, k2) \
+    (memcmp(&(k1), &(k2), sizeof(pkt_eid_key_t)) == 0)
+#define pkt_eid_key_hash_val(k) pkt_eid_key_hash(&(k))
+
 
 
 /*
@@ -104,6 +163,9 @@ void *pkt_push_eth(lbuf_t *b, uint8_t  ether_dhost[ETHER_ADDR_LEN],
 void *pkt_push_ip(lbuf_t *, ip_addr_t *, ip_addr_t *, int proto);
 int pkt_push_udp_and_ip(lbuf_t *, uint16_t, uint16_t, ip_addr_t *,
         ip_addr_t *);
+int pkt_encap_tmpl_init(pkt_encap_tmpl_t *tmpl, void *tun_hdr, int tun_hdr_len,
+        uint16_t sp, uint16_t dp, ip_addr_t *sip, ip_addr_t *dip);
+int pkt_push_encap_tmpl(lbuf_t *b, pkt_encap_tmpl_t *tmpl);
 int ip_hdr_set_ttl_and_tos(struct iphdr *, int ttl, int tos);
 int ip_hdr_ttl_and_tos(struct iphdr *, int *ttl, int *tos);
 
@@ -111,6 +173,10 @@ int pkt_parse_5_tuple(lbuf_t *b, packet_tuple_t *tuple);
 uint32_t pkt_tuple_hash(packet_tuple_t *tuple);
 uint32_t pkt_src_dst_hash(lisp_addr_t *src_addr, lisp_addr_t *dst_addr);
 int pkt_tuple_cmp(packet_tuple_t *t1, packet_tuple_t *t2);
+void pkt_flow_key_init(pkt_flow_key_t *key, packet_tuple_t *tuple);
+uint32_t pkt_flow_key_hash(pkt_flow_key_t *key);
+int pkt_eid_key_init(pkt_eid_key_t *key, lisp_addr_t *eid);
+uint32_t pkt_eid_key_hash(pkt_eid_key_t *key);
 packet_tuple_t *pkt_tuple_clone(packet_tuple_t *);
 void pkt_tuple_del(packet_tuple_t *tpl);
 char *pkt_tuple_to_char(packet_tuple_t *tpl);
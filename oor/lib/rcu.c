@@ -0,0 +1,151 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Quiescent state based reclamation of the data shared between the main
+ * thread, the only one modifying it, and the reader threads, which access it
+ * without locks. The main thread unlinks an object and defers its release
+ * until all the readers have passed through a quiescent state. Callbacks are
+ * deferred and run only by the main thread.
+ */
+
+#include "rcu.h"
+#include "mem_util.h"
+#include "oor_log.h"
+#include "../defs.h"
+#include "../elibs/ovs/list.h"
+
+typedef struct rcu_cb_ {
+    struct ovs_list node;
+    rcu_cb_fn fn;
+    void *arg;
+    /* Epoch when the callback was deferred */
+    uint64_t epoch;
+} rcu_cb_t;
+
+uint64_t rcu_epoch = 1;
+
+/* Registered readers. Only modified by the main thread */
+static rcu_thread_t *rcu_threads = NULL;
+/* Deferred callbacks in the order they were deferred */
+static struct ovs_list rcu_pending = {&rcu_pending, &rcu_pending};
+static uint32_t rcu_npending = 0;
+static mem_pool_t rcu_cb_pool = MEM_POOL_INITIALIZER("rcu_cb", sizeof(rcu_cb_t));
+
+
+/* Register a reader. It starts offline. It should be called by the main thread
+ * before the reader uses shared data */
+void
+rcu_thread_register(rcu_thread_t *th)
+{
+    th->epoch = RCU_OFFLINE;
+    th->next = rcu_threads;
+    rcu_threads = th;
+}
+
+/* Unregister a reader that has stopped. Called by the main thread */
+void
+rcu_thread_unregister(rcu_thread_t *th)
+{
+    rcu_thread_t **prev;
+
+    for (prev = &rcu_threads; *prev; prev = &(*prev)->next){
+        if (*prev == th){
+            *prev = th->next;
+            break;
+        }
+    }
+}
+
+/* Called by the reader before using shared data after being offline */
+void
+rcu_thread_online(rcu_thread_t *th)
+{
+    __atomic_store_n(&th->epoch, __atomic_load_n(&rcu_epoch, __ATOMIC_SEQ_CST),
+            __ATOMIC_SEQ_CST);
+    /* The epoch should be visible before reading shared data */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/* Call fn(arg) once the readers can't have references to the data unlinked
+ * before calling it. Without readers, the callback is called immediately */
+void
+rcu_defer(rcu_cb_fn fn, void *arg)
+{
+    rcu_cb_t *cb;
+
+    if (!rcu_threads){
+        fn(arg);
+        return;
+    }
+    cb = mem_pool_alloc(&rcu_cb_pool);
+    cb->fn = fn;
+    cb->arg = arg;
+    cb->epoch = rcu_epoch;
+    list_push_back(&rcu_pending, &cb->node);
+    rcu_npending++;
+}
+
+/* Start a new epoch and run the callbacks deferred before the last quiescent
+ * state of all the online readers. Called periodically by the main thread.
+ * Returns the number of callbacks run */
+int
+rcu_poll()
+{
+    rcu_thread_t *th;
+    rcu_cb_t *cb;
+    uint64_t min_epoch, epoch;
+    int n = 0;
+
+    if (list_is_empty(&rcu_pending)){
+        return (0);
+    }
+
+    /* Callbacks deferred from now on wait for the new epoch */
+    min_epoch = __atomic_add_fetch(&rcu_epoch, 1, __ATOMIC_SEQ_CST);
+    for (th = rcu_threads; th; th = th->next){
+        epoch = __atomic_load_n(&th->epoch, __ATOMIC_SEQ_CST);
+        if (epoch != RCU_OFFLINE && epoch < min_epoch){
+            min_epoch = epoch;
+        }
+    }
+
+    while (!list_is_empty(&rcu_pending)){
+        cb = CONTAINER_OF(list_front(&rcu_pending), rcu_cb_t, node);
+        if (cb->epoch >= min_epoch){
+            break;
+        }
+        list_remove(&cb->node);
+        rcu_npending--;
+        cb->fn(cb->arg);
+        mem_pool_free(&rcu_cb_pool, cb);
+        n++;
+    }
+    if (n > 0){
+        OOR_LOG(LDBG_3, "rcu_poll: %d callbacks run, %u pending", n, rcu_npending);
+    }
+    return (n);
+}
+
+/*
+ * Editor modelines
+ *
+ * vi: set shiftwidth=4 tabstop=4 expandtab:
+ * :indentSize=4:tabSize=4:noTabs=true:
+ */
@@ -0,0 +1,63 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef RCU_H_
+#define RCU_H_
+
+#include <stdint.h>
+
+/* Epoch of a thread that is not using shared data */
+#define RCU_OFFLINE     0
+
+typedef void (*rcu_cb_fn)(void *arg);
+
+/* Advanced by the writer each time it checks for finished grace periods */
+extern uint64_t rcu_epoch;
+
+/* Reader thread. It reports quiescent states, points where it doesn't keep
+ * references to shared data, copying the global epoch to its own epoch */
+typedef struct rcu_thread_ {
+    uint64_t epoch;
+    struct rcu_thread_ *next;
+} rcu_thread_t;
+
+void rcu_thread_register(rcu_thread_t *th);
+void rcu_thread_unregister(rcu_thread_t *th);
+void rcu_thread_online(rcu_thread_t *th);
+void rcu_defer(rcu_cb_fn fn, void *arg);
+int rcu_poll();
+
+/* Quiescent state of a reader. Shared data obtained before should not be
+ * used after it */
+static inline void
+rcu_quiescent(rcu_thread_t *th)
+{
+    __atomic_store_n(&th->epoch, __atomic_load_n(&rcu_epoch, __ATOMIC_ACQUIRE),
+            __ATOMIC_RELEASE);
+}
+
+/* Extended quiescent state of a reader, e.g. while it is blocked waiting for
+ * packets. It doesn't delay the release of the data until it is online */
+static inline void
+rcu_thread_offline(rcu_thread_t *th)
+{
+    __atomic_store_n(&th->epoch, RCU_OFFLINE, __ATOMIC_RELEASE);
+}
+
+#endif /* RCU_H_ */
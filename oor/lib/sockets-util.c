@@ -20,6 +20,7 @@
 #include <errno.h>
 #include <netdb.h>
 #include <unistd.h>
+#include <netinet/udp.h>
 #include <linux/netlink.h>
 #include <linux/rtnetlink.h>
 
@@ -213,6 +214,20 @@ socket_conf_req_ttl_tos(int sock, int afi)
     return (GOOD);
 }
 
+/* Ask the kernel to deliver the datagrams received of a same flow coalesced
+ * in a single read. The size of the coalesced datagrams is provided in the
+ * ancillary data (UDP_GRO) */
+int
+socket_conf_udp_gro(int sock)
+{
+    const int on = 1;
+
+    if (setsockopt(sock, SOL_UDP, UDP_GRO, &on, sizeof(on)) < 0) {
+        OOR_LOG(LWRN, "socket_conf_udp_gro: setsockopt UDP_GRO: %s", strerror(errno));
+        return (BAD);
+    }
+    return (GOOD);
+}
 
 /*
  * Bind a socket to a specific address and port if specified
@@ -276,44 +291,164 @@ bind_socket(int sock, int afi, lisp_addr_t *src_addr, int src_port)
 }
 
 
+/* Fills 'saddr' with the IP address 'ip'. Returns the length of the
+ * resulting socket address or 0 if the AFI is not supported */
+int
+ip_addr_to_sockaddr(ip_addr_t *ip, struct sockaddr_storage *saddr)
+{
+    struct sockaddr_in *sa4;
+    struct sockaddr_in6 *sa6;
+
+    switch (ip_addr_afi(ip)) {
+    case AF_INET:
+        sa4 = (struct sockaddr_in *)saddr;
+        memset(sa4, 0, sizeof(struct sockaddr_in));
+        sa4->sin_family = AF_INET;
+        ip_addr_copy_to(&sa4->sin_addr, ip);
+        return (sizeof(struct sockaddr_in));
+    case AF_INET6:
+        sa6 = (struct sockaddr_in6 *)saddr;
+        memset(sa6, 0, sizeof(struct sockaddr_in6));
+        sa6->sin6_family = AF_INET6;
+        ip_addr_copy_to(&sa6->sin6_addr, ip);
+        return (sizeof(struct sockaddr_in6));
+    default:
+        return (0);
+    }
+}
+
 /* Sends a raw packet out the socket file descriptor 'sfd'  */
 int
 send_raw_packet(int socket, const void *pkt, int plen, ip_addr_t *dip)
 {
-    struct sockaddr *saddr = NULL;
+    struct sockaddr_storage saddr;
     int slen, nbytes;
 
-    struct sockaddr_in sa4;
-    struct sockaddr_in6 sa6;
+    /* build sock addr */
+    slen = ip_addr_to_sockaddr(dip, &saddr);
+    if (slen == 0) {
+        return(BAD);
+    }
 
+    nbytes = sendto(socket, pkt, plen, 0, (struct sockaddr *)&saddr, slen);
+    if (nbytes != plen) {
+        OOR_LOG(LDBG_2, "send_raw_packet: send packet to %s using fail descriptor %d failed -> %s", ip_addr_to_char(dip),
+                socket, strerror(errno));
+        return(BAD);
+    }
 
-    /* build sock addr */
-    switch (ip_addr_afi(dip)) {
+    return (GOOD);
+}
+
+/* Sends the 'vlen' raw packets of 'msgs' out the socket file descriptor
+ * 'sock' using as few system calls as possible. Packets that can not be sent
+ * are discarded. Returns the number of packets sent */
+int
+send_raw_packets(int sock, struct mmsghdr *msgs, int vlen)
+{
+    int pos = 0, sent = 0, ret;
+
+    while (pos < vlen) {
+        ret = sendmmsg(sock, &msgs[pos], vlen - pos, 0);
+        if (ret == -1) {
+            OOR_LOG(LDBG_2, "send_raw_packets: send packet using file descriptor %d "
+                    "failed -> %s", sock, strerror(errno));
+            /* Discard the packet producing the error and go on with the rest */
+            pos++;
+            continue;
+        }
+        pos += ret;
+        sent += ret;
+    }
+
+    return (sent);
+}
+
+/* Sends to 'dst' the 'iovcnt' UDP payloads of 'iov' with a single system
+ * call using UDP segmentation offload. All the payloads should have
+ * 'seg_size' bytes except the last one that can be shorter. The source
+ * address, the TOS and the TTL of the packets are selected with ancillary
+ * data, so the socket doesn't need to be bound */
+int
+send_datagram_gso(int sock, struct iovec *iov, int iovcnt, uint16_t seg_size,
+        struct sockaddr_storage *src, struct sockaddr_storage *dst, int tos, int ttl)
+{
+    union {
+        struct cmsghdr cmsg;
+        u_char data[CMSG_SPACE(sizeof(uint16_t)) + CMSG_SPACE(sizeof(struct in6_pktinfo))
+                    + CMSG_SPACE(sizeof(int)) + CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr msg;
+    struct cmsghdr *cmsgptr;
+    struct in_pktinfo *pktinfo;
+    struct in6_pktinfo *pktinfo6;
+
+    memset(&msg, 0, sizeof(msg));
+    memset(&control, 0, sizeof(control));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+    msg.msg_name = dst;
+    msg.msg_control = &control;
+    msg.msg_controllen = sizeof(control);
+
+    cmsgptr = CMSG_FIRSTHDR(&msg);
+    cmsgptr->cmsg_level = SOL_UDP;
+    cmsgptr->cmsg_type = UDP_SEGMENT;
+    cmsgptr->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    *((uint16_t *)CMSG_DATA(cmsgptr)) = seg_size;
+
+    cmsgptr = CMSG_NXTHDR(&msg, cmsgptr);
+    switch (dst->ss_family) {
     case AF_INET:
-        memset(&sa4, 0, sizeof(sa4));
-        sa4.sin_family = AF_INET;
-        ip_addr_copy_to(&sa4.sin_addr, dip);
-        slen = sizeof(struct sockaddr_in);
-        saddr = (struct sockaddr *)&sa4;
+        msg.msg_namelen = sizeof(struct sockaddr_in);
+        cmsgptr->cmsg_level = IPPROTO_IP;
+        cmsgptr->cmsg_type = IP_PKTINFO;
+        cmsgptr->cmsg_len = CMSG_LEN(sizeof(struct in_pktinfo));
+        pktinfo = (struct in_pktinfo *)CMSG_DATA(cmsgptr);
+        pktinfo->ipi_spec_dst = ((struct sockaddr_in *)src)->sin_addr;
+
+        cmsgptr = CMSG_NXTHDR(&msg, cmsgptr);
+        cmsgptr->cmsg_level = IPPROTO_IP;
+        cmsgptr->cmsg_type = IP_TOS;
+        cmsgptr->cmsg_len = CMSG_LEN(sizeof(int));
+        *((int *)CMSG_DATA(cmsgptr)) = tos;
+
+        cmsgptr = CMSG_NXTHDR(&msg, cmsgptr);
+        cmsgptr->cmsg_level = IPPROTO_IP;
+        cmsgptr->cmsg_type = IP_TTL;
+        cmsgptr->cmsg_len = CMSG_LEN(sizeof(int));
+        *((int *)CMSG_DATA(cmsgptr)) = ttl;
         break;
     case AF_INET6:
-        memset(&sa6, 0, sizeof(sa6));
-        sa6.sin6_family = AF_INET6;
-        ip_addr_copy_to(&sa6.sin6_addr, dip);
-        slen = sizeof(struct sockaddr_in6);
-        saddr = (struct sockaddr *)&sa6;
+        msg.msg_namelen = sizeof(struct sockaddr_in6);
+        cmsgptr->cmsg_level = IPPROTO_IPV6;
+        cmsgptr->cmsg_type = IPV6_PKTINFO;
+        cmsgptr->cmsg_len = CMSG_LEN(sizeof(struct in6_pktinfo));
+        pktinfo6 = (struct in6_pktinfo *)CMSG_DATA(cmsgptr);
+        pktinfo6->ipi6_addr = ((struct sockaddr_in6 *)src)->sin6_addr;
+
+        cmsgptr = CMSG_NXTHDR(&msg, cmsgptr);
+        cmsgptr->cmsg_level = IPPROTO_IPV6;
+        cmsgptr->cmsg_type = IPV6_TCLASS;
+        cmsgptr->cmsg_len = CMSG_LEN(sizeof(int));
+        *((int *)CMSG_DATA(cmsgptr)) = tos;
+
+        cmsgptr = CMSG_NXTHDR(&msg, cmsgptr);
+        cmsgptr->cmsg_level = IPPROTO_IPV6;
+        cmsgptr->cmsg_type = IPV6_HOPLIMIT;
+        cmsgptr->cmsg_len = CMSG_LEN(sizeof(int));
+        *((int *)CMSG_DATA(cmsgptr)) = ttl;
         break;
     default:
-	return(BAD);
+        return (BAD);
     }
+    msg.msg_controllen = (u_char *)cmsgptr + CMSG_SPACE(sizeof(int)) - (u_char *)&control;
 
-    nbytes = sendto(socket, pkt, plen, 0, saddr, slen);
-    if (nbytes != plen) {
-        OOR_LOG(LDBG_2, "send_raw_packet: send packet to %s using fail descriptor %d failed -> %s", ip_addr_to_char(dip),
-                socket, strerror(errno));
-        return(BAD);
+    if (sendmsg(sock, &msg, 0) < 0) {
+        OOR_LOG(LDBG_2, "send_datagram_gso: send of %d segments failed -> %s",
+                iovcnt, strerror(errno));
+        return (BAD);
     }
-
     return (GOOD);
 }
 
@@ -21,6 +21,7 @@
 #ifndef SOCKETS_UTIL_H_
 #define SOCKETS_UTIL_H_
 
+#include <sys/socket.h>
 #include "../liblisp/lisp_address.h"
 
 int open_ip_raw_socket(int afi);
@@ -30,9 +31,14 @@ int opent_netlink_socket();
 int open_udp_datagram_socket(int afi);
 int socket_bindtodevice(int sock, char *device);
 int socket_conf_req_ttl_tos(int sock, int afi);
+int socket_conf_udp_gro(int sock);
 
 int bind_socket(int sock,int afi, lisp_addr_t *src_addr, int src_port);
+int ip_addr_to_sockaddr(ip_addr_t *ip, struct sockaddr_storage *saddr);
 int send_raw_packet(int, const void *, int, ip_addr_t *);
+int send_raw_packets(int sock, struct mmsghdr *msgs, int vlen);
+int send_datagram_gso(int sock, struct iovec *iov, int iovcnt, uint16_t seg_size,
+        struct sockaddr_storage *src, struct sockaddr_storage *dst, int tos, int ttl);
 int send_datagram_packet (int sock, const void *packet, int packet_length,
         lisp_addr_t *addr_dest, int port_dest);
 
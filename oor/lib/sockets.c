@@ -19,6 +19,7 @@
 
 
 #include <netinet/in.h>
+#include <netinet/udp.h>
 #include <errno.h>
 #include <sys/socket.h>
 
@@ -35,6 +36,13 @@ sockmstr_create()
 {
     sockmstr_t *sm;
     sm = xzalloc(sizeof(sockmstr_t));
+    sm->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (sm->epoll_fd == -1){
+        OOR_LOG(LCRIT, "sockmstr_create: Couldn't create epoll instance: %s",
+                strerror(errno));
+        free(sm);
+        return (NULL);
+    }
     return (sm);
 }
 
@@ -65,16 +73,11 @@ sock_list_add(sock_list_t *lst, sock_t *sock)
 
     lst->tail = sock;
     lst->count++;
-    if (sock->fd > lst->maxfd) {
-        lst->maxfd = sock->fd;
-    }
-
 }
 
 static inline void
 sock_list_remove(sock_list_t *lst, struct sock *sock)
 {
-    int fd;
     if (sock->prev == NULL){
         lst->head = sock->next;
         if (sock->next != NULL){
@@ -86,24 +89,13 @@ sock_list_remove(sock_list_t *lst, struct sock *sock)
             sock->next->prev = sock->prev;
         }
     }
-    fd = sock->fd;
+    if (lst->tail == sock){
+        lst->tail = sock->prev;
+    }
     close(sock->fd);
     free(sock);
 
     lst->count--;
-
-    if (fd == lst->maxfd){
-        sock= lst->head;
-        if (sock == NULL){
-            lst->maxfd = 0;
-        }
-        while (sock != NULL){
-            if (sock->fd > lst->maxfd) {
-                lst->maxfd = sock->fd;
-            }
-            sock = sock->next;
-        }
-    }
 }
 
 void
@@ -113,6 +105,7 @@ sockmstr_destroy(sockmstr_t *sm)
         return;
     }
     sock_list_remove_all(&sm->read);
+    close(sm->epoll_fd);
     free(sm);
     OOR_LOG(LDBG_1,"Sockets closed");
 }
@@ -175,13 +168,34 @@ sockmstr_register_get_by_bind_port (sockmstr_t *m, int afi, uint16_t port)
 sock_t *
 sockmstr_register_read_listener(sockmstr_t *m,int (*func)(struct sock *),
         void *arg, int fd)
+{
+    return (sockmstr_register_read_listener_prio(m, func, arg, fd,
+            SOCK_PRIO_NORMAL));
+}
+
+sock_t *
+sockmstr_register_read_listener_prio(sockmstr_t *m,int (*func)(struct sock *),
+        void *arg, int fd, sock_prio_e prio)
 {
     struct sock *sock;
+    struct epoll_event ev;
+
     sock = xzalloc(sizeof(struct sock));
     sock->recv_cb = func;
     sock->type = SOCK_READ;
+    sock->prio = prio;
     sock->arg = arg;
     sock->fd = fd;
+
+    memset(&ev, 0, sizeof(struct epoll_event));
+    ev.events = EPOLLIN;
+    ev.data.ptr = sock;
+    if (epoll_ctl(m->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1){
+        OOR_LOG(LERR, "sockmstr_register_read_listener: Couldn't add socket %d "
+                "to the epoll instance: %s", fd, strerror(errno));
+        free(sock);
+        return (NULL);
+    }
     sock_list_add(&m->read, sock);
     return (sock);
 }
@@ -196,54 +210,61 @@ sock_fd(struct sock * sock)
 int
 sockmstr_unregister_read_listenedr(sockmstr_t *m, struct sock *sock)
 {
-   sock_list_remove(&m->read, sock);
-   return (GOOD);
+    int i;
+
+    epoll_ctl(m->epoll_fd, EPOLL_CTL_DEL, sock->fd, NULL);
+    /* The socket could be pending to be processed in this iteration */
+    for (i = 0; i < m->nevents; i++){
+        if (m->events[i].data.ptr == sock){
+            m->events[i].data.ptr = NULL;
+        }
+    }
+    sock_list_remove(&m->read, sock);
+    return (GOOD);
 }
 
 
-static void
-sock_process_fd(struct sock_list *lst, fd_set *fdset)
+/* Process the ready sockets obtained in the last wait. Sockets are processed
+ * in order of priority */
+void
+sockmstr_process_all(sockmstr_t *m)
 {
     struct sock *sit;
+    int i, prio;
 
-    for (sit = lst->head; sit; sit = sit->next) {
-        if (FD_ISSET(sit->fd, fdset))
+    for (prio = SOCK_PRIO_HIGH; prio < SOCK_PRIO_MAX; prio++){
+        for (i = 0; i < m->nevents; i++){
+            sit = (struct sock *)m->events[i].data.ptr;
+            if (sit == NULL || sit->prio != prio){
+                continue;
+            }
             (*sit->recv_cb)(sit);
+        }
     }
+    m->nevents = 0;
 }
 
+/* Wait until at least one socket is ready to be read or the timeout expires */
 void
-sockmstr_process_all(sockmstr_t *m)
+sockmstr_wait_on_all_read(sockmstr_t *m)
 {
-    struct timeval tv;
-
-    tv.tv_sec = 0;
-    tv.tv_usec = DEFAULT_SELECT_TIMEOUT;
+    int nevents;
 
     while (1) {
-        if (select(m->read.maxfd + 1, &m->readfds, NULL, NULL, &tv) == -1) {
+        nevents = epoll_wait(m->epoll_fd, m->events, SOCKMSTR_MAX_EVENTS,
+                DEFAULT_EPOLL_TIMEOUT);
+        if (nevents == -1) {
             if (errno == EINTR) {
                 continue;
             } else {
-                OOR_LOG(LDBG_2, "sock_process_all: select error: %s",
+                OOR_LOG(LDBG_2, "sockmstr_wait_on_all_read: epoll error: %s",
                         strerror(errno));
-                return;
+                nevents = 0;
             }
-        } else {
-            break;
         }
+        break;
     }
-
-    sock_process_fd(&m->read, &m->readfds);
-}
-
-void
-sockmstr_wait_on_all_read(sockmstr_t *m)
-{
-    struct sock *sit;
-    for (sit = m->read.head; sit; sit = sit->next) {
-        FD_SET(sit->fd, &m->readfds);
-    }
+    m->nevents = nevents;
 }
 
 int
@@ -329,13 +350,53 @@ open_data_datagram_input_socket(int afi, int port)
     return (sock);
 }
 
+/* Open a datagram socket to receive data packets that can be shared with other
+ * sockets bound to the same port. The kernel distributes the received packets
+ * between the sockets of the group according to the hash of the flow */
+int
+open_data_reuseport_input_socket(int afi, int port)
+{
+    int sock = ERR_SOCKET;
+    int on = 1;
+
+    if ((sock = open_udp_datagram_socket(afi)) < 0){
+        return(ERR_SOCKET);
+    }
+    if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) == -1){
+        OOR_LOG(LERR, "open_data_reuseport_input_socket: setsockopt SO_REUSEPORT: %s",
+                strerror(errno));
+        close(sock);
+        return(ERR_SOCKET);
+    }
+    /* IPv4 packets are received by the IPv4 sockets */
+    if (afi == AF_INET6 &&
+            setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, &on, sizeof(on)) == -1){
+        OOR_LOG(LWRN, "open_data_reuseport_input_socket: setsockopt IPV6_V6ONLY: %s",
+                strerror(errno));
+    }
+    if(bind_socket(sock,afi,NULL,port) != GOOD){
+        close(sock);
+        return(ERR_SOCKET);
+    }
+
+    if (socket_conf_req_ttl_tos(sock,afi)!= GOOD){
+        close(sock);
+        return (ERR_SOCKET);
+    }
+
+    return (sock);
+}
+
 int
 sock_recv(int sfd, lbuf_t *b)
 {
     int nread;
     nread = read(sfd, lbuf_data(b), lbuf_tailroom(b));
-    if (nread == 0) {
-        OOR_LOG(LWRN, "sock_recv: recvmsg error: %s", strerror(errno));
+    if (nread <= 0) {
+        /* Non blocking descriptors return EAGAIN once they are drained */
+        if (nread == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            OOR_LOG(LWRN, "sock_recv: read error: %s", strerror(errno));
+        }
         return (BAD);
     }
 
@@ -414,20 +475,59 @@ sock_ctrl_recv(int sock, struct lbuf *buf, uconn_t *uc)
     return (GOOD);
 }
 
+/* Space for TTL and TOS data */
+union sock_data_cmsg {
+    struct cmsghdr cmsg;
+    u_char data[CMSG_SPACE(sizeof(int)) + CMSG_SPACE(sizeof(int))];
+};
+
+/* Extract the afi, TTL and TOS of a received data packet */
+static void
+sock_data_parse_cmsg(struct msghdr *msg, union sockunion *su, int *afi,
+        uint8_t *ttl, uint8_t *tos)
+{
+    struct cmsghdr *cmsgptr = NULL;
+
+    if (su->s4.sin_family == AF_INET) {
+        for (cmsgptr = CMSG_FIRSTHDR(msg); cmsgptr != NULL; cmsgptr =
+                CMSG_NXTHDR(msg, cmsgptr)) {
+
+            if (cmsgptr->cmsg_level == IPPROTO_IP
+                    && cmsgptr->cmsg_type == IP_TTL) {
+                *ttl = *((uint8_t *) CMSG_DATA(cmsgptr));
+            }
+
+            if (cmsgptr->cmsg_level == IPPROTO_IP
+                    && cmsgptr->cmsg_type == IP_TOS) {
+                *tos = *((uint8_t *) CMSG_DATA(cmsgptr));
+            }
+        }
+        *afi = AF_INET;
+    } else {
+        for (cmsgptr = CMSG_FIRSTHDR(msg); cmsgptr != NULL; cmsgptr =
+                CMSG_NXTHDR(msg, cmsgptr)) {
+
+            if (cmsgptr->cmsg_level == IPPROTO_IPV6
+                    && cmsgptr->cmsg_type == IPV6_HOPLIMIT) {
+                *ttl = *((uint8_t *) CMSG_DATA(cmsgptr));
+            }
+
+            if (cmsgptr->cmsg_level == IPPROTO_IPV6
+                    && cmsgptr->cmsg_type == IPV6_TCLASS) {
+                *tos = *((uint8_t *) CMSG_DATA(cmsgptr));
+            }
+        }
+        *afi = AF_INET6;
+    }
+}
+
 int
 sock_data_recv(int sock, lbuf_t *b, int *afi, uint8_t *ttl, uint8_t *tos)
 {
-    /* Space for TTL and TOS data */
-    union control_data {
-        struct cmsghdr cmsg;
-        u_char data[CMSG_SPACE(sizeof(int)) + CMSG_SPACE(sizeof(int))];
-    };
-
     union sockunion su;
     struct msghdr msg;
     struct iovec iov[1];
-    union control_data cmsg;
-    struct cmsghdr *cmsgptr = NULL;
+    union sock_data_cmsg cmsg;
     int nbytes = 0;
 
     iov[0].iov_base = lbuf_data(b);
@@ -449,36 +549,109 @@ sock_data_recv(int sock, lbuf_t *b, int *afi, uint8_t *ttl, uint8_t *tos)
 
     lbuf_set_size(b, lbuf_size(b) + nbytes);
 
-    if (su.s4.sin_family == AF_INET) {
-        for (cmsgptr = CMSG_FIRSTHDR(&msg); cmsgptr != NULL; cmsgptr =
-                CMSG_NXTHDR(&msg, cmsgptr)) {
+    sock_data_parse_cmsg(&msg, &su, afi, ttl, tos);
 
-            if (cmsgptr->cmsg_level == IPPROTO_IP
-                    && cmsgptr->cmsg_type == IP_TTL) {
-                *ttl = *((uint8_t *) CMSG_DATA(cmsgptr));
-            }
+    return (GOOD);
+}
 
-            if (cmsgptr->cmsg_level == IPPROTO_IP
-                    && cmsgptr->cmsg_type == IP_TOS) {
-                *tos = *((uint8_t *) CMSG_DATA(cmsgptr));
-            }
+/* Read up to 'vlen' packets from the socket with a single system call. The
+ * call doesn't block, so only the packets already queued in the socket are
+ * returned. Returns the number of packets read, filling for each one its
+ * lbuf in 'bufs' and its afi, TTL and TOS in 'inf' */
+int
+sock_data_recv_mmsg(int sock, lbuf_t *bufs, sock_data_inf_t *inf, int vlen)
+{
+    union sockunion su[SOCK_MMSG_MAX_VLEN];
+    struct mmsghdr msgs[SOCK_MMSG_MAX_VLEN];
+    struct iovec iov[SOCK_MMSG_MAX_VLEN];
+    union sock_data_cmsg cmsg[SOCK_MMSG_MAX_VLEN];
+    int i, npkts;
+
+    if (vlen > SOCK_MMSG_MAX_VLEN) {
+        vlen = SOCK_MMSG_MAX_VLEN;
+    }
+
+    memset(msgs, 0, vlen * sizeof(struct mmsghdr));
+    for (i = 0; i < vlen; i++) {
+        iov[i].iov_base = lbuf_data(&bufs[i]);
+        iov[i].iov_len = lbuf_tailroom(&bufs[i]);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_control = &cmsg[i];
+        msgs[i].msg_hdr.msg_controllen = sizeof(union sock_data_cmsg);
+        msgs[i].msg_hdr.msg_name = &su[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(union sockunion);
+    }
+
+    npkts = recvmmsg(sock, msgs, vlen, MSG_DONTWAIT, NULL);
+    if (npkts == -1) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            OOR_LOG(LWRN, "sock_data_recv_mmsg: recvmmsg error: %s",
+                    strerror(errno));
         }
-        *afi = AF_INET;
-    } else {
-        for (cmsgptr = CMSG_FIRSTHDR(&msg); cmsgptr != NULL; cmsgptr =
-                CMSG_NXTHDR(&msg, cmsgptr)) {
+        return (0);
+    }
 
-            if (cmsgptr->cmsg_level == IPPROTO_IPV6
-                    && cmsgptr->cmsg_type == IPV6_HOPLIMIT) {
-                *ttl = *((uint8_t *) CMSG_DATA(cmsgptr));
-            }
+    for (i = 0; i < npkts; i++) {
+        lbuf_set_size(&bufs[i], lbuf_size(&bufs[i]) + msgs[i].msg_len);
+        inf[i].ttl = 0;
+        inf[i].tos = 0;
+        sock_data_parse_cmsg(&msgs[i].msg_hdr, &su[i], &inf[i].afi,
+                &inf[i].ttl, &inf[i].tos);
+    }
 
-            if (cmsgptr->cmsg_level == IPPROTO_IPV6
-                    && cmsgptr->cmsg_type == IPV6_TCLASS) {
-                *tos = *((uint8_t *) CMSG_DATA(cmsgptr));
-            }
+    return (npkts);
+}
+
+/* Read without blocking a datagram from a socket with UDP_GRO enabled. The
+ * datagram can be formed by several datagrams of a same flow coalesced by
+ * the kernel. 'seg_size' returns the size of each one of them (the last one
+ * can be shorter) or 0 if the datagram was not coalesced */
+int
+sock_data_recv_gro(int sock, lbuf_t *b, sock_data_inf_t *inf, int *seg_size)
+{
+    union {
+        struct cmsghdr cmsg;
+        u_char data[CMSG_SPACE(sizeof(int)) + CMSG_SPACE(sizeof(int))
+                    + CMSG_SPACE(sizeof(int))];
+    } control;
+    union sockunion su;
+    struct msghdr msg;
+    struct iovec iov[1];
+    struct cmsghdr *cmsgptr;
+    int nbytes;
+
+    iov[0].iov_base = lbuf_data(b);
+    iov[0].iov_len = lbuf_tailroom(b);
+
+    memset(&msg, 0, sizeof msg);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = &control;
+    msg.msg_controllen = sizeof control;
+    msg.msg_name = &su;
+    msg.msg_namelen = sizeof(union sockunion);
+
+    nbytes = recvmsg(sock, &msg, MSG_DONTWAIT);
+    if (nbytes == -1) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            OOR_LOG(LWRN, "sock_data_recv_gro: recvmsg error: %s", strerror(errno));
+        }
+        return (BAD);
+    }
+    lbuf_set_size(b, lbuf_size(b) + nbytes);
+
+    inf->ttl = 0;
+    inf->tos = 0;
+    sock_data_parse_cmsg(&msg, &su, &inf->afi, &inf->ttl, &inf->tos);
+
+    *seg_size = 0;
+    for (cmsgptr = CMSG_FIRSTHDR(&msg); cmsgptr != NULL;
+            cmsgptr = CMSG_NXTHDR(&msg, cmsgptr)) {
+        if (cmsgptr->cmsg_level == SOL_UDP && cmsgptr->cmsg_type == UDP_GRO) {
+            *seg_size = *((int *) CMSG_DATA(cmsgptr));
+            break;
         }
-        *afi = AF_INET6;
     }
 
     return (GOOD);
@@ -20,6 +20,7 @@
 #ifndef SOCKETS_H_
 #define SOCKETS_H_
 
+#include <sys/epoll.h>
 #include "../defs.h"
 #include "sockets-util.h"
 #include "packets.h"
@@ -27,11 +28,26 @@
 #include "lbuf.h"
 
 
+/* Maximum number of packets read with a single sock_data_recv_mmsg call */
+#define SOCK_MMSG_MAX_VLEN  64
+
 typedef enum {
     SOCK_READ,
     SOCK_WRITE,
 } sock_type_e;
 
+/* Order in which the ready sockets are processed. Control sockets should
+ * never wait for the data sockets */
+typedef enum {
+    SOCK_PRIO_HIGH,
+    SOCK_PRIO_NORMAL,
+    SOCK_PRIO_LOW,
+    SOCK_PRIO_MAX
+} sock_prio_e;
+
+/* Maximum number of ready sockets returned by a single epoll_wait call */
+#define SOCKMSTR_MAX_EVENTS 64
+
 /*
  * inspired by quagga thread.c
  * It might be a little bit of an overkill for now
@@ -43,11 +59,11 @@ typedef struct sock_list {
     struct sock *head;
     struct sock *tail;
     int count;
-    int maxfd;
 }sock_list_t;
 
 typedef struct sock {
     sock_type_e type;
+    sock_prio_e prio;
     int (*recv_cb)(struct sock *);
     void *arg;
     int fd;
@@ -65,11 +81,10 @@ typedef struct uconn {
 
 typedef struct sockmstr {
     sock_list_t read;
-//    struct sock_list *write;
-//    struct sock_list *netlink;
-    fd_set readfds;
-//    fd_set *writefds;
-//    fd_set *netlinkfds;
+    int epoll_fd;
+    /* Sockets ready to be processed obtained in the last wait */
+    struct epoll_event events[SOCKMSTR_MAX_EVENTS];
+    int nevents;
 } sockmstr_t;
 
 union sockunion {
@@ -77,6 +92,13 @@ union sockunion {
     struct sockaddr_in6 s6;
 };
 
+/* Information of a received data packet obtained from the ancillary data */
+typedef struct sock_data_inf {
+    int afi;
+    uint8_t ttl;
+    uint8_t tos;
+} sock_data_inf_t;
+
 
 typedef struct iface iface_t;
 
@@ -86,6 +108,8 @@ sock_t *sockmstr_register_get_by_fd(sockmstr_t *m, int fd);
 sock_t *sockmstr_register_get_by_bind_port (sockmstr_t *m, int afi, uint16_t port);
 sock_t *sockmstr_register_read_listener(sockmstr_t *m,
         int (*)(struct sock *), void *arg, int fd);
+sock_t *sockmstr_register_read_listener_prio(sockmstr_t *m,
+        int (*)(struct sock *), void *arg, int fd, sock_prio_e prio);
 int sock_fd(struct sock * sock);
 int sockmstr_unregister_read_listenedr(sockmstr_t *m, struct sock *sock);
 void sockmstr_process_all(sockmstr_t *m);
@@ -93,11 +117,14 @@ void sockmstr_wait_on_all_read(sockmstr_t *m);
 
 int open_data_raw_input_socket(int afi, uint16_t port);
 int open_data_datagram_input_socket(int afi, int port);
+int open_data_reuseport_input_socket(int afi, int port);
 int open_control_input_socket(int afi);
 
 int sock_recv(int, lbuf_t *);
 int sock_ctrl_recv(int, lbuf_t *, uconn_t *);
 int sock_data_recv(int sock, lbuf_t *b, int *afi, uint8_t *ttl, uint8_t *tos);
+int sock_data_recv_mmsg(int sock, lbuf_t *bufs, sock_data_inf_t *inf, int vlen);
+int sock_data_recv_gro(int sock, lbuf_t *b, sock_data_inf_t *inf, int *seg_size);
 int uconn_init(uconn_t *uc, int lp, int rp, lisp_addr_t *la,
         lisp_addr_t *ra);
 
@@ -0,0 +1,509 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <errno.h>
+#include <time.h>
+
+#include "static_map_cache.h"
+#include "oor_log.h"
+#include "shash.h"
+
+/* Initial number of elements of the arrays */
+#define STATIC_MCACHE_INIT_SIZE     1024
+/* Maximum number of locators of a prefix */
+#define STATIC_MCACHE_MAX_LOCTS     32
+/* Maximum number of nested prefixes: one per prefix length */
+#define STATIC_MCACHE_MAX_DEPTH     (128 + 1)
+#define STATIC_MCACHE_DELIMS        " \t\r\n"
+
+
+static void *static_mcache_grow(void *array, uint32_t *size, size_t elt_size);
+static int static_mcache_parse_eid(char *str, uint32_t *iid, ip_addr_t *ip,
+        uint8_t *plen);
+static int static_mcache_parse_num(char *str, long min, long max, int *val);
+static int static_mcache_parse_line(static_mcache_t *smc, shash_t *locsets_ht,
+        char *line, int rloc_afi);
+static uint32_t static_mcache_add_locset(static_mcache_t *smc,
+        shash_t *locsets_ht, static_mcache_loct_t *locts, int nlocts);
+static void static_mcache_add_entry(static_mcache_table_t *table, uint32_t iid,
+        ip_addr_t *ip, uint8_t plen, uint32_t locset);
+static int static_mcache_entry_cmp(const void *a, const void *b);
+static void static_mcache_sort_table(static_mcache_table_t *table);
+
+
+static_mcache_t *
+static_mcache_new()
+{
+    return (xzalloc(sizeof(static_mcache_t)));
+}
+
+void
+static_mcache_del(static_mcache_t *smc)
+{
+    if (!smc){
+        return;
+    }
+    free(smc->v4.entries);
+    free(smc->v6.entries);
+    free(smc->locsets);
+    free(smc->locts);
+    free(smc);
+}
+
+static void *
+static_mcache_grow(void *array, uint32_t *size, size_t elt_size)
+{
+    *size = *size ? *size * 2 : STATIC_MCACHE_INIT_SIZE;
+    return (xrealloc(array, *size * elt_size));
+}
+
+/* Compare the first plen bits of two addresses */
+static inline int
+static_mcache_pref_match(uint8_t *pref, uint8_t *addr, uint8_t plen)
+{
+    uint8_t bytes = plen / 8;
+    uint8_t mask;
+
+    if (memcmp(pref, addr, bytes) != 0){
+        return (FALSE);
+    }
+    if (plen % 8 == 0){
+        return (TRUE);
+    }
+    mask = 0xff << (8 - plen % 8);
+    return ((pref[bytes] & mask) == (addr[bytes] & mask));
+}
+
+/* Compare the start of an entry with an address */
+static inline int
+static_mcache_start_cmp(static_mcache_entry_t *entry, uint32_t iid,
+        uint8_t *addr, uint8_t addr_len)
+{
+    if (entry->iid != iid){
+        return (entry->iid < iid ? -1 : 1);
+    }
+    return (memcmp(entry->addr, addr, addr_len));
+}
+
+/* Parse an EID prefix of the form [iid]prefix/length or prefix/length */
+static int
+static_mcache_parse_eid(char *str, uint32_t *iid, ip_addr_t *ip, uint8_t *plen)
+{
+    char *end, *mask;
+    long val;
+
+    *iid = 0;
+    if (*str == '['){
+        val = strtol(str + 1, &end, 10);
+        if (*end != ']' || val < 0 || val > MAX_IID){
+            return (BAD);
+        }
+        *iid = val;
+        str = end + 1;
+    }
+    if ((mask = strchr(str, '/')) == NULL){
+        return (BAD);
+    }
+    *mask++ = '\0';
+    if (ip_addr_from_char(str, ip) != GOOD){
+        return (BAD);
+    }
+    val = strtol(mask, &end, 10);
+    if (*end != '\0' || val < 0 || val > ip_addr_get_size(ip) * 8){
+        return (BAD);
+    }
+    *plen = val;
+
+    return (GOOD);
+}
+
+/* Parse a decimal number in the range [min, max] */
+static int
+static_mcache_parse_num(char *str, long min, long max, int *val)
+{
+    char *end;
+    long num;
+
+    errno = 0;
+    num = strtol(str, &end, 10);
+    if (end == str || *end != '\0' || errno != 0 || num < min || num > max){
+        return (BAD);
+    }
+    *val = num;
+
+    return (GOOD);
+}
+
+/* Parse a line of the file: EID prefix followed by the address, priority and
+ * weight of each locator. Empty lines and comments are ignored. Returns
+ * ERR_NO_EXIST if no locator of the prefix is left */
+static int
+static_mcache_parse_line(static_mcache_t *smc, shash_t *locsets_ht, char *line,
+        int rloc_afi)
+{
+    static_mcache_loct_t locts[STATIC_MCACHE_MAX_LOCTS];
+    ip_addr_t eid;
+    char *save, *token, *prio, *weight;
+    uint32_t iid, locset;
+    uint8_t plen;
+    int nlocts = 0, p, w, i;
+
+    token = strtok_r(line, STATIC_MCACHE_DELIMS, &save);
+    if (!token || *token == '#'){
+        return (GOOD);
+    }
+    if (static_mcache_parse_eid(token, &iid, &eid, &plen) != GOOD){
+        return (BAD);
+    }
+
+    while ((token = strtok_r(NULL, STATIC_MCACHE_DELIMS, &save)) != NULL){
+        prio = strtok_r(NULL, STATIC_MCACHE_DELIMS, &save);
+        weight = strtok_r(NULL, STATIC_MCACHE_DELIMS, &save);
+        if (!weight || nlocts == STATIC_MCACHE_MAX_LOCTS){
+            return (BAD);
+        }
+        if (ip_addr_from_char(token, &locts[nlocts].addr) != GOOD){
+            return (BAD);
+        }
+        if (static_mcache_parse_num(prio, MAX_PRIORITY, UNUSED_RLOC_PRIORITY, &p) != GOOD
+                || static_mcache_parse_num(weight, MIN_WEIGHT, MAX_WEIGHT, &w) != GOOD){
+            return (BAD);
+        }
+        /* Remove locators not compatibles with default RLOC */
+        if (rloc_afi != AF_UNSPEC && ip_addr_afi(&locts[nlocts].addr) != rloc_afi){
+            continue;
+        }
+        for (i = 0; i < nlocts; i++){
+            if (ip_addr_afi(&locts[i].addr) == ip_addr_afi(&locts[nlocts].addr)
+                    && memcmp(ip_addr_get_addr(&locts[i].addr),
+                            ip_addr_get_addr(&locts[nlocts].addr),
+                            ip_addr_get_size(&locts[i].addr)) == 0){
+                break;
+            }
+        }
+        if (i < nlocts){
+            OOR_LOG(LDBG_1, "static_mcache_parse_line: Duplicated RLOC %s. "
+                    "Discarded ...", ip_addr_to_char(&locts[nlocts].addr));
+            continue;
+        }
+        locts[nlocts].priority = p;
+        locts[nlocts].weight = w;
+        nlocts++;
+    }
+    if (nlocts == 0){
+        return (ERR_NO_EXIST);
+    }
+
+    locset = static_mcache_add_locset(smc, locsets_ht, locts, nlocts);
+    static_mcache_add_entry(ip_addr_afi(&eid) == AF_INET ? &smc->v4 : &smc->v6,
+            iid, &eid, plen, locset);
+
+    return (GOOD);
+}
+
+/* Return the position of the locator set with the locators, adding it if
+ * there is no prefix using it yet. The key of the index of the sets is its
+ * text representation */
+static uint32_t
+static_mcache_add_locset(static_mcache_t *smc, shash_t *locsets_ht,
+        static_mcache_loct_t *locts, int nlocts)
+{
+    char key[STATIC_MCACHE_MAX_LOCTS * (INET6_ADDRSTRLEN + 10)];
+    static_mcache_locset_t *locset;
+    size_t len = 0;
+    void *val;
+    int i;
+
+    key[0] = '\0';
+    for (i = 0; i < nlocts; i++){
+        len += snprintf(key + len, sizeof(key) - len, "%s %u %u;",
+                ip_addr_to_char(&locts[i].addr), locts[i].priority,
+                locts[i].weight);
+    }
+    /* The value is the position of the set plus one */
+    if ((val = shash_lookup(locsets_ht, key)) != NULL){
+        return ((uint32_t)((uintptr_t)val - 1));
+    }
+
+    if (smc->nlocsets == smc->locsets_size){
+        smc->locsets = static_mcache_grow(smc->locsets, &smc->locsets_size,
+                sizeof(static_mcache_locset_t));
+    }
+    while (smc->nlocts + nlocts > smc->locts_size){
+        smc->locts = static_mcache_grow(smc->locts, &smc->locts_size,
+                sizeof(static_mcache_loct_t));
+    }
+    locset = &smc->locsets[smc->nlocsets];
+    locset->first = smc->nlocts;
+    locset->nlocts = nlocts;
+    memcpy(&smc->locts[smc->nlocts], locts, nlocts * sizeof(static_mcache_loct_t));
+    smc->nlocts += nlocts;
+    shash_insert(locsets_ht, strdup(key), (void *)(uintptr_t)(smc->nlocsets + 1));
+
+    return (smc->nlocsets++);
+}
+
+static void
+static_mcache_add_entry(static_mcache_table_t *table, uint32_t iid,
+        ip_addr_t *ip, uint8_t plen, uint32_t locset)
+{
+    static_mcache_entry_t *entry;
+    uint8_t bytes;
+
+    if (table->nentries == table->size){
+        table->entries = static_mcache_grow(table->entries, &table->size,
+                sizeof(static_mcache_entry_t));
+    }
+    entry = &table->entries[table->nentries++];
+    memset(entry, 0, sizeof(static_mcache_entry_t));
+    memcpy(entry->addr, ip_addr_get_addr(ip), ip_addr_get_size(ip));
+    /* Keep only the network part of the address */
+    bytes = plen / 8;
+    if (plen % 8 != 0){
+        entry->addr[bytes] &= 0xff << (8 - plen % 8);
+        bytes++;
+    }
+    memset(entry->addr + bytes, 0, sizeof(entry->addr) - bytes);
+    entry->iid = iid;
+    entry->plen = plen;
+    entry->locset = locset;
+}
+
+/* Order by IID, address and length. Duplicated prefixes are ordered by
+ * position in the file, stored in the parent field while sorting */
+static int
+static_mcache_entry_cmp(const void *a, const void *b)
+{
+    const static_mcache_entry_t *e1 = a, *e2 = b;
+    int res;
+
+    if (e1->iid != e2->iid){
+        return (e1->iid < e2->iid ? -1 : 1);
+    }
+    if ((res = memcmp(e1->addr, e2->addr, sizeof(e1->addr))) != 0){
+        return (res);
+    }
+    if (e1->plen != e2->plen){
+        return (e1->plen < e2->plen ? -1 : 1);
+    }
+    return (e1->parent < e2->parent ? -1 : 1);
+}
+
+/* Sort the table, keep the last one of the duplicated prefixes and link each
+ * prefix with the longest prefix covering it */
+static void
+static_mcache_sort_table(static_mcache_table_t *table)
+{
+    static_mcache_entry_t *entries = table->entries, *cur;
+    uint32_t stack[STATIC_MCACHE_MAX_DEPTH];
+    uint32_t i, n = 0;
+    int depth = 0;
+
+    for (i = 0; i < table->nentries; i++){
+        entries[i].parent = i;
+    }
+    qsort(entries, table->nentries, sizeof(static_mcache_entry_t),
+            static_mcache_entry_cmp);
+
+    for (i = 0; i < table->nentries; i++){
+        if (i + 1 < table->nentries && entries[i].iid == entries[i + 1].iid
+                && entries[i].plen == entries[i + 1].plen
+                && memcmp(entries[i].addr, entries[i + 1].addr,
+                        sizeof(entries[i].addr)) == 0){
+            continue;
+        }
+        entries[n++] = entries[i];
+    }
+    if (n != table->nentries){
+        OOR_LOG(LWRN, "Static map cache: %u duplicated prefixes. Using the last "
+                "entry of each one", table->nentries - n);
+    }
+    table->nentries = n;
+
+    /* The prefixes covering an entry are before it, in the stack */
+    for (i = 0; i < n; i++){
+        cur = &entries[i];
+        while (depth > 0 && (entries[stack[depth - 1]].iid != cur->iid
+                || !static_mcache_pref_match(entries[stack[depth - 1]].addr,
+                        cur->addr, entries[stack[depth - 1]].plen))){
+            depth--;
+        }
+        cur->parent = depth > 0 ? stack[depth - 1] : STATIC_MCACHE_NONE;
+        stack[depth++] = i;
+    }
+
+    /* The table doesn't grow anymore */
+    table->entries = xrealloc(table->entries, n * sizeof(static_mcache_entry_t));
+    table->size = n;
+}
+
+/* Load the prefixes of a static map cache file. Locators of a different AFI
+ * than rloc_afi are discarded, unless it is AF_UNSPEC. Each line of the file
+ * has the format:
+ *    [iid]eid-prefix/length rloc priority weight [rloc priority weight ...]
+ * The prefixes with the same locators share the locator set */
+int
+static_mcache_load_file(static_mcache_t *smc, char *file, int rloc_afi)
+{
+    struct timespec start, end;
+    shash_t *locsets_ht;
+    FILE *fp;
+    char *line = NULL;
+    size_t line_size = 0;
+    uint32_t nline = 0, nerrors = 0;
+    long msecs;
+
+    if ((fp = fopen(file, "r")) == NULL){
+        OOR_LOG(LERR, "static_mcache_load_file: Couldn't open %s: %s", file,
+                strerror(errno));
+        return (BAD);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    locsets_ht = shash_new();
+    while (getline(&line, &line_size, fp) != -1){
+        nline++;
+        switch (static_mcache_parse_line(smc, locsets_ht, line, rloc_afi)){
+        case GOOD:
+            break;
+        case ERR_NO_EXIST:
+            OOR_LOG(LWRN, "Static map cache file %s: No valid locators for the "
+                    "prefix in line %u. Discarded ...", file, nline);
+            nerrors++;
+            break;
+        default:
+            OOR_LOG(LERR, "Static map cache file %s: Wrong entry in line %u. "
+                    "Discarded ...", file, nline);
+            nerrors++;
+        }
+    }
+    free(line);
+    fclose(fp);
+    shash_destroy(locsets_ht);
+
+    static_mcache_sort_table(&smc->v4);
+    static_mcache_sort_table(&smc->v6);
+    smc->locsets = xrealloc(smc->locsets, smc->nlocsets * sizeof(static_mcache_locset_t));
+    smc->locsets_size = smc->nlocsets;
+    smc->locts = xrealloc(smc->locts, smc->nlocts * sizeof(static_mcache_loct_t));
+    smc->locts_size = smc->nlocts;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    msecs = (end.tv_sec - start.tv_sec) * 1000
+            + (end.tv_nsec - start.tv_nsec) / 1000000;
+    OOR_LOG(LINF, "Static map cache file %s loaded in %ld ms: %u prefixes, "
+            "%u locator sets, %u locators, %u discarded lines, %zu KB", file,
+            msecs, static_mcache_nentries(smc), smc->nlocsets, smc->nlocts,
+            nerrors, static_mcache_mem_size(smc) / 1024);
+
+    return (GOOD);
+}
+
+/* Longest prefix of the table matching the address. The entry found is the
+ * last one starting before the address or one of the prefixes covering it */
+static_mcache_entry_t *
+static_mcache_lookup(static_mcache_t *smc, uint32_t iid, ip_addr_t *ip)
+{
+    static_mcache_table_t *table;
+    static_mcache_entry_t *entry;
+    uint8_t *addr = ip_addr_get_addr(ip);
+    uint8_t addr_len = ip_addr_get_size(ip);
+    uint32_t lo = 0, hi, mid, pos;
+
+    table = ip_addr_afi(ip) == AF_INET ? &smc->v4 : &smc->v6;
+    hi = table->nentries;
+    while (lo < hi){
+        mid = lo + (hi - lo) / 2;
+        if (static_mcache_start_cmp(&table->entries[mid], iid, addr, addr_len) <= 0){
+            lo = mid + 1;
+        }else{
+            hi = mid;
+        }
+    }
+    if (lo == 0){
+        return (NULL);
+    }
+
+    for (pos = lo - 1; pos != STATIC_MCACHE_NONE; pos = entry->parent){
+        entry = &table->entries[pos];
+        if (entry->iid != iid){
+            return (NULL);
+        }
+        if (static_mcache_pref_match(entry->addr, addr, entry->plen)){
+            return (entry);
+        }
+    }
+    return (NULL);
+}
+
+/* Create the mapping of an entry of the table of the afi */
+mapping_t *
+static_mcache_entry_mapping(static_mcache_t *smc, static_mcache_entry_t *entry,
+        int afi)
+{
+    static_mcache_locset_t *locset = &smc->locsets[entry->locset];
+    static_mcache_loct_t *loct;
+    mapping_t *mapping;
+    locator_t *locator;
+    lisp_addr_t ippref, addr, *eid;
+    ip_addr_t ip;
+    uint32_t i;
+
+    ip_addr_init(&ip, entry->addr, afi);
+    lisp_addr_init_from_ippref(&ippref, &ip, entry->plen);
+    if (entry->iid > 0){
+        eid = lisp_addr_new_init_iid(entry->iid, &ippref,
+                afi == AF_INET ? 32 : 128);
+        mapping = mapping_new_init(eid);
+        lisp_addr_del(eid);
+    }else{
+        mapping = mapping_new_init(&ippref);
+    }
+    if (!mapping){
+        return (NULL);
+    }
+
+    for (i = 0; i < locset->nlocts; i++){
+        loct = &smc->locts[locset->first + i];
+        lisp_addr_init_from_ip(&addr, &loct->addr);
+        locator = locator_new_init(&addr, UP, 1, 1, loct->priority,
+                loct->weight, 255, 0);
+        if (!locator || mapping_add_locator(mapping, locator) != GOOD){
+            locator_del(locator);
+        }
+    }
+
+    return (mapping);
+}
+
+size_t
+static_mcache_mem_size(static_mcache_t *smc)
+{
+    return (sizeof(static_mcache_t)
+            + (smc->v4.size + smc->v6.size) * sizeof(static_mcache_entry_t)
+            + smc->locsets_size * sizeof(static_mcache_locset_t)
+            + smc->locts_size * sizeof(static_mcache_loct_t));
+}
+
+/*
+ * Editor modelines
+ *
+ * vi: set shiftwidth=4 tabstop=4 expandtab:
+ * :indentSize=4:tabSize=4:noTabs=true:
+ */
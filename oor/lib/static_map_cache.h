@@ -0,0 +1,88 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef STATIC_MAP_CACHE_H_
+#define STATIC_MAP_CACHE_H_
+
+#include "../liblisp/lisp_mapping.h"
+
+/* Position used when there is no entry */
+#define STATIC_MCACHE_NONE      UINT32_MAX
+
+/* Locator of a locator set. The locators of a set are consecutive in the
+ * array of locators */
+typedef struct static_mcache_loct_ {
+    ip_addr_t addr;
+    uint8_t priority;
+    uint8_t weight;
+} static_mcache_loct_t;
+
+/* Locator set shared by all the prefixes with the same locators */
+typedef struct static_mcache_locset_ {
+    uint32_t first;
+    uint32_t nlocts;
+} static_mcache_locset_t;
+
+typedef struct static_mcache_entry_ {
+    /* Network address of the prefix. Only the first bytes are used by IPv4 */
+    uint8_t addr[sizeof(struct in6_addr)];
+    uint32_t iid;
+    uint32_t locset;
+    /* Position of the longest prefix of the table covering it */
+    uint32_t parent;
+    uint8_t plen;
+} static_mcache_entry_t;
+
+/* Prefixes of an AFI sorted by IID, address and length */
+typedef struct static_mcache_table_ {
+    static_mcache_entry_t *entries;
+    uint32_t nentries;
+    uint32_t size;
+} static_mcache_table_t;
+
+/* Compact storage of large static map caches loaded from a file. The map cache
+ * entries of the prefixes are only created when they are used to forward
+ * traffic. Once loaded, the prefixes can't be modified */
+typedef struct static_mcache_ {
+    static_mcache_table_t v4;
+    static_mcache_table_t v6;
+    static_mcache_locset_t *locsets;
+    uint32_t nlocsets;
+    uint32_t locsets_size;
+    static_mcache_loct_t *locts;
+    uint32_t nlocts;
+    uint32_t locts_size;
+} static_mcache_t;
+
+static_mcache_t *static_mcache_new();
+void static_mcache_del(static_mcache_t *smc);
+int static_mcache_load_file(static_mcache_t *smc, char *file, int rloc_afi);
+static_mcache_entry_t *static_mcache_lookup(static_mcache_t *smc, uint32_t iid,
+        ip_addr_t *ip);
+mapping_t *static_mcache_entry_mapping(static_mcache_t *smc,
+        static_mcache_entry_t *entry, int afi);
+size_t static_mcache_mem_size(static_mcache_t *smc);
+
+static inline uint32_t
+static_mcache_nentries(static_mcache_t *smc)
+{
+    return (smc->v4.nentries + smc->v6.nentries);
+}
+
+#endif /* STATIC_MAP_CACHE_H_ */
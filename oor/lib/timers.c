@@ -18,9 +18,7 @@
  */
 
 #include <errno.h>
-#include <fcntl.h>
-#include <signal.h>
-#include <sys/time.h>
+#include <sys/timerfd.h>
 #include <time.h>
 
 #include "oor_log.h"
@@ -30,35 +28,91 @@
 #include "../oor_external.h"
 
 
-/* Seconds */
-#define TICK_INTERVAL 1
+/* Milliseconds */
+#define TICK_INTERVAL_MS 10
 
-/* Good for a little over an hour */
-#define WHEEL_SIZE 4096
+/* Hierarchical wheel: the first level has one slot per tick and each of the
+ * upper levels has slots covering the whole range of the level below. With
+ * a tick of 10 ms it is good for more than a year */
+#define TVR_BITS 8
+#define TVN_BITS 6
+#define TVR_SIZE (1 << TVR_BITS)
+#define TVN_SIZE (1 << TVN_BITS)
+#define TVR_MASK (TVR_SIZE - 1)
+#define TVN_MASK (TVN_SIZE - 1)
+#define TVN_LEVELS 4
+#define MAX_TIMER_TICKS ((1ULL << (TVR_BITS + TVN_LEVELS * TVN_BITS)) - 1)
 
 struct timer_wheel_{
-    int num_spokes;
-    int current_spoke;
-    oor_timer_links_t *spokes;
-    timer_t tick_timer_id;
+    /* Next tick to be processed */
+    uint64_t current_tick;
+    oor_timer_links_t tv1[TVR_SIZE];
+    oor_timer_links_t tvn[TVN_LEVELS][TVN_SIZE];
+    int initialized;
     int running_timers;
     int expirations;
-} timer_wheel = {.spokes=NULL};
-
-/* We don't have signalfd in bionic, fake it. */
-static int signal_pipe[2];
-
-static timer_t timer_id;
+} timer_wheel = {.initialized = FALSE};
 
 /* timers file descriptor */
-int timers_fd = 0;
+static int timers_fd = ERR_SOCKET;
 
 static int destroy_timers_event_socket();
 static int build_timers_event_socket(int *timers_fd);
-static int process_timer_signal(sock_t *sl);
+static int process_timer_event(sock_t *sl);
 static void handle_timers(void);
 
 
+static inline void
+timer_links_init(oor_timer_links_t *head)
+{
+    head->next = head;
+    head->prev = head;
+}
+
+/* Append the timer to the list of a slot */
+static inline void
+timer_links_append(oor_timer_links_t *head, oor_timer_t *tptr)
+{
+    oor_timer_links_t *prev = head->prev;
+
+    tptr->links.next = head;
+    tptr->links.prev = prev;
+    prev->next = &tptr->links;
+    head->prev = &tptr->links;
+}
+
+/* Unlink the timer from the list it belongs to */
+static inline void
+timer_links_remove(oor_timer_t *tptr)
+{
+    oor_timer_links_t *next = tptr->links.next;
+    oor_timer_links_t *prev = tptr->links.prev;
+
+    if (next != NULL) {
+        next->prev = prev;
+    }
+    if (prev != NULL) {
+        prev->next = next;
+    }
+    tptr->links.next = NULL;
+    tptr->links.prev = NULL;
+}
+
+/* Move all the timers of the list src to the empty list dst */
+static inline void
+timer_links_splice(oor_timer_links_t *dst, oor_timer_links_t *src)
+{
+    if (src->next == src) {
+        timer_links_init(dst);
+        return;
+    }
+    dst->next = src->next;
+    dst->prev = src->prev;
+    dst->next->prev = dst;
+    dst->prev->next = dst;
+    timer_links_init(src);
+}
+
 /*
  * create_timer_wheel()
  *
@@ -68,27 +122,32 @@ static void handle_timers(void);
 static int
 create_timer_wheel(void)
 {
-    //timer_t tid;
-    struct sigevent sev;
     struct itimerspec timerspec;
-    sev.sigev_notify = SIGEV_SIGNAL;
-    sev.sigev_signo = SIGRTMIN;
-    sev.sigev_value.sival_ptr = &timer_id;
-    if (timer_create(CLOCK_MONOTONIC, &sev, &timer_id) == -1) {
-        OOR_LOG(LINF, "timer_create(): %s", strerror(errno));
-        return (BAD);
+    int i, j;
+
+    timer_wheel.current_tick = 0;
+    timer_wheel.running_timers = 0;
+    timer_wheel.expirations = 0;
+    for (i = 0; i < TVR_SIZE; i++) {
+        timer_links_init(&timer_wheel.tv1[i]);
+    }
+    for (i = 0; i < TVN_LEVELS; i++) {
+        for (j = 0; j < TVN_SIZE; j++) {
+            timer_links_init(&timer_wheel.tvn[i][j]);
+        }
     }
 
-    timerspec.it_value.tv_nsec = 0;
-    timerspec.it_value.tv_sec = TICK_INTERVAL;
-    timerspec.it_interval.tv_nsec = 0;
-    timerspec.it_interval.tv_sec = TICK_INTERVAL;
+    timerspec.it_value.tv_sec = 0;
+    timerspec.it_value.tv_nsec = TICK_INTERVAL_MS * 1000000;
+    timerspec.it_interval.tv_sec = 0;
+    timerspec.it_interval.tv_nsec = TICK_INTERVAL_MS * 1000000;
 
-    if (timer_settime(timer_id, 0, &timerspec, NULL) == -1) {
-        OOR_LOG(LINF, "create_wheel_timer: timer start failed for %d %s",
-                timer_id, strerror(errno));
+    if (timerfd_settime(timers_fd, 0, &timerspec, NULL) == -1) {
+        OOR_LOG(LINF, "create_wheel_timer: timer start failed: %s",
+                strerror(errno));
         return (BAD);
     }
+    timer_wheel.initialized = TRUE;
 
     return(GOOD);
 }
@@ -98,14 +157,11 @@ create_timer_wheel(void)
 int
 oor_timers_init()
 {
-    int i = 0;
-    oor_timer_links_t *spoke;
-
     OOR_LOG(LDBG_1, "Initializing lmtimers...");
 
     /* create timers event socket */
-    if (build_timers_event_socket(&timers_fd) == 0) {
-        OOR_LOG(LCRIT, " Error programming the timer signal. Exiting...");
+    if (build_timers_event_socket(&timers_fd) != GOOD) {
+        OOR_LOG(LCRIT, " Error programming the timers. Exiting...");
         return(BAD);
     }
 
@@ -114,35 +170,34 @@ oor_timers_init()
         return(BAD);
     }
 
-    timer_wheel.num_spokes = WHEEL_SIZE;
-    timer_wheel.spokes = xmalloc(sizeof(oor_timer_links_t) * WHEEL_SIZE);
-    timer_wheel.current_spoke = 0;
-    timer_wheel.running_timers = 0;
-    timer_wheel.expirations = 0;
-
-    spoke = &timer_wheel.spokes[0];
-    for (i = 0; i < WHEEL_SIZE; i++) {
-        spoke->next = spoke;
-        spoke->prev = spoke;
-        spoke++;
-    }
-
-
     /* register timer fd with the socket master */
-    sockmstr_register_read_listener(smaster, process_timer_signal, NULL,
-            timers_fd);
+    sockmstr_register_read_listener_prio(smaster, process_timer_event, NULL,
+            timers_fd, SOCK_PRIO_HIGH);
 
     return(GOOD);
 }
 
+/* Stop all the timers of a slot */
+static void
+stop_spoke_timers(oor_timer_links_t *spoke)
+{
+    oor_timer_links_t *sit, *next;
+
+    /* the first link is NOT a timer */
+    sit = spoke->next;
+    while (sit != spoke){
+        next = sit->next;
+        oor_timer_stop(CONTAINER_OF(sit, oor_timer_t, links));
+        sit = next;
+    }
+}
+
 void
 oor_timers_destroy()
 {
-    int i;
-    oor_timer_links_t *spoke, *sit, *next;
-    oor_timer_t *t;
+    int i, j;
 
-    if (timer_wheel.spokes == NULL){
+    if (!timer_wheel.initialized){
         return;
     }
 
@@ -150,21 +205,15 @@ oor_timers_destroy()
 
     destroy_timers_event_socket();
 
-    spoke = &timer_wheel.spokes[0];
-    for (i = 0; i < WHEEL_SIZE; i++) {
-        /* the first link is NOT a timer */
-        sit = spoke->next;
-        while (sit != spoke){
-            next = sit->next;
-            t = CONTAINER_OF(sit, oor_timer_t, links);
-            oor_timer_stop(t);
-            sit = next;
+    for (i = 0; i < TVR_SIZE; i++) {
+        stop_spoke_timers(&timer_wheel.tv1[i]);
+    }
+    for (i = 0; i < TVN_LEVELS; i++) {
+        for (j = 0; j < TVN_SIZE; j++) {
+            stop_spoke_timers(&timer_wheel.tvn[i][j]);
         }
-        spoke++;
     }
-    free(timer_wheel.spokes);
-    timer_delete(timer_id);
-
+    timer_wheel.initialized = FALSE;
 }
 
 /*
@@ -217,36 +266,35 @@ oor_timer_nonces(oor_timer_t *timer)
     return (timer->nonces_lst);
 }
 
-/* Insert a timer in the wheel at the appropriate location. */
+/* Insert a timer in the wheel at the appropriate location. The level is
+ * selected with the ticks pending to expire the timer */
 static void
 insert_timer(oor_timer_t *tptr)
 {
-    oor_timer_links_t *prev, *spoke;
-    uint32_t pos;
-    uint32_t ticks;
-    uint32_t td;
-
-    /* Number of ticks for this timer. */
-    ticks = tptr->duration;
-
-    /* tick position, referenced from the
-     * current index. */
-    td = (ticks % timer_wheel.num_spokes);
-
-    /* Full rotations required before this timer expires */
-    tptr->rotation_count = (ticks / timer_wheel.num_spokes);
-
-    /* Find the right spoke, and link the timer into the list at this position */
-    pos = ((timer_wheel.current_spoke + td) % timer_wheel.num_spokes);
-    spoke = &timer_wheel.spokes[pos];
+    oor_timer_links_t *spoke;
+    uint64_t expires = tptr->expires;
+    uint64_t ticks = expires - timer_wheel.current_tick;
+    int level;
+
+    if (ticks < TVR_SIZE) {
+        spoke = &timer_wheel.tv1[expires & TVR_MASK];
+    } else {
+        if (ticks > MAX_TIMER_TICKS) {
+            expires = timer_wheel.current_tick + MAX_TIMER_TICKS;
+            tptr->expires = expires;
+            ticks = MAX_TIMER_TICKS;
+        }
+        for (level = 0; level < TVN_LEVELS - 1; level++) {
+            if (ticks < (1ULL << (TVR_BITS + (level + 1) * TVN_BITS))) {
+                break;
+            }
+        }
+        spoke = &timer_wheel.tvn[level][(expires >> (TVR_BITS + level * TVN_BITS))
+                                        & TVN_MASK];
+    }
 
     /* append to end of spoke  */
-    prev = spoke->prev;
-    tptr->links.next = spoke;
-    tptr->links.prev = prev;
-    prev->next = (oor_timer_links_t *) tptr;
-    spoke->prev = (oor_timer_links_t *) tptr;
-    return;
+    timer_links_append(spoke, tptr);
 }
 
 /*
@@ -259,23 +307,28 @@ insert_timer(oor_timer_t *tptr)
 void
 oor_timer_start(oor_timer_t *tptr, int sexpiry)
 {
-    oor_timer_links_t *next, *prev;
+    oor_timer_start_ms(tptr, sexpiry * 1000);
+}
 
-    /* See if this timer is also running. */
-    next = tptr->links.next;
+/* Start a timer expiring in msexpiry milliseconds. The expiration is rounded
+ * up to the resolution of the wheel */
+void
+oor_timer_start_ms(oor_timer_t *tptr, int msexpiry)
+{
+    uint64_t ticks;
 
-    if (next != NULL) {
-        prev = tptr->links.prev;
-        next->prev = prev;
-        prev->next = next;
+    /* See if this timer is also running. */
+    if (tptr->links.next != NULL) {
+        timer_links_remove(tptr);
 
         /* Update stats */
         timer_wheel.running_timers--;
     }
 
-    /* Hook up the callback  */
-
-    tptr->duration = sexpiry;
+    /* Ticks are counted from the last processed one */
+    ticks = msexpiry > 0 ? (msexpiry + TICK_INTERVAL_MS - 1) / TICK_INTERVAL_MS : 1;
+    tptr->duration = msexpiry;
+    tptr->expires = timer_wheel.current_tick - 1 + ticks;
     insert_timer(tptr);
 
     timer_wheel.running_timers++;
@@ -292,27 +345,16 @@ oor_timer_start(oor_timer_t *tptr, int sexpiry)
 void
 oor_timer_stop(oor_timer_t *tptr)
 {
-    oor_timer_links_t *next, *prev;
-
     if (tptr == NULL) {
         return;
     }
 
-    next = tptr->links.next;
-    prev = tptr->links.prev;
-    if (next != NULL) {
-        next->prev = prev;
-    }
-    if (prev != NULL) {
-        prev->next = next;
-    }
-    tptr->links.next = NULL;
-    tptr->links.prev = NULL;
-
     /* Update stats */
-    if (next != NULL || prev != NULL) {
+    if (tptr->links.next != NULL || tptr->links.prev != NULL) {
         timer_wheel.running_timers--;
     }
+    timer_links_remove(tptr);
+
     /* Free timer argument */
     if (tptr->del_arg_fn){
         tptr->del_arg_fn(tptr->cb_argument);
@@ -321,6 +363,26 @@ oor_timer_stop(oor_timer_t *tptr)
     free(tptr);
 }
 
+/* Move the timers of a slot of an upper level to the levels below. Returns
+ * the index of the slot */
+static int
+cascade_timers(int level)
+{
+    oor_timer_links_t list, *spoke;
+    oor_timer_t *tptr;
+    int index;
+
+    index = (timer_wheel.current_tick >> (TVR_BITS + level * TVN_BITS)) & TVN_MASK;
+    spoke = &timer_wheel.tvn[level][index];
+    timer_links_splice(&list, spoke);
+    while (list.next != &list) {
+        tptr = CONTAINER_OF(list.next, oor_timer_t, links);
+        timer_links_remove(tptr);
+        insert_timer(tptr);
+    }
+
+    return (index);
+}
 
 /*
  * handle_timers()
@@ -331,76 +393,61 @@ oor_timer_stop(oor_timer_t *tptr)
 static void
 handle_timers(void)
 {
-    struct timeval  nowtime;
-    oor_timer_links_t    *current_spoke, *next, *prev;
-    oor_timer_t          *tptr;
-    oor_timer_callback_t  callback;
-
-    gettimeofday(&nowtime, NULL);
-    timer_wheel.current_spoke = (timer_wheel.current_spoke + 1) % timer_wheel.num_spokes;
-    current_spoke = &timer_wheel.spokes[timer_wheel.current_spoke];
-
-    tptr = (oor_timer_t *)current_spoke->next;
-    while ((oor_timer_links_t *)tptr != current_spoke) {
-        next = tptr->links.next;
-        prev = tptr->links.prev;
-
-        if (tptr->rotation_count > 0) {
-            tptr->rotation_count--;
-        } else {
-
-            prev->next = next;
-            next->prev = prev;
-            tptr->links.next = NULL;
-            tptr->links.prev = NULL;
-
-            /* Update stats */
-            timer_wheel.running_timers--;
-            timer_wheel.expirations++;
-
-            callback = tptr->cb;
-            (*callback)(tptr);
+    oor_timer_links_t expired;
+    oor_timer_t *tptr;
+    oor_timer_callback_t callback;
+    int index, level;
+
+    index = timer_wheel.current_tick & TVR_MASK;
+    /* When the first level completes a rotation, the next slot of the
+     * upper levels is moved down */
+    if (index == 0) {
+        for (level = 0; level < TVN_LEVELS; level++) {
+            if (cascade_timers(level) != 0) {
+                break;
+            }
         }
-        /* We can not use directly "next" as it could be released  in the
-         *  callback function  previously to be used */
-        tptr = (oor_timer_t *)(prev->next);
+    }
+    timer_links_splice(&expired, &timer_wheel.tv1[index]);
+    timer_wheel.current_tick++;
+
+    /* The callback can stop or restart any timer, including the ones
+     * pending in the expired list */
+    while (expired.next != &expired) {
+        tptr = CONTAINER_OF(expired.next, oor_timer_t, links);
+        timer_links_remove(tptr);
+
+        /* Update stats */
+        timer_wheel.running_timers--;
+        timer_wheel.expirations++;
+
+        callback = tptr->cb;
+        (*callback)(tptr);
     }
 }
 
+/* Process all the ticks elapsed since the last event */
 static int
-process_timer_signal(sock_t *sl)
+process_timer_event(sock_t *sl)
 {
-    int sig;
+    uint64_t ticks;
     int bytes;
 
-    bytes = read(sl->fd, &sig, sizeof(sig));
+    bytes = read(sl->fd, &ticks, sizeof(ticks));
 
-    if (bytes != sizeof(sig)) {
-        OOR_LOG(LWRN, "process_event_signal(): nothing to read");
+    if (bytes != sizeof(ticks)) {
+        OOR_LOG(LWRN, "process_timer_event(): nothing to read");
         return(-1);
     }
 
-    if (sig == SIGRTMIN) {
+    while (ticks > 0) {
         handle_timers();
+        ticks--;
     }
     return(0);
 }
 
 
-
-/*
- * event_sig_handler
- *
- * Forward signal to the fd for handling in the event loop
- */
-static void event_sig_handler(int sig)
-{
-    if (write(signal_pipe[1], &sig, sizeof(sig)) != sizeof(sig)) {
-        OOR_LOG(LWRN, "write signal %d: %s", sig, strerror(errno));
-    }
-}
-
-
 /*
  * build_timer_event_socket
  *
@@ -413,57 +460,24 @@ static void event_sig_handler(int sig)
 static int
 build_timers_event_socket(int *timers_fd)
 {
-    int flags;
-    struct sigaction sa;
-
-    if (pipe(signal_pipe) == -1) {
-        OOR_LOG(LERR, "build_timers_event_socket: signal pipe setup failed %s",
+    *timers_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (*timers_fd == -1) {
+        OOR_LOG(LERR, "build_timers_event_socket: timerfd_create() failed %s",
                 strerror(errno));
+        *timers_fd = ERR_SOCKET;
         return (BAD);
     }
-    *timers_fd = signal_pipe[0];
 
-    if ((flags = fcntl(*timers_fd, F_GETFL, 0)) == -1) {
-        OOR_LOG(LERR, "build_timers_event_socket: fcntl() F_GETFL failed %s",
-                strerror(errno));
-        return (BAD);
-    }
-    if (fcntl(*timers_fd, F_SETFL, flags | O_NONBLOCK) == -1) {
-        OOR_LOG(LERR, "build_timers_event_socket: fcntl() set O_NONBLOCK failed "
-                "%s", strerror(errno));
-        return (BAD);
-    }
-
-    memset(&sa, 0, sizeof(sa));
-    sa.sa_handler = event_sig_handler;
-    sa.sa_flags = 0;
-    sigemptyset(&sa.sa_mask);
-
-    if (sigaction(SIGRTMIN, &sa, NULL) == -1) {
-        OOR_LOG(LERR, "build_timers_event_socket: sigaction() failed %s",
-                strerror(errno));
-        exit_cleanup();
-    }
     return(GOOD);
 }
 
 static int
 destroy_timers_event_socket()
 {
-    struct sigaction sa;
-
-    memset(&sa, 0, sizeof(sa));
-    sa.sa_handler = NULL;
-    sa.sa_flags = 0;
-    sigemptyset(&sa.sa_mask);
-
-    if (sigaction(SIGRTMIN, &sa, NULL) == -1) {
-        OOR_LOG(LERR, "destroy_timers_event_socket: sigaction() failed %s",
-                strerror(errno));
+    if (timers_fd != ERR_SOCKET){
+        close(timers_fd);
+        timers_fd = ERR_SOCKET;
     }
-
-    close(signal_pipe[0]);
-    close(signal_pipe[1]);
     return(GOOD);
 }
 
@@ -476,3 +490,13 @@ oor_timer_sleep(int sec)
     timeout.tv_nsec = 0;
     while (nanosleep(&timeout, &timeout) == -1 && errno == EINTR);
 }
+
+/* Monotonic time in microseconds */
+uint64_t
+oor_timer_clock_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
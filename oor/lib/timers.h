@@ -24,16 +24,19 @@
 
 typedef enum {
     EXPIRE_MAP_CACHE_TIMER,
+    REFRESH_MAP_CACHE_TIMER,
     MAP_REGISTER_TIMER,
     ENCAP_MAP_REGISTER_TIMER,
     MAP_REQUEST_RETRY_TIMER,
+    MAP_REQUEST_BATCH_TIMER,
     RLOC_PROBING_TIMER,
     SMR_TIMER,
     SMR_INV_RETRY_TIMER,
     INFO_REQUEST_TIMER,
     RE_UPSTREAM_JOIN_TIMER,
     RE_ITR_RESOLUTION_TIMER,
-    REG_SITE_EXPRY_TIMER
+    REG_SITE_EXPRY_TIMER,
+    TTABLE_AGING_TIMER
 } timer_type;
 
 #define TIMER_NAME_LEN          64
@@ -49,8 +52,10 @@ typedef void (*oor_timer_del_cb_arg_fn)(void *arg);
 
 typedef struct oor_timer {
     oor_timer_links_t links;
+    /* Milliseconds */
     int duration;
-    int rotation_count;
+    /* Tick of the wheel when the timer expires */
+    uint64_t expires;
     oor_timer_callback_t cb;
     oor_timer_del_cb_arg_fn del_arg_fn;
     void *cb_argument;
@@ -69,6 +74,7 @@ void oor_timer_init(oor_timer_t *new_timer, void *owner, oor_timer_callback_t cb
         void *arg, oor_timer_del_cb_arg_fn del_arg_fn, void *nonces_lst);
 
 void oor_timer_start(oor_timer_t *, int);
+void oor_timer_start_ms(oor_timer_t *, int);
 
 void oor_timer_stop(oor_timer_t *);
 
@@ -78,6 +84,7 @@ timer_type oor_timer_type(oor_timer_t *);
 void *oor_timer_nonces(oor_timer_t *);
 
 void oor_timer_sleep(int sec);
+uint64_t oor_timer_clock_us(void);
 
 
 #endif /*TIMERS_H_*/
@@ -0,0 +1,93 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "token_bucket.h"
+#include "../defs.h"
+
+
+/* The bucket starts full. Burst should be at least 1 */
+void
+token_bucket_init(token_bucket_t *tb, uint32_t rate, uint32_t burst,
+        uint64_t now)
+{
+    tb->rate = rate;
+    tb->burst = burst > 0 ? burst : 1;
+    tb->units = (uint64_t)tb->burst * TOKEN_BUCKET_UNIT;
+    tb->last = now;
+}
+
+void
+token_bucket_refill(token_bucket_t *tb, uint64_t now)
+{
+    uint64_t max = (uint64_t)tb->burst * TOKEN_BUCKET_UNIT;
+    uint64_t units;
+
+    if (now <= tb->last){
+        return;
+    }
+    /* rate tokens per second are rate units per ms */
+    units = (now - tb->last) / 1000 * tb->rate;
+    if (units == 0){
+        /* Keep the time of the last refill to not lose the fractions */
+        return;
+    }
+    tb->units = (tb->units + units > max) ? max : tb->units + units;
+    tb->last += units / tb->rate * 1000;
+    if (tb->units == max){
+        tb->last = now;
+    }
+}
+
+/* Return TRUE if there is a token available. The token is not consumed */
+int
+token_bucket_has_token(token_bucket_t *tb, uint64_t now)
+{
+    if (tb->rate == 0){
+        return (TRUE);
+    }
+    token_bucket_refill(tb, now);
+    return (tb->units >= TOKEN_BUCKET_UNIT);
+}
+
+void
+token_bucket_consume(token_bucket_t *tb)
+{
+    if (tb->rate == 0 || tb->units < TOKEN_BUCKET_UNIT){
+        return;
+    }
+    tb->units -= TOKEN_BUCKET_UNIT;
+}
+
+/* A full bucket is equivalent to a new one and can be released */
+int
+token_bucket_is_full(token_bucket_t *tb, uint64_t now)
+{
+    if (tb->rate == 0){
+        return (TRUE);
+    }
+    token_bucket_refill(tb, now);
+    return (tb->units == (uint64_t)tb->burst * TOKEN_BUCKET_UNIT);
+}
+
+/*
+ * Editor modelines
+ *
+ * vi: set shiftwidth=4 tabstop=4 expandtab:
+ * :indentSize=4:tabSize=4:noTabs=true:
+ */
@@ -0,0 +1,42 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef TOKEN_BUCKET_H_
+#define TOKEN_BUCKET_H_
+
+#include <stdint.h>
+
+/* Number of units of a token. Tokens are refilled with this granularity */
+#define TOKEN_BUCKET_UNIT   1000
+
+typedef struct token_bucket_ {
+    uint32_t rate;      /* Tokens added per second. 0 means no limit */
+    uint32_t burst;     /* Maximum number of tokens */
+    uint64_t units;     /* Available tokens (in TOKEN_BUCKET_UNITs) */
+    uint64_t last;      /* Time of the last refill (us) */
+} token_bucket_t;
+
+void token_bucket_init(token_bucket_t *tb, uint32_t rate, uint32_t burst,
+        uint64_t now);
+void token_bucket_refill(token_bucket_t *tb, uint64_t now);
+int token_bucket_has_token(token_bucket_t *tb, uint64_t now);
+void token_bucket_consume(token_bucket_t *tb);
+int token_bucket_is_full(token_bucket_t *tb, uint64_t now);
+
+#endif /* TOKEN_BUCKET_H_ */
@@ -117,7 +117,11 @@ lisp_msg_parse_eid_rec(lbuf_t *msg, lisp_addr_t *eid)
 {
     eid_record_hdr_t *hdr = lbuf_data(msg);
     int len = lisp_addr_parse(EID_REC_ADDR(hdr), eid);
-    lbuf_pull(msg, len);
+    if (len <= 0) {
+        return(BAD);
+    }
+    /* The next record starts after the header and the address */
+    lbuf_pull(msg, sizeof(eid_record_hdr_t) + len);
     lisp_addr_set_plen(eid, EID_REC_MLEN(hdr));
 
     return(GOOD);
@@ -791,6 +795,18 @@ lisp_data_encap(lbuf_t *b, int lp, int rp, lisp_addr_t *la, lisp_addr_t *ra, uin
     return(lbuf_data(b));
 }
 
+/* Prebuild the outer headers used by lisp_data_encap */
+int
+lisp_data_encap_tmpl_init(pkt_encap_tmpl_t *tmpl, int lp, int rp,
+        lisp_addr_t *la, lisp_addr_t *ra, uint32_t iid)
+{
+    lisp_data_hdr_t lhdr;
+
+    lisp_data_hdr_init(&lhdr, iid);
+    return (pkt_encap_tmpl_init(tmpl, &lhdr, sizeof(lisp_data_hdr_t), lp, rp,
+            lisp_addr_ip(la), lisp_addr_ip(ra)));
+}
+
 void *
 lisp_data_pull_hdr(lbuf_t *b)
 {
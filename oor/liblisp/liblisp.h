@@ -27,6 +27,7 @@
 #include "lisp_data.h"
 #include "../lib/generic_list.h"
 #include "../lib/lbuf.h"
+#include "../lib/packets.h"
 
 
 #define LISP_DATA_HDR_LEN       8
@@ -87,6 +88,8 @@ void *lisp_msg_pull_auth_field(lbuf_t *b);
 void *lisp_data_push_hdr(lbuf_t *b, uint32_t iid);
 void *lisp_data_pull_hdr(lbuf_t *b);
 void *lisp_data_encap(lbuf_t *, int, int, lisp_addr_t *, lisp_addr_t *, uint32_t);
+int lisp_data_encap_tmpl_init(pkt_encap_tmpl_t *tmpl, int lp, int rp,
+        lisp_addr_t *la, lisp_addr_t *ra, uint32_t iid);
 
 static inline glist_t *laddr_list_new();
 static inline void laddr_list_init(glist_t *);
@@ -29,6 +29,23 @@
 #define UNUSED_RLOC_PRIORITY 255
 #define MIN_WEIGHT 0
 #define MAX_WEIGHT 255
+/* Percentage of lost RLOC probes above which a remote locator is avoided by
+ * the forwarding policy while there are other locators to use */
+#define LOCATOR_MAX_LOSS 25
+
+/* Metrics obtained from the RLOC probes of a remote locator. They can be used
+ * by the forwarding policy to select the locators */
+typedef struct locator_probe_inf_ {
+    /* Time the last probe was sent (us) */
+    uint64_t last_probe;
+    /* Smoothed round trip time and its variation (us). 0 if not measured */
+    uint32_t srtt;
+    uint32_t rttvar;
+    /* Moving average of the lost probes (hundredths of percent) */
+    uint32_t loss;
+    /* Current interval between probes (ms) */
+    uint32_t interval;
+} locator_probe_inf_t;
 
 typedef struct locator {
     lisp_addr_t *addr;
@@ -40,6 +57,7 @@ typedef struct locator {
     uint8_t weight;
     uint8_t mpriority;
     uint8_t mweight;
+    locator_probe_inf_t probe_inf;
 } locator_t;
 
 
@@ -102,6 +120,28 @@ static inline uint8_t locator_mweight(locator_t *locator)
     return (locator->mweight);
 }
 
+static inline locator_probe_inf_t *locator_probe_inf(locator_t *locator)
+{
+    return (&locator->probe_inf);
+}
+
+/* Smoothed round trip time (us) of the RLOC probes. 0 if not measured */
+static inline uint32_t locator_rtt(locator_t *locator)
+{
+    return (locator->probe_inf.srtt);
+}
+
+/* Percentage of RLOC probes without reply */
+static inline uint8_t locator_loss(locator_t *locator)
+{
+    return ((locator->probe_inf.loss + 50) / 100);
+}
+
+static inline uint8_t locator_is_lossy(locator_t *locator)
+{
+    return (locator_loss(locator) > LOCATOR_MAX_LOSS);
+}
+
 static inline void locator_set_addr(locator_t *loc, lisp_addr_t *addr)
 {
     /* Addr is linked to corresponding interface address */
@@ -0,0 +1,274 @@
+/*
+ * Correctness check and benchmark of the longest prefix match index of the
+ * mapping databases. The same random prefixes are added to a database using
+ * only the patricia trees and to one with the multibit trie index enabled.
+ * Every lookup must return the same entry from both, before and after
+ * removing part of the prefixes, and the lookup time of each one is reported.
+ *
+ * Usage: lpm_bench [IPv4 prefixes] [IPv6 prefixes] [lookups]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lib/mapping_db.h"
+
+#define DEFAULT_V4_PREFIXES 1000000
+#define DEFAULT_V6_PREFIXES 1000000
+#define DEFAULT_LOOKUPS     1000000
+/* One of each REMOVE_RATIO prefixes is removed in the second round */
+#define REMOVE_RATIO        10
+
+int debug_level = 0;
+int daemonize = 0;
+
+typedef struct bench_prefix_ {
+    uint8_t addr[16];
+    uint8_t plen;
+    uint8_t added;
+} bench_prefix_t;
+
+/* Keeps the results alive so that the lookups are not optimized out */
+static volatile int sink;
+
+static double
+now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((double)ts.tv_sec * 1e9 + ts.tv_nsec);
+}
+
+static void
+random_bytes(uint8_t *buf, int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++) {
+        buf[i] = rand();
+    }
+}
+
+static void
+mask_addr(uint8_t *addr, int plen, int len)
+{
+    int i;
+
+    for (i = plen; i < len * 8; i++) {
+        addr[i / 8] &= ~(0x80 >> (i % 8));
+    }
+}
+
+/* Lengths similar to the ones of the Internet routing tables: mostly /24 (IPv4)
+ * and /48 (IPv6), with less specific prefixes covering them */
+static int
+random_plen(int afi)
+{
+    int r = rand() % 100;
+
+    if (afi == AF_INET) {
+        if (r < 55) {
+            return (24);
+        }
+        return (r < 95 ? 16 + rand() % 8 : 8 + rand() % 8);
+    }
+    if (r < 45) {
+        return (48);
+    }
+    return (r < 90 ? 32 + rand() % 33 : 16 + rand() % 16);
+}
+
+static void
+random_prefix(bench_prefix_t *pref, int afi)
+{
+    int len = afi == AF_INET ? 4 : 16;
+
+    memset(pref, 0, sizeof(bench_prefix_t));
+    random_bytes(pref->addr, len);
+    if (afi == AF_INET6) {
+        /* Global unicast space */
+        pref->addr[0] = 0x20 | (pref->addr[0] & 0x0f);
+    }
+    pref->plen = random_plen(afi);
+    mask_addr(pref->addr, pref->plen, len);
+}
+
+static void
+prefix_to_laddr(bench_prefix_t *pref, int afi, lisp_addr_t *laddr)
+{
+    ip_addr_t ip;
+
+    ip_addr_init(&ip, pref->addr, afi);
+    lisp_addr_init_from_ippref(laddr, &ip, pref->plen);
+}
+
+/* Addresses covered by one of the prefixes, or random ones to also look up
+ * addresses without match */
+static lisp_addr_t *
+random_lookups(bench_prefix_t *prefs, int nprefs, int nlookups, int afi)
+{
+    lisp_addr_t *addrs;
+    bench_prefix_t *pref;
+    uint8_t addr[16], host[16];
+    ip_addr_t ip;
+    int len = afi == AF_INET ? 4 : 16;
+    int i, j;
+
+    addrs = calloc(nlookups, sizeof(lisp_addr_t));
+    for (i = 0; i < nlookups; i++) {
+        random_bytes(host, len);
+        if (i % 4 != 0) {
+            pref = &prefs[rand() % nprefs];
+            memcpy(addr, pref->addr, len);
+            for (j = pref->plen; j < len * 8; j++) {
+                addr[j / 8] |= host[j / 8] & (0x80 >> (j % 8));
+            }
+        } else {
+            memcpy(addr, host, len);
+        }
+        ip_addr_init(&ip, addr, afi);
+        lisp_addr_init_from_ip(&addrs[i], &ip);
+    }
+    return (addrs);
+}
+
+static int
+check_lookups(mdb_t *pt_db, mdb_t *lpm_db, lisp_addr_t *addrs, int nlookups)
+{
+    int i, errors = 0;
+
+    for (i = 0; i < nlookups; i++) {
+        if (mdb_lookup_entry(pt_db, &addrs[i]) != mdb_lookup_entry(lpm_db, &addrs[i])) {
+            if (errors < 10) {
+                printf("  Different entry for %s\n", lisp_addr_to_char(&addrs[i]));
+            }
+            errors++;
+        }
+    }
+    return (errors);
+}
+
+static double
+bench_lookups(mdb_t *db, lisp_addr_t *addrs, int nlookups)
+{
+    double start;
+    int i, found = 0;
+
+    start = now_ns();
+    for (i = 0; i < nlookups; i++) {
+        if (mdb_lookup_entry(db, &addrs[i])) {
+            found++;
+        }
+    }
+    sink = found;
+    return ((now_ns() - start) / nlookups);
+}
+
+static int
+run(const char *name, int afi, int nprefs, int nlookups)
+{
+    bench_prefix_t *prefs;
+    lisp_addr_t *addrs, laddr;
+    mdb_t *pt_db, *lpm_db;
+    double start, pt_add, lpm_add;
+    int i, nadded = 0, errors;
+
+    printf("%s: %d prefixes, %d lookups\n", name, nprefs, nlookups);
+    prefs = calloc(nprefs, sizeof(bench_prefix_t));
+    for (i = 0; i < nprefs; i++) {
+        random_prefix(&prefs[i], afi);
+    }
+    pt_db = mdb_new();
+    lpm_db = mdb_new();
+    mdb_enable_lpm(lpm_db);
+
+    start = now_ns();
+    for (i = 0; i < nprefs; i++) {
+        prefix_to_laddr(&prefs[i], afi, &laddr);
+        mdb_add_entry(pt_db, &laddr, &prefs[i]);
+    }
+    pt_add = (now_ns() - start) / nprefs;
+    /* The entry of a duplicated random prefix is the first one added */
+    for (i = 0; i < nprefs; i++) {
+        prefix_to_laddr(&prefs[i], afi, &laddr);
+        prefs[i].added = mdb_lookup_entry_exact(pt_db, &laddr) == &prefs[i];
+        nadded += prefs[i].added;
+    }
+    start = now_ns();
+    for (i = 0; i < nprefs; i++) {
+        if (prefs[i].added) {
+            prefix_to_laddr(&prefs[i], afi, &laddr);
+            mdb_add_entry(lpm_db, &laddr, &prefs[i]);
+        }
+    }
+    lpm_add = (now_ns() - start) / nadded;
+    printf("  %d different prefixes. Insertion: patricia %.1f ns, patricia and "
+            "LPM index %.1f ns. LPM index memory: %zu KB\n", nadded, pt_add,
+            lpm_add, mdb_lpm_mem_size(lpm_db) / 1024);
+
+    addrs = random_lookups(prefs, nprefs, nlookups, afi);
+    errors = check_lookups(pt_db, lpm_db, addrs, nlookups);
+    printf("  Lookups: patricia %.1f ns, LPM index %.1f ns. %d mismatches\n",
+            bench_lookups(pt_db, addrs, nlookups),
+            bench_lookups(lpm_db, addrs, nlookups), errors);
+
+    /* The lookups of the removed prefixes fall back to the prefixes
+     * covering them */
+    for (i = 0; i < nprefs; i += REMOVE_RATIO) {
+        if (prefs[i].added) {
+            prefix_to_laddr(&prefs[i], afi, &laddr);
+            mdb_remove_entry(pt_db, &laddr);
+            mdb_remove_entry(lpm_db, &laddr);
+        }
+    }
+    i = check_lookups(pt_db, lpm_db, addrs, nlookups);
+    printf("  After removing 1 of each %d prefixes: %d mismatches\n",
+            REMOVE_RATIO, i);
+    errors += i;
+
+    free(addrs);
+    mdb_del(pt_db, NULL);
+    mdb_del(lpm_db, NULL);
+    free(prefs);
+
+    return (errors);
+}
+
+int main(int argc, char **argv)
+{
+    int nv4 = DEFAULT_V4_PREFIXES, nv6 = DEFAULT_V6_PREFIXES;
+    int nlookups = DEFAULT_LOOKUPS;
+    int errors = 0;
+
+    if (argc > 1) {
+        nv4 = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        nv6 = atoi(argv[2]);
+    }
+    if (argc > 3) {
+        nlookups = atoi(argv[3]);
+    }
+    if (nv4 < 0 || nv6 < 0 || nlookups <= 0) {
+        printf("Usage: %s [IPv4 prefixes] [IPv6 prefixes] [lookups]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    srand(2013);
+
+    if (nv4 > 0) {
+        errors += run("IPv4", AF_INET, nv4, nlookups);
+    }
+    if (nv6 > 0) {
+        errors += run("IPv6", AF_INET6, nv6, nlookups);
+    }
+    if (errors > 0) {
+        printf("FAILED: %d lookups with different results\n", errors);
+        exit(EXIT_FAILURE);
+    }
+    printf("OK\n");
+
+    return 0;
+}
@@ -0,0 +1,236 @@
+/*
+ * Micro-benchmark of the hashes of the packet tuples used by the flow tables
+ * of the data plane and by the flow balancing. It reports the cost per call
+ * and how the hashes of random flows spread in the buckets of a table.
+ *
+ * Usage: pkt_hash_bench [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lib/mem_util.h"
+#include "lib/packets.h"
+
+/* Defined in lookup3.c, built into packets.c */
+uint32_t hashword(const uint32_t *k, size_t length, uint32_t initval);
+
+#define NTUPLES             1024
+#define DEFAULT_ITERATIONS  20000000
+#define DIST_FLOWS          (1 << 20)
+#define DIST_BUCKETS        (1 << 16)
+
+int debug_level = 0;
+int daemonize = 0;
+
+static packet_tuple_t tuples[NTUPLES];
+/* Keeps the results alive so that the calls are not optimized out */
+static volatile uint32_t sink;
+
+static double
+now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((double)ts.tv_sec * 1e9 + ts.tv_nsec);
+}
+
+static void
+random_bytes(uint8_t *buf, int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++) {
+        buf[i] = rand();
+    }
+}
+
+static void
+random_tuple(packet_tuple_t *tpl, int afi)
+{
+    uint8_t addr[16];
+
+    memset(tpl, 0, sizeof(packet_tuple_t));
+    random_bytes(addr, sizeof(addr));
+    lisp_addr_ip_init(&tpl->src_addr, addr, afi);
+    random_bytes(addr, sizeof(addr));
+    lisp_addr_ip_init(&tpl->dst_addr, addr, afi);
+    tpl->src_port = rand();
+    tpl->dst_port = rand();
+    tpl->protocol = rand() % 2 ? 6 : 17;
+    tpl->iid = rand() % 4;
+}
+
+static void
+init_tuples(int afi)
+{
+    int i;
+
+    for (i = 0; i < NTUPLES; i++) {
+        random_tuple(&tuples[i], afi);
+    }
+}
+
+static void
+bench_tuple_hash(const char *name, long iterations)
+{
+    double start;
+    uint32_t h = 0;
+    long i;
+
+    start = now_ns();
+    for (i = 0; i < iterations; i++) {
+        h ^= pkt_tuple_hash(&tuples[i & (NTUPLES - 1)]);
+    }
+    sink = h;
+    printf("%-34s %8.2f ns/call\n", name, (now_ns() - start) / iterations);
+}
+
+/* The hash of the tuples as it was before the flow keys: the words of the
+ * tuple are copied to a buffer allocated in every call. Kept as the baseline */
+static uint32_t
+alloc_tuple_hash(packet_tuple_t *tuple)
+{
+    uint32_t hash;
+    uint32_t *tuples;
+    int addr_words, len;
+    int port = tuple->src_port + ((int)tuple->dst_port << 16);
+
+    /* src and dst addresses + ports + protocol + iid */
+    addr_words = lisp_addr_ip_afi(&tuple->src_addr) == AF_INET ? 1 : 4;
+    len = 2 * addr_words + 3;
+    tuples = xmalloc(len * sizeof(uint32_t));
+    lisp_addr_copy_to(&tuples[0], &tuple->src_addr);
+    lisp_addr_copy_to(&tuples[addr_words], &tuple->dst_addr);
+    tuples[len - 3] = port;
+    tuples[len - 2] = tuple->protocol;
+    tuples[len - 1] = tuple->iid;
+
+    hash = hashword(tuples, len, 2013);
+    free(tuples);
+    return (hash);
+}
+
+static void
+bench_alloc_tuple_hash(const char *name, long iterations)
+{
+    double start;
+    uint32_t h = 0;
+    long i;
+
+    start = now_ns();
+    for (i = 0; i < iterations; i++) {
+        h ^= alloc_tuple_hash(&tuples[i & (NTUPLES - 1)]);
+    }
+    sink = h;
+    printf("%-34s %8.2f ns/call\n", name, (now_ns() - start) / iterations);
+}
+
+/* Time the key built from the tuple and hashed in the same loop, and then
+ * the hash alone of a key already built. Both loops do the same work but the
+ * building of the key, so the second one is a part of the first one */
+static void
+bench_flow_key(const char *name, long iterations)
+{
+    pkt_flow_key_t key;
+    double start;
+    uint32_t h = 0;
+    long i;
+
+    start = now_ns();
+    for (i = 0; i < iterations; i++) {
+        pkt_flow_key_init(&key, &tuples[i & (NTUPLES - 1)]);
+        key.src_port ^= i;
+        h ^= pkt_flow_key_hash(&key);
+    }
+    sink = h;
+    printf("%-34s %8.2f ns/call\n", name, (now_ns() - start) / iterations);
+
+    pkt_flow_key_init(&key, &tuples[0]);
+    start = now_ns();
+    for (i = 0; i < iterations; i++) {
+        key.src_port ^= i;
+        h ^= pkt_flow_key_hash(&key);
+    }
+    sink = h;
+    printf("%-34s %8.2f ns/call\n", "  of which hash of the key",
+            (now_ns() - start) / iterations);
+}
+
+static void
+bench_src_dst_hash(const char *name, long iterations)
+{
+    packet_tuple_t *tpl;
+    double start;
+    uint32_t h = 0;
+    long i;
+
+    start = now_ns();
+    for (i = 0; i < iterations; i++) {
+        tpl = &tuples[i & (NTUPLES - 1)];
+        h ^= pkt_src_dst_hash(&tpl->src_addr, &tpl->dst_addr);
+    }
+    sink = h;
+    printf("%-34s %8.2f ns/call\n", name, (now_ns() - start) / iterations);
+}
+
+/* Hash random flows in a table indexed by the low bits of the hash, as the
+ * flow tables do, and compare the longest chain with the expected one */
+static void
+check_distribution(const char *name, int afi)
+{
+    uint32_t *buckets;
+    packet_tuple_t tpl;
+    uint32_t max = 0;
+    double chi2 = 0, expected = (double)DIST_FLOWS / DIST_BUCKETS;
+    int i;
+
+    buckets = calloc(DIST_BUCKETS, sizeof(uint32_t));
+    for (i = 0; i < DIST_FLOWS; i++) {
+        random_tuple(&tpl, afi);
+        buckets[pkt_tuple_hash(&tpl) & (DIST_BUCKETS - 1)]++;
+    }
+    for (i = 0; i < DIST_BUCKETS; i++) {
+        if (buckets[i] > max) {
+            max = buckets[i];
+        }
+        chi2 += (buckets[i] - expected) * (buckets[i] - expected) / expected;
+    }
+    printf("%-34s %u flows per bucket, longest %u, chi2/buckets %.3f\n",
+            name, (uint32_t)expected, max, chi2 / DIST_BUCKETS);
+    free(buckets);
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = DEFAULT_ITERATIONS;
+
+    if (argc > 1) {
+        iterations = atol(argv[1]);
+        if (iterations <= 0) {
+            printf("Usage: %s [iterations]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    srand(2013);
+
+    init_tuples(AF_INET);
+    bench_alloc_tuple_hash("allocating tuple hash IPv4", iterations);
+    bench_tuple_hash("pkt_tuple_hash IPv4", iterations);
+    bench_flow_key("pkt_flow_key_init + hash IPv4", iterations);
+    bench_src_dst_hash("pkt_src_dst_hash IPv4", iterations);
+
+    init_tuples(AF_INET6);
+    bench_alloc_tuple_hash("allocating tuple hash IPv6", iterations);
+    bench_tuple_hash("pkt_tuple_hash IPv6", iterations);
+    bench_flow_key("pkt_flow_key_init + hash IPv6", iterations);
+    bench_src_dst_hash("pkt_src_dst_hash IPv6", iterations);
+
+    check_distribution("Distribution IPv4", AF_INET);
+    check_distribution("Distribution IPv6", AF_INET6);
+
+    return 0;
+}